@@ -31,6 +31,7 @@
 #endif
 
 #include <cmath>
+#include <cstddef>
 #include <cstring>
 #include <exception>
 #include <iostream>
@@ -44,6 +45,9 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
 #include <map>
 #include <unordered_set>
 #include <unordered_map>
@@ -97,6 +97,13 @@ public:
 	}
 
 	bool intersect(const Ray<FloatType> &r, FloatType tmin, FloatType tmax ) const
+	{
+		FloatType tNear;
+		return intersect(r, tmin, tmax, tNear);
+	}
+
+	//! as above; on a hit, tNear is the ray parameter where the ray enters the box, clamped to tmin
+	bool intersect(const Ray<FloatType> &r, FloatType tmin, FloatType tmax, FloatType& tNear) const
 	{
 		//TODO move to intersection
 
@@ -131,6 +138,7 @@ public:
 			txmin = tzmin;
 		if (tzmax < txmax)
 			txmax = tzmax;
+		tNear = txmin > t0 ? txmin : t0;
 		return ( (txmin <= t1) && (txmax >= t0) );
 
 	}
@@ -235,6 +243,13 @@ public:
 		return vec3<FloatType>(maxX - minX, maxY - minY, maxZ - minZ);
 	}
 
+	//! returns 0 for an empty box
+	FloatType getSurfaceArea() const {
+		if (!isValid()) return (FloatType)0;
+		const vec3<FloatType> e = getExtent();
+		return (FloatType)2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
 	vec3<FloatType> getMin() const {
 		return vec3<FloatType>(minX, minY, minZ);
 	}
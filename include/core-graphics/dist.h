@@ -63,6 +63,96 @@ T distSq(const Line2<T> &line, const vec2<T> &pt)
     return n / d;
 }
 
+template <class T>
+T distSq(const BoundingBox3<T> &box, const vec3<T> &pt)
+{
+    //
+    // zero inside the box, otherwise the squared distance to the nearest point on its surface
+    //
+    T result = (T)0;
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        const T d = std::max(std::max(box.getMin()[axis] - pt[axis], pt[axis] - box.getMax()[axis]), (T)0);
+        result += d * d;
+    }
+    return result;
+}
+
+template <class T>
+T distSq(const vec3<T> &pt, const BoundingBox3<T> &box)
+{
+    return distSq(box, pt);
+}
+
+//
+// closest point on the triangle (v0, v1, v2) to p, from Ericson, Real-Time Collision Detection, 5.1.5. Also returns its
+// barycentric coordinates: u is the weight of v1 and v the weight of v2, so the point is v0 * (1 - u - v) + v1 * u + v2 * v
+//
+template <class T>
+vec3<T> closestPointOnTriangle(const vec3<T> &p, const vec3<T> &v0, const vec3<T> &v1, const vec3<T> &v2, T &u, T &v)
+{
+    const vec3<T> e1 = v1 - v0;
+    const vec3<T> e2 = v2 - v0;
+
+    // vertex region of v0
+    const vec3<T> p0 = p - v0;
+    const T d1 = e1 | p0;
+    const T d2 = e2 | p0;
+    if (d1 <= (T)0 && d2 <= (T)0) { u = (T)0; v = (T)0; return v0; }
+
+    // vertex region of v1
+    const vec3<T> p1 = p - v1;
+    const T d3 = e1 | p1;
+    const T d4 = e2 | p1;
+    if (d3 >= (T)0 && d4 <= d3) { u = (T)1; v = (T)0; return v1; }
+
+    // edge region of v0 v1
+    const T c2 = d1 * d4 - d3 * d2;
+    if (c2 <= (T)0 && d1 >= (T)0 && d3 <= (T)0) {
+        u = d1 / (d1 - d3); v = (T)0;
+        return v0 + u * e1;
+    }
+
+    // vertex region of v2
+    const vec3<T> p2 = p - v2;
+    const T d5 = e1 | p2;
+    const T d6 = e2 | p2;
+    if (d6 >= (T)0 && d5 <= d6) { u = (T)0; v = (T)1; return v2; }
+
+    // edge region of v0 v2
+    const T c1 = d5 * d2 - d1 * d6;
+    if (c1 <= (T)0 && d2 >= (T)0 && d6 <= (T)0) {
+        u = (T)0; v = d2 / (d2 - d6);
+        return v0 + v * e2;
+    }
+
+    // edge region of v1 v2
+    const T c0 = d3 * d6 - d5 * d4;
+    if (c0 <= (T)0 && d4 - d3 >= (T)0 && d5 - d6 >= (T)0) {
+        v = (d4 - d3) / ((d4 - d3) + (d5 - d6)); u = (T)1 - v;
+        return v1 + v * (v2 - v1);
+    }
+
+    // inside the face
+    const T denom = (T)1 / (c0 + c1 + c2);
+    u = c1 * denom;
+    v = c2 * denom;
+    return v0 + u * e1 + v * e2;
+}
+
+template <class T>
+T distSq(const Triangle<T> &tri, const vec3<T> &pt)
+{
+    T u, v;
+    return distSq(closestPointOnTriangle(pt, tri.vertices[0], tri.vertices[1], tri.vertices[2], u, v), pt);
+}
+
+template <class T>
+T distSq(const vec3<T> &pt, const Triangle<T> &tri)
+{
+    return distSq(tri, pt);
+}
+
 template <class T>
 T distSq(const OrientedBoundingBox3<T> &box, const vec3<T> &pt)
 {
@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef CORE_GRAPHICS_FRUSTUM_H_
+#define CORE_GRAPHICS_FRUSTUM_H_
+
+namespace ml {
+
+//! view volume of a projection: a convex region bounded by six planes whose normals point inside
+template<class FloatType>
+class Frustum {
+public:
+	enum PlaneIndex {
+		Left = 0, Right, Bottom, Top, Near, Far
+	};
+
+	Frustum() {}
+
+	//! the volume -w <= x <= w, -w <= y <= w, 0 <= z <= w in the clip space of viewProj (the convention of Camera); with
+	//! Camera::getViewProj() the frustum is in world space
+	explicit Frustum(const Matrix4x4<FloatType>& viewProj) {
+		const Matrix4x4<FloatType>& m = viewProj;
+		const vec4<FloatType> rowX(m(0, 0), m(0, 1), m(0, 2), m(0, 3));
+		const vec4<FloatType> rowY(m(1, 0), m(1, 1), m(1, 2), m(1, 3));
+		const vec4<FloatType> rowZ(m(2, 0), m(2, 1), m(2, 2), m(2, 3));
+		const vec4<FloatType> rowW(m(3, 0), m(3, 1), m(3, 2), m(3, 3));
+		setPlane(Left, rowW + rowX);
+		setPlane(Right, rowW - rowX);
+		setPlane(Bottom, rowW + rowY);
+		setPlane(Top, rowW - rowY);
+		setPlane(Near, rowZ);
+		setPlane(Far, rowW - rowZ);
+
+		const Matrix4x4<FloatType> inverse = viewProj.getInverse();
+		for (unsigned int i = 0; i < 8; i++) {
+			m_Corners[i] = inverse * vec3<FloatType>((i & 1) ? (FloatType)1 : (FloatType)-1, (i & 2) ? (FloatType)1 : (FloatType)-1, (i & 4) ? (FloatType)1 : (FloatType)0);
+			m_CornerBounds.include(m_Corners[i]);
+		}
+	}
+
+	const Plane<FloatType>& getPlane(unsigned int i) const {
+		return m_Planes[i];
+	}
+
+	//! corner i lies on the right side if bit 0 is set, on the top if bit 1 is set and on the far plane if bit 2 is set
+	const vec3<FloatType>& getCorner(unsigned int i) const {
+		return m_Corners[i];
+	}
+
+	bool intersects(const vec3<FloatType>& p) const {
+		for (unsigned int i = 0; i < 6; i++) {
+			if (m_Planes[i].distanceToPoint(p) < (FloatType)0) return false;
+		}
+		return true;
+	}
+
+	//! conservative: rejects boxes outside one of the planes or the bounds of the corners, but may accept a box that only
+	//! comes close to an edge of the frustum
+	bool intersects(const BoundingBox3<FloatType>& box) const {
+		if (!m_CornerBounds.intersects(box)) return false;
+		for (unsigned int i = 0; i < 6; i++) {
+			const vec3<FloatType>& n = m_Planes[i].getNormal();
+			const vec3<FloatType> farthest(n.x >= (FloatType)0 ? box.getMaxX() : box.getMinX(), n.y >= (FloatType)0 ? box.getMaxY() : box.getMinY(), n.z >= (FloatType)0 ? box.getMaxZ() : box.getMinZ());
+			if (m_Planes[i].distanceToPoint(farthest) < (FloatType)0) return false;
+		}
+		return true;
+	}
+
+	//! exact triangle test: separating axes are the plane normals, the triangle normal and the cross products of the triangle
+	//! edges with the frustum edges
+	bool intersects(const vec3<FloatType>& p0, const vec3<FloatType>& p1, const vec3<FloatType>& p2) const {
+		for (unsigned int i = 0; i < 6; i++) {
+			if (m_Planes[i].distanceToPoint(p0) < (FloatType)0 && m_Planes[i].distanceToPoint(p1) < (FloatType)0 && m_Planes[i].distanceToPoint(p2) < (FloatType)0) return false;
+		}
+
+		const vec3<FloatType> triangle[3] = { p0, p1, p2 };
+		if (isSeparatingAxis((p1 - p0) ^ (p2 - p0), triangle)) return false;
+
+		//the edges from the near to the far plane, and those of the near and far rectangles
+		static const unsigned int edges[12][2] = { { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 4, 5 }, { 6, 7 }, { 4, 6 }, { 5, 7 } };
+		for (unsigned int e = 0; e < 3; e++) {
+			const vec3<FloatType> triangleEdge = triangle[(e + 1) % 3] - triangle[e];
+			for (unsigned int f = 0; f < 12; f++) {
+				if (isSeparatingAxis(triangleEdge ^ (m_Corners[edges[f][1]] - m_Corners[edges[f][0]]), triangle)) return false;
+			}
+		}
+		return true;
+	}
+
+	//! true if the box lies completely inside
+	bool contains(const BoundingBox3<FloatType>& box) const {
+		vec3<FloatType> corners[8];
+		box.getVertices(corners);
+		for (unsigned int i = 0; i < 8; i++) {
+			if (!intersects(corners[i])) return false;
+		}
+		return true;
+	}
+
+private:
+	void setPlane(unsigned int i, const vec4<FloatType>& coefficients) {
+		const vec3<FloatType> normal(coefficients.x, coefficients.y, coefficients.z);
+		const FloatType length = normal.length();
+		m_Planes[i] = Plane<FloatType>(normal / length, -coefficients.w / length);
+	}
+
+	bool isSeparatingAxis(const vec3<FloatType>& axis, const vec3<FloatType>* triangle) const {
+		if (axis.lengthSq() == (FloatType)0) return false;
+		FloatType triangleMin = std::numeric_limits<FloatType>::max(), triangleMax = -std::numeric_limits<FloatType>::max();
+		for (unsigned int i = 0; i < 3; i++) {
+			const FloatType d = axis | triangle[i];
+			triangleMin = std::min(triangleMin, d);
+			triangleMax = std::max(triangleMax, d);
+		}
+		FloatType frustumMin = std::numeric_limits<FloatType>::max(), frustumMax = -std::numeric_limits<FloatType>::max();
+		for (unsigned int i = 0; i < 8; i++) {
+			const FloatType d = axis | m_Corners[i];
+			frustumMin = std::min(frustumMin, d);
+			frustumMax = std::max(frustumMax, d);
+		}
+		return triangleMax < frustumMin || frustumMax < triangleMin;
+	}
+
+	Plane<FloatType> m_Planes[6];
+	vec3<FloatType> m_Corners[8];
+	BoundingBox3<FloatType> m_CornerBounds;
+};
+
+typedef Frustum<float> Frustumf;
+typedef Frustum<double> Frustumd;
+
+} //namespace ml
+
+#endif
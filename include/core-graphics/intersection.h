@@ -84,14 +84,12 @@ namespace intersection {
 		vec3<FloatType> e1 = v1 - v0;
 		vec3<FloatType> e2 = v2 - v0;
 
-		if (intersectOnlyFrontFaces) {
-			vec3<FloatType> n = e1^e2; n.normalize();
-			if ((d | n) > (FloatType)0.0) return false;
-		}
-
 		vec3<FloatType> h = d^e2;
 		FloatType a = e1 | h;
 
+		//a = -(d | (e1^e2)), so its sign tells the facing without computing the normal
+		if (intersectOnlyFrontFaces && a < (FloatType)0.0) return false;
+
 		//if (a > -0.0000000001 && a < 0.0000000001) return false;
 		if (a == (FloatType)0.0 || a == -(FloatType)0.0)	return false;
 
@@ -748,8 +746,10 @@ namespace intersection {
 		const vec3<FloatType> &p1,
 		const vec3<FloatType> &p2) 
 	{
-		//TODO
-		//if(!collide_plane(triangle_plane)) return false;
+		//the box axes: the bounds of the triangle must overlap the box
+		for (unsigned int i = 0; i < 3; i++) {
+			if (std::min(std::min(p0[i], p1[i]), p2[i]) > bbBoxMax[i] || std::max(std::max(p0[i], p1[i]), p2[i]) < bbBoxMin[i]) return false;
+		}
 		if (intersectBoxPlane(bbBoxMin, bbBoxMax, Plane<FloatType>(p0,p1,p2)) != 1) return false;
 
 		vec3<FloatType> center = (FloatType)0.5 * (bbBoxMin + bbBoxMax);
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef CORE_GRAPHICS_SPHERE_H_
+#define CORE_GRAPHICS_SPHERE_H_
+
+namespace ml {
+
+//! solid ball given by its center and radius
+template<class FloatType>
+class Sphere {
+public:
+	Sphere() : m_Center(vec3<FloatType>::origin), m_Radius((FloatType)0) {}
+	Sphere(const vec3<FloatType>& center, FloatType radius) : m_Center(center), m_Radius(radius) {}
+
+	const vec3<FloatType>& getCenter() const {
+		return m_Center;
+	}
+	FloatType getRadius() const {
+		return m_Radius;
+	}
+
+	bool intersects(const vec3<FloatType>& p) const {
+		return distSq(p, m_Center) <= m_Radius * m_Radius;
+	}
+
+	bool intersects(const BoundingBox3<FloatType>& box) const {
+		return distSq(box, m_Center) <= m_Radius * m_Radius;
+	}
+
+	bool intersects(const vec3<FloatType>& p0, const vec3<FloatType>& p1, const vec3<FloatType>& p2) const {
+		FloatType u, v;
+		return distSq(closestPointOnTriangle(m_Center, p0, p1, p2, u, v), m_Center) <= m_Radius * m_Radius;
+	}
+
+	//! true if the box lies completely inside
+	bool contains(const BoundingBox3<FloatType>& box) const {
+		const vec3<FloatType> farthest(
+			std::max(std::abs(box.getMinX() - m_Center.x), std::abs(box.getMaxX() - m_Center.x)),
+			std::max(std::abs(box.getMinY() - m_Center.y), std::abs(box.getMaxY() - m_Center.y)),
+			std::max(std::abs(box.getMinZ() - m_Center.z), std::abs(box.getMaxZ() - m_Center.z)));
+		return farthest.lengthSq() <= m_Radius * m_Radius;
+	}
+
+private:
+	vec3<FloatType> m_Center;
+	FloatType m_Radius;
+};
+
+typedef Sphere<float> Spheref;
+typedef Sphere<double> Sphered;
+
+} //namespace ml
+
+#endif
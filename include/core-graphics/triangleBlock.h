@@ -0,0 +1,271 @@
+#pragma once
+
+#ifndef _TRIANGLE_BLOCK_H_
+#define _TRIANGLE_BLOCK_H_
+
+namespace ml {
+
+//! the corners of Width triangles, stored per component (structure of arrays) so that one SIMD test covers all of them.
+//! Unused slots hold degenerate triangles, which are never hit. The SIMD tests load whole rows, so blocks must be aligned to
+//! 4 * Width bytes, e.g. in a std::vector with AlignedAllocator
+template <class FloatType, unsigned int Width>
+struct TriangleBlock {
+	//! component a of corner c of triangle i is vertices[c][a][i]
+	FloatType vertices[3][3][Width];
+
+	void set(unsigned int slot, const vec3<FloatType>& v0, const vec3<FloatType>& v1, const vec3<FloatType>& v2) {
+		for (unsigned int a = 0; a < 3; a++) {
+			vertices[0][a][slot] = v0[a];
+			vertices[1][a][slot] = v1[a];
+			vertices[2][a][slot] = v2[a];
+		}
+	}
+	void clear(unsigned int slot) {
+		set(slot, vec3<FloatType>::origin, vec3<FloatType>::origin, vec3<FloatType>::origin);
+	}
+};
+
+//! ray in the form the watertight ray-triangle test needs (Woop, Benthin and Wald, Watertight Ray/Triangle Intersection, 2013):
+//! the dominant axis of the direction becomes z, and a shear maps the direction onto it. x and y are swapped for a negative
+//! direction, so the winding of the triangles is kept
+template <class FloatType>
+struct TriangleBlockRay {
+	TriangleBlockRay() {}
+	explicit TriangleBlockRay(const Ray<FloatType>& r) {
+		const vec3<FloatType>& d = r.getDirection();
+		kz = std::abs(d.x) >= std::abs(d.y) && std::abs(d.x) >= std::abs(d.z) ? 0 : (std::abs(d.y) >= std::abs(d.z) ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		if (d[kz] < (FloatType)0) std::swap(kx, ky);
+		shearX = d[kx] / d[kz];
+		shearY = d[ky] / d[kz];
+		shearZ = (FloatType)1 / d[kz];
+		for (unsigned int a = 0; a < 3; a++) origin[a] = r.getOrigin()[a];
+	}
+
+	FloatType origin[3];
+	unsigned int kx, ky, kz;
+	FloatType shearX, shearY, shearZ;
+};
+
+//! watertight ray-triangle test: rays through a shared edge or vertex hit at least one of the triangles, and u, v are the
+//! barycentric weights of v1 and v2. If an edge function is exactly zero, the three are recomputed in double precision.
+//! With onlyFrontFaces, triangles whose corners appear clockwise from the ray are skipped
+template <class FloatType>
+inline bool intersectTriangleWatertight(const vec3<FloatType>& v0, const vec3<FloatType>& v1, const vec3<FloatType>& v2, const TriangleBlockRay<FloatType>& ray, FloatType tmin, FloatType tmax, bool onlyFrontFaces, FloatType& t, FloatType& u, FloatType& v) {
+	const FloatType ax = v0[ray.kx] - ray.origin[ray.kx];
+	const FloatType ay = v0[ray.ky] - ray.origin[ray.ky];
+	const FloatType az = v0[ray.kz] - ray.origin[ray.kz];
+	const FloatType bx = v1[ray.kx] - ray.origin[ray.kx];
+	const FloatType by = v1[ray.ky] - ray.origin[ray.ky];
+	const FloatType bz = v1[ray.kz] - ray.origin[ray.kz];
+	const FloatType cx = v2[ray.kx] - ray.origin[ray.kx];
+	const FloatType cy = v2[ray.ky] - ray.origin[ray.ky];
+	const FloatType cz = v2[ray.kz] - ray.origin[ray.kz];
+
+	const FloatType shearedAX = ax - ray.shearX * az;
+	const FloatType shearedAY = ay - ray.shearY * az;
+	const FloatType shearedBX = bx - ray.shearX * bz;
+	const FloatType shearedBY = by - ray.shearY * bz;
+	const FloatType shearedCX = cx - ray.shearX * cz;
+	const FloatType shearedCY = cy - ray.shearY * cz;
+
+	FloatType edgeU = shearedCX * shearedBY - shearedCY * shearedBX;
+	FloatType edgeV = shearedAX * shearedCY - shearedAY * shearedCX;
+	FloatType edgeW = shearedBX * shearedAY - shearedBY * shearedAX;
+	if (edgeU == (FloatType)0 || edgeV == (FloatType)0 || edgeW == (FloatType)0) {
+		edgeU = (FloatType)((double)shearedCX * (double)shearedBY - (double)shearedCY * (double)shearedBX);
+		edgeV = (FloatType)((double)shearedAX * (double)shearedCY - (double)shearedAY * (double)shearedCX);
+		edgeW = (FloatType)((double)shearedBX * (double)shearedAY - (double)shearedBY * (double)shearedAX);
+	}
+
+	if ((edgeU < (FloatType)0 || edgeV < (FloatType)0 || edgeW < (FloatType)0) && (edgeU > (FloatType)0 || edgeV > (FloatType)0 || edgeW > (FloatType)0)) return false;
+	const FloatType det = edgeU + edgeV + edgeW;
+	if (det == (FloatType)0) return false;
+	if (onlyFrontFaces && det < (FloatType)0) return false;
+
+	const FloatType distance = edgeU * (ray.shearZ * az) + edgeV * (ray.shearZ * bz) + edgeW * (ray.shearZ * cz);
+	const FloatType rcpDet = (FloatType)1 / det;
+	const FloatType hitT = distance * rcpDet;
+	if (!(hitT >= tmin && hitT <= tmax)) return false;
+	t = hitT;
+	u = edgeV * rcpDet;
+	v = edgeW * rcpDet;
+	return true;
+}
+
+//! the watertight test of one triangle of a block
+template <class FloatType, unsigned int Width>
+inline bool intersectTriangleBlockSlot(const TriangleBlock<FloatType, Width>& block, unsigned int slot, const TriangleBlockRay<FloatType>& ray, FloatType tmin, FloatType tmax, bool onlyFrontFaces, FloatType& t, FloatType& u, FloatType& v) {
+	const vec3<FloatType> v0(block.vertices[0][0][slot], block.vertices[0][1][slot], block.vertices[0][2][slot]);
+	const vec3<FloatType> v1(block.vertices[1][0][slot], block.vertices[1][1][slot], block.vertices[1][2][slot]);
+	const vec3<FloatType> v2(block.vertices[2][0][slot], block.vertices[2][1][slot], block.vertices[2][2][slot]);
+	return intersectTriangleWatertight(v0, v1, v2, ray, tmin, tmax, onlyFrontFaces, t, u, v);
+}
+
+//! tests the triangles of a block whose bits are set in slotMask; returns the mask of those hit within [tmin, tmax] and writes
+//! their t, u and v. The SIMD versions exist for float blocks of width 4 (SSE) and 8 (AVX, or SSE on both halves) and
+//! perform the same operations as the scalar test, so all paths return identical results
+template <class FloatType, unsigned int Width>
+struct TriangleBlockTest {
+	static bool isSIMDSupported() {
+		return false;
+	}
+	static const char* getSIMDName() {
+		return "scalar";
+	}
+	static unsigned int intersect(const TriangleBlock<FloatType, Width>& block, unsigned int slotMask, const TriangleBlockRay<FloatType>& ray, FloatType tmin, FloatType tmax, bool onlyFrontFaces, FloatType* t, FloatType* u, FloatType* v) {
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < Width; i++) {
+			if ((slotMask & (1u << i)) && intersectTriangleBlockSlot(block, i, ray, tmin, tmax, onlyFrontFaces, t[i], u[i], v[i])) mask |= 1u << i;
+		}
+		return mask;
+	}
+};
+
+#ifdef MLIB_SIMD_X86
+
+//! SSE test of the four triangles of a block starting at slot first; slotMask refers to these four
+template <unsigned int Width>
+inline unsigned int intersectTriangleBlockSSE(const TriangleBlock<float, Width>& block, unsigned int first, unsigned int slotMask, const TriangleBlockRay<float>& ray, float tmin, float tmax, bool onlyFrontFaces, float* t, float* u, float* v) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 originX = _mm_set1_ps(ray.origin[ray.kx]);
+	const __m128 originY = _mm_set1_ps(ray.origin[ray.ky]);
+	const __m128 originZ = _mm_set1_ps(ray.origin[ray.kz]);
+	const __m128 ax = _mm_sub_ps(_mm_load_ps(block.vertices[0][ray.kx] + first), originX);
+	const __m128 ay = _mm_sub_ps(_mm_load_ps(block.vertices[0][ray.ky] + first), originY);
+	const __m128 az = _mm_sub_ps(_mm_load_ps(block.vertices[0][ray.kz] + first), originZ);
+	const __m128 bx = _mm_sub_ps(_mm_load_ps(block.vertices[1][ray.kx] + first), originX);
+	const __m128 by = _mm_sub_ps(_mm_load_ps(block.vertices[1][ray.ky] + first), originY);
+	const __m128 bz = _mm_sub_ps(_mm_load_ps(block.vertices[1][ray.kz] + first), originZ);
+	const __m128 cx = _mm_sub_ps(_mm_load_ps(block.vertices[2][ray.kx] + first), originX);
+	const __m128 cy = _mm_sub_ps(_mm_load_ps(block.vertices[2][ray.ky] + first), originY);
+	const __m128 cz = _mm_sub_ps(_mm_load_ps(block.vertices[2][ray.kz] + first), originZ);
+
+	const __m128 shearX = _mm_set1_ps(ray.shearX);
+	const __m128 shearY = _mm_set1_ps(ray.shearY);
+	const __m128 shearZ = _mm_set1_ps(ray.shearZ);
+	const __m128 shearedAX = _mm_sub_ps(ax, _mm_mul_ps(shearX, az));
+	const __m128 shearedAY = _mm_sub_ps(ay, _mm_mul_ps(shearY, az));
+	const __m128 shearedBX = _mm_sub_ps(bx, _mm_mul_ps(shearX, bz));
+	const __m128 shearedBY = _mm_sub_ps(by, _mm_mul_ps(shearY, bz));
+	const __m128 shearedCX = _mm_sub_ps(cx, _mm_mul_ps(shearX, cz));
+	const __m128 shearedCY = _mm_sub_ps(cy, _mm_mul_ps(shearY, cz));
+
+	const __m128 edgeU = _mm_sub_ps(_mm_mul_ps(shearedCX, shearedBY), _mm_mul_ps(shearedCY, shearedBX));
+	const __m128 edgeV = _mm_sub_ps(_mm_mul_ps(shearedAX, shearedCY), _mm_mul_ps(shearedAY, shearedCX));
+	const __m128 edgeW = _mm_sub_ps(_mm_mul_ps(shearedBX, shearedAY), _mm_mul_ps(shearedBY, shearedAX));
+
+	//slots with a zero edge function need the double precision fallback of the scalar test
+	const unsigned int scalarMask = slotMask & (unsigned int)_mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(edgeU, zero), _mm_cmpeq_ps(edgeV, zero)), _mm_cmpeq_ps(edgeW, zero)));
+
+	const __m128 anyNegative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(edgeU, zero), _mm_cmplt_ps(edgeV, zero)), _mm_cmplt_ps(edgeW, zero));
+	const __m128 anyPositive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(edgeU, zero), _mm_cmpgt_ps(edgeV, zero)), _mm_cmpgt_ps(edgeW, zero));
+	const __m128 det = _mm_add_ps(_mm_add_ps(edgeU, edgeV), edgeW);
+	__m128 valid = _mm_andnot_ps(_mm_and_ps(anyNegative, anyPositive), _mm_cmpneq_ps(det, zero));
+	if (onlyFrontFaces) valid = _mm_andnot_ps(_mm_cmplt_ps(det, zero), valid);
+
+	const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeU, _mm_mul_ps(shearZ, az)), _mm_mul_ps(edgeV, _mm_mul_ps(shearZ, bz))), _mm_mul_ps(edgeW, _mm_mul_ps(shearZ, cz)));
+	const __m128 rcpDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+	const __m128 hitT = _mm_mul_ps(distance, rcpDet);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(hitT, _mm_set1_ps(tmin)), _mm_cmple_ps(hitT, _mm_set1_ps(tmax))));
+	_mm_storeu_ps(t, hitT);
+	_mm_storeu_ps(u, _mm_mul_ps(edgeV, rcpDet));
+	_mm_storeu_ps(v, _mm_mul_ps(edgeW, rcpDet));
+
+	unsigned int mask = slotMask & ~scalarMask & (unsigned int)_mm_movemask_ps(valid);
+	for (unsigned int i = 0; i < 4; i++) {
+		if ((scalarMask & (1u << i)) && intersectTriangleBlockSlot(block, first + i, ray, tmin, tmax, onlyFrontFaces, t[i], u[i], v[i])) mask |= 1u << i;
+	}
+	return mask;
+}
+
+template <>
+struct TriangleBlockTest<float, 4> {
+	static bool isSIMDSupported() {
+		return CPUFeatures::get().hasSSE2();
+	}
+	static const char* getSIMDName() {
+		return "SSE";
+	}
+	static unsigned int intersect(const TriangleBlock<float, 4>& block, unsigned int slotMask, const TriangleBlockRay<float>& ray, float tmin, float tmax, bool onlyFrontFaces, float* t, float* u, float* v) {
+		return intersectTriangleBlockSSE(block, 0, slotMask, ray, tmin, tmax, onlyFrontFaces, t, u, v);
+	}
+};
+
+template <>
+struct TriangleBlockTest<float, 8> {
+	static bool isSIMDSupported() {
+		return CPUFeatures::get().hasSSE2();
+	}
+	static const char* getSIMDName() {
+		return CPUFeatures::get().hasAVX() ? "AVX" : "SSE";
+	}
+	static unsigned int intersect(const TriangleBlock<float, 8>& block, unsigned int slotMask, const TriangleBlockRay<float>& ray, float tmin, float tmax, bool onlyFrontFaces, float* t, float* u, float* v) {
+		static const bool useAVX = CPUFeatures::get().hasAVX();
+		if (useAVX) return intersectAVX(block, slotMask, ray, tmin, tmax, onlyFrontFaces, t, u, v);
+		unsigned int mask = 0;
+		if (slotMask & 0x0f) mask |= intersectTriangleBlockSSE(block, 0, slotMask & 0x0f, ray, tmin, tmax, onlyFrontFaces, t, u, v);
+		if (slotMask & 0xf0) mask |= intersectTriangleBlockSSE(block, 4, slotMask >> 4, ray, tmin, tmax, onlyFrontFaces, t + 4, u + 4, v + 4) << 4;
+		return mask;
+	}
+
+	MLIB_TARGET_AVX static unsigned int intersectAVX(const TriangleBlock<float, 8>& block, unsigned int slotMask, const TriangleBlockRay<float>& ray, float tmin, float tmax, bool onlyFrontFaces, float* t, float* u, float* v) {
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 originX = _mm256_set1_ps(ray.origin[ray.kx]);
+		const __m256 originY = _mm256_set1_ps(ray.origin[ray.ky]);
+		const __m256 originZ = _mm256_set1_ps(ray.origin[ray.kz]);
+		const __m256 ax = _mm256_sub_ps(_mm256_load_ps(block.vertices[0][ray.kx]), originX);
+		const __m256 ay = _mm256_sub_ps(_mm256_load_ps(block.vertices[0][ray.ky]), originY);
+		const __m256 az = _mm256_sub_ps(_mm256_load_ps(block.vertices[0][ray.kz]), originZ);
+		const __m256 bx = _mm256_sub_ps(_mm256_load_ps(block.vertices[1][ray.kx]), originX);
+		const __m256 by = _mm256_sub_ps(_mm256_load_ps(block.vertices[1][ray.ky]), originY);
+		const __m256 bz = _mm256_sub_ps(_mm256_load_ps(block.vertices[1][ray.kz]), originZ);
+		const __m256 cx = _mm256_sub_ps(_mm256_load_ps(block.vertices[2][ray.kx]), originX);
+		const __m256 cy = _mm256_sub_ps(_mm256_load_ps(block.vertices[2][ray.ky]), originY);
+		const __m256 cz = _mm256_sub_ps(_mm256_load_ps(block.vertices[2][ray.kz]), originZ);
+
+		const __m256 shearX = _mm256_set1_ps(ray.shearX);
+		const __m256 shearY = _mm256_set1_ps(ray.shearY);
+		const __m256 shearZ = _mm256_set1_ps(ray.shearZ);
+		const __m256 shearedAX = _mm256_sub_ps(ax, _mm256_mul_ps(shearX, az));
+		const __m256 shearedAY = _mm256_sub_ps(ay, _mm256_mul_ps(shearY, az));
+		const __m256 shearedBX = _mm256_sub_ps(bx, _mm256_mul_ps(shearX, bz));
+		const __m256 shearedBY = _mm256_sub_ps(by, _mm256_mul_ps(shearY, bz));
+		const __m256 shearedCX = _mm256_sub_ps(cx, _mm256_mul_ps(shearX, cz));
+		const __m256 shearedCY = _mm256_sub_ps(cy, _mm256_mul_ps(shearY, cz));
+
+		const __m256 edgeU = _mm256_sub_ps(_mm256_mul_ps(shearedCX, shearedBY), _mm256_mul_ps(shearedCY, shearedBX));
+		const __m256 edgeV = _mm256_sub_ps(_mm256_mul_ps(shearedAX, shearedCY), _mm256_mul_ps(shearedAY, shearedCX));
+		const __m256 edgeW = _mm256_sub_ps(_mm256_mul_ps(shearedBX, shearedAY), _mm256_mul_ps(shearedBY, shearedAX));
+
+		const __m256 anyZero = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_EQ_OQ), _mm256_cmp_ps(edgeV, zero, _CMP_EQ_OQ)), _mm256_cmp_ps(edgeW, zero, _CMP_EQ_OQ));
+		const unsigned int scalarMask = slotMask & (unsigned int)_mm256_movemask_ps(anyZero);
+
+		const __m256 anyNegative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_LT_OQ), _mm256_cmp_ps(edgeV, zero, _CMP_LT_OQ)), _mm256_cmp_ps(edgeW, zero, _CMP_LT_OQ));
+		const __m256 anyPositive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_GT_OQ), _mm256_cmp_ps(edgeV, zero, _CMP_GT_OQ)), _mm256_cmp_ps(edgeW, zero, _CMP_GT_OQ));
+		const __m256 det = _mm256_add_ps(_mm256_add_ps(edgeU, edgeV), edgeW);
+		__m256 valid = _mm256_andnot_ps(_mm256_and_ps(anyNegative, anyPositive), _mm256_cmp_ps(det, zero, _CMP_NEQ_UQ));
+		if (onlyFrontFaces) valid = _mm256_andnot_ps(_mm256_cmp_ps(det, zero, _CMP_LT_OQ), valid);
+
+		const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edgeU, _mm256_mul_ps(shearZ, az)), _mm256_mul_ps(edgeV, _mm256_mul_ps(shearZ, bz))), _mm256_mul_ps(edgeW, _mm256_mul_ps(shearZ, cz)));
+		const __m256 rcpDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+		const __m256 hitT = _mm256_mul_ps(distance, rcpDet);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(hitT, _mm256_set1_ps(tmin), _CMP_GE_OQ), _mm256_cmp_ps(hitT, _mm256_set1_ps(tmax), _CMP_LE_OQ)));
+		_mm256_storeu_ps(t, hitT);
+		_mm256_storeu_ps(u, _mm256_mul_ps(edgeV, rcpDet));
+		_mm256_storeu_ps(v, _mm256_mul_ps(edgeW, rcpDet));
+
+		unsigned int mask = slotMask & ~scalarMask & (unsigned int)_mm256_movemask_ps(valid);
+		for (unsigned int i = 0; i < 8; i++) {
+			if ((scalarMask & (1u << i)) && intersectTriangleBlockSlot(block, i, ray, tmin, tmax, onlyFrontFaces, t[i], u[i], v[i])) mask |= 1u << i;
+		}
+		return mask;
+	}
+};
+
+#endif
+
+} // namespace ml
+
+#endif
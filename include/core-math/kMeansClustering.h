@@ -229,10 +229,7 @@ private:
 		const int clusterCount = (int)m_clusters.size();
 		KMeansCluster<T> *clustersPtr = &m_clusters[0];
 
-#ifdef MLIB_OPENMP
-#pragma omp parallel for
-#endif
-		for(int elementIndex = 0; elementIndex < elementCount; elementIndex++)
+		parallelFor(0, elementCount, [&](size_t elementIndex)
 		{
 			const T& e = elementPtr[elementIndex];
 			UINT closestClusterIndex = 0;
@@ -247,7 +244,7 @@ private:
 				}
 			}
 			storage[elementIndex] = closestClusterIndex;
-		}
+		});
 
 		for(int elementIndex = 0; elementIndex < elementCount; elementIndex++)
 			clustersPtr[storage[elementIndex]].addEntry(elementPtr[elementIndex]);
@@ -264,10 +261,7 @@ private:
 		const UINT clusterCount = (UINT)m_clusters.size();
 		KMeansCluster<T> *clustersPtr = &m_clusters[0];
 
-#ifdef MLIB_OPENMP
-#pragma omp parallel for
-#endif
-		for(int elementIndex = 0; elementIndex < elementCount; elementIndex++)
+		parallelFor(0, elementCount, [&](size_t elementIndex)
 		{
 			const T& e = elementPtr[elementIndex];
 			UINT closestClusterIndex = 0;
@@ -282,7 +276,7 @@ private:
 				}
 			}
 			storage[elementIndex] = closestClusterIndex;
-		}
+		});
 
 		for(int elementIndex = 0; elementIndex < elementCount; elementIndex++)
 			clustersPtr[storage[elementIndex]].addEntry(weightedElements[elementIndex], weightsPtr[elementIndex]);
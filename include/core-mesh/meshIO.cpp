@@ -9,17 +9,16 @@ void MeshIO<FloatType>::loadFromPLY( const std::string& filename, MeshData<Float
 	PlyProperties* properties /*= nullptr*/)
 {
 	mesh.clear();
-	std::ifstream file(filename, std::ios::binary);
-	if (!file.is_open())	throw MLIB_EXCEPTION("Could not open file " + filename);			
 
 	// read header
-	PlyHeader header(file);
+	PlyMappedFile ply(filename);
+	const PlyHeader& header = ply.getHeader();
+	PlyMappedReader reader = ply.getReader();
 
 	if (header.m_numFaces == (unsigned int)-1) throw MLIB_EXCEPTION("no faces found");
 	if (header.m_numVertices == (unsigned int)-1) throw MLIB_EXCEPTION("no vertices found");
 	 
 	mesh.m_Vertices.resize(header.m_numVertices);
-	mesh.m_FaceIndicesVertices.resize(header.m_numFaces, 3);	//assuming triangles
 	if (header.m_bHasNormals) mesh.m_Normals.resize(header.m_numVertices);
 	if (header.m_bHasColors) mesh.m_Colors.resize(header.m_numVertices);
 
@@ -32,7 +31,7 @@ void MeshIO<FloatType>::loadFromPLY( const std::string& filename, MeshData<Float
 			PlyProperties& props = *properties; 
 			props.clear();
 			std::unordered_set<std::string> standardHeaders = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue", "alpha" };
-			for (const PlyHeader::PlyPropertyHeader& p : header.m_properties["vertex"]) {
+			for (const PlyHeader::PlyPropertyHeader& p : header.m_properties.at("vertex")) {
 				if (standardHeaders.find(p.name) == standardHeaders.end()) {
 					PlyProperty prop;
 					prop.headerInfo = p;
@@ -46,120 +45,43 @@ void MeshIO<FloatType>::loadFromPLY( const std::string& filename, MeshData<Float
 
 	if (header.m_bBinary)
 	{
-		//unsigned int size = 3*4+3*4+3+11*4;
-		unsigned int size = 0;
-		for (unsigned int i = 0; i < header.m_properties["vertex"].size(); i++) {
-			size += header.m_properties["vertex"][i].byteSize;
-		}
-		//size = 3*4+3*4+3+11*4;
-		char* data = new char[size*header.m_numVertices];
-		file.read(data, size*header.m_numVertices);
-		for (unsigned int i = 0; i < header.m_numVertices; i++) {
-			unsigned int byteOffset = 0;
-			const std::vector<PlyHeader::PlyPropertyHeader>& vertexProperties = header.m_properties["vertex"];
-
-			for (unsigned int j = 0; j < vertexProperties.size(); j++) {
-				if (vertexProperties[j].name == "x") {
-					mesh.m_Vertices[i].x = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "y") {
-					mesh.m_Vertices[i].y = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "z") {
-					mesh.m_Vertices[i].z = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "nx") {
-					mesh.m_Normals[i].x = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "ny") {
-					mesh.m_Normals[i].y = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "nz") {
-					mesh.m_Normals[i].z = ((float*)&data[i*size + byteOffset])[0];
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "red") {
-					mesh.m_Colors[i].x = ((unsigned char*)&data[i*size + byteOffset])[0];	mesh.m_Colors[i].x/=255.0f;
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "green") {
-					mesh.m_Colors[i].y = ((unsigned char*)&data[i*size + byteOffset])[0];	mesh.m_Colors[i].y/=255.0f;
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "blue") {
-					mesh.m_Colors[i].z = ((unsigned char*)&data[i*size + byteOffset])[0];	mesh.m_Colors[i].z/=255.0f;
-					byteOffset += vertexProperties[j].byteSize;
-				}
-				else if (vertexProperties[j].name == "alpha") {
-					mesh.m_Colors[i].w = ((unsigned char*)&data[i*size + byteOffset])[0];	mesh.m_Colors[i].w/=255.0f;
-					byteOffset += vertexProperties[j].byteSize;
-				} else {
-					if (numExtraProperties > 0) {
-						PlyProperties& props = *properties;
-						auto it = props.find(vertexProperties[j].name);
-						if (it != props.end()) {
-							memcpy(it->second.data.data() + i*it->second.headerInfo.byteSize, (BYTE*)&data[i*size + byteOffset], it->second.headerInfo.byteSize);
-						}
-					}
-					byteOffset += vertexProperties[j].byteSize; //ignore unknown
-				}
-			}
-			assert(byteOffset == size);
-
-		}	
-
-		delete [] data;
-
-		size = 1+3*4;	//typically 1 uchar for numVertices per triangle, 3 * int for indices
-		data = new char[size*header.m_numFaces];
-		file.read(data, size*header.m_numFaces);
-		for (unsigned int i = 0; i < header.m_numFaces; i++) {	
-			mesh.m_FaceIndicesVertices[i][0] = ((int*)&data[i*size+1])[0];
-			mesh.m_FaceIndicesVertices[i][1] = ((int*)&data[i*size+1])[1];
-			mesh.m_FaceIndicesVertices[i][2] = ((int*)&data[i*size+1])[2];
-
-			//mesh.m_FaceIndicesVertices[i].push_back(((int*)&data[i*size+1])[0]);
-			//mesh.m_FaceIndicesVertices[i].push_back(((int*)&data[i*size+1])[1]);
-			//mesh.m_FaceIndicesVertices[i].push_back(((int*)&data[i*size+1])[2]);
-		}
-
-		//if (mesh.m_Colors.size() == 0) {
-		//	mesh.m_Colors.resize(header.m_NumVertices);
-		//	for (size_t i = 0; i < mesh.m_Colors.size(); i++) {
-		//		mesh.m_Colors[i] = vec3f(0.5f, 0.5f, 0.5f);
-		//	}
-		//}
-		delete [] data;
-
+		//the header is compiled once; vertices and faces are then decoded straight from the mapped file, without looking at
+		//property names and without an intermediate buffer. The vertices are copied into the mesh; callers who only want the
+		//positions can read them in place with PlyMappedFile::getVertexView
+		PlyVertexSchema<FloatType> vertexSchema(header, mesh.m_Vertices.data(),
+			header.m_bHasNormals ? mesh.m_Normals.data() : nullptr,
+			header.m_bHasColors ? mesh.m_Colors.data() : nullptr,
+			numExtraProperties > 0 ? properties : nullptr);
+		PlyFaceSchema faceSchema(header);
+
+		vertexSchema.decode(reader, header.m_numVertices);
+		mesh.m_FaceIndicesVertices.reserve(header.m_numFaces, 3);
+		faceSchema.decode(reader, header.m_numFaces, mesh.m_FaceIndicesVertices);
 	}
 	else
 	{
+		PlyAsciiReader ascii(reader);
 		for (unsigned int i = 0; i < header.m_numVertices; i++) {
-			std::string line;
-			util::safeGetline(file, line);
-			std::stringstream ss(line);	//TOOD replace with sscanf
-			ss >> mesh.m_Vertices[i].x >> mesh.m_Vertices[i].y >> mesh.m_Vertices[i].z;
+			ascii.nextLine();
+			ascii.read(mesh.m_Vertices[i].x);
+			ascii.read(mesh.m_Vertices[i].y);
+			ascii.read(mesh.m_Vertices[i].z);
 			if (header.m_bHasColors) {
-				ss >> mesh.m_Colors[i].x >> mesh.m_Colors[i].y >> mesh.m_Colors[i].z;
+				ascii.read(mesh.m_Colors[i].x);
+				ascii.read(mesh.m_Colors[i].y);
+				ascii.read(mesh.m_Colors[i].z);
 				mesh.m_Colors[i] /= (FloatType)255.0;
 			}
 		}
 
 		for (unsigned int i = 0; i < header.m_numFaces; i++) {
-			std::string line;
-			util::safeGetline(file, line);
-			std::stringstream ss(line); //TOOD replace with sscanf
-			unsigned int num_vs;
-			ss >> num_vs;
+			ascii.nextLine();
+			unsigned int num_vs = 0;
+			ascii.read(num_vs);
 			std::vector<unsigned int> face;	face.reserve(num_vs);
 			for (unsigned int j = 0; j < num_vs; j++) {
-				unsigned int idx;
-				ss >> idx;
+				unsigned int idx = 0;
+				ascii.read(idx);
 				face.push_back(idx);
 			}
 			mesh.m_FaceIndicesVertices.push_back(face);
@@ -5,17 +5,32 @@
 namespace ml {
 
 	struct PlyHeader {
+		//! scalar types of the PLY format; the sized names (int8, float32, ...) map to the same types
+		enum PlyType {
+			PLY_CHAR, PLY_UCHAR, PLY_SHORT, PLY_USHORT, PLY_INT, PLY_UINT, PLY_FLOAT, PLY_DOUBLE
+		};
+
 		struct PlyPropertyHeader {
 			PlyPropertyHeader() {
 				byteSize = 0;
+				type = PLY_FLOAT;
+				isList = false;
+				listCountType = PLY_UCHAR;
+				listCountByteSize = 0;
 			}
 			std::string name;
 			std::string nameType;
-			unsigned int byteSize;
+			unsigned int byteSize;	//of the property, or of one list item for lists
+			PlyType type;			//of the property, or of the list items for lists
+			bool isList;
+			PlyType listCountType;
+			unsigned int listCountByteSize;
 		};
-		PlyHeader(std::ifstream& file) {
+		PlyHeader(std::istream& file) {
 			m_numVertices = (unsigned int)-1;
 			m_numFaces = (unsigned int)-1;
+			m_bBinary = false;
+			m_bBigEndian = false;
 			m_bHasNormals = false;
 			m_bHasColors = false;
 
@@ -24,17 +39,45 @@ namespace ml {
 		PlyHeader() {
 			m_numVertices = (unsigned int)-1;
 			m_numFaces = (unsigned int)-1;
+			m_bBinary = false;
+			m_bBigEndian = false;
 			m_bHasNormals = false;
 			m_bHasColors = false;
 		}
 		unsigned int m_numVertices;
 		unsigned int m_numFaces;
-		std::map<std::string, std::vector<PlyPropertyHeader>> m_properties;
+		std::map<std::string, std::vector<PlyPropertyHeader>> m_properties;	//element -> properties, including lists such as the face's vertex_indices
 		bool m_bBinary;
+		bool m_bBigEndian;
 		bool m_bHasNormals;
 		bool m_bHasColors;
 
-		void read(std::ifstream& file) {
+		//! bytes of one element, or 0 if it has list properties and its size varies
+		unsigned int getElementSize(const std::string& element) const {
+			auto it = m_properties.find(element);
+			if (it == m_properties.end()) return 0;
+			unsigned int size = 0;
+			for (const PlyPropertyHeader& p : it->second) {
+				if (p.isList) return 0;
+				size += p.byteSize;
+			}
+			return size;
+		}
+
+		//! throws for unknown type names
+		static PlyType parseType(const std::string& nameType, unsigned int& byteSize) {
+			if (nameType == "double" || nameType == "float64") { byteSize = 8; return PLY_DOUBLE; }
+			if (nameType == "float" || nameType == "float32") { byteSize = 4; return PLY_FLOAT; }
+			if (nameType == "int" || nameType == "int32") { byteSize = 4; return PLY_INT; }
+			if (nameType == "uint" || nameType == "uint32") { byteSize = 4; return PLY_UINT; }
+			if (nameType == "short" || nameType == "int16") { byteSize = 2; return PLY_SHORT; }
+			if (nameType == "ushort" || nameType == "uint16") { byteSize = 2; return PLY_USHORT; }
+			if (nameType == "char" || nameType == "int8") { byteSize = 1; return PLY_CHAR; }
+			if (nameType == "uchar" || nameType == "uint8") { byteSize = 1; return PLY_UCHAR; }
+			throw MLIB_EXCEPTION("unkown data type " + nameType);
+		}
+
+		void read(std::istream& file) {
 			std::string activeElement = "";
 			std::string line;
 			util::safeGetline(file, line);
@@ -63,35 +106,25 @@ namespace ml {
 			}
 			else if (currWord == "format") {
 				ss >> currWord;
-				if (currWord == "binary_little_endian")	{
-					header.m_bBinary = true;
-				}
-				else {
-					header.m_bBinary = false;
-				}
+				header.m_bBinary = (currWord == "binary_little_endian" || currWord == "binary_big_endian");
+				header.m_bBigEndian = (currWord == "binary_big_endian");
 			}
 			else if (currWord == "property") {
-				if (!util::endsWith(line, "vertex_indices") && !util::endsWith(line, "vertex_index")) {
-					PlyHeader::PlyPropertyHeader p;
-					ss >> p.nameType;
-					ss >> p.name;
-					if (activeElement == "vertex") {
-						if (p.name == "nx")	header.m_bHasNormals = true;
-						if (p.name == "red") header.m_bHasColors = true;
-					}
-
-					if (p.nameType == "double") p.byteSize = 8;
-					else if (p.nameType == "float" || p.nameType == "int" || p.nameType == "uint") p.byteSize = 4;
-					else if (p.nameType == "ushort" || p.nameType == "short") p.byteSize = 2;
-					else if (p.nameType == "uchar" || p.nameType == "char") p.byteSize = 1;
-					else {
-						throw MLIB_EXCEPTION("unkown data type");
-					}
-					header.m_properties[activeElement].push_back(p);
+				PlyHeader::PlyPropertyHeader p;
+				ss >> p.nameType;
+				if (p.nameType == "list") {
+					std::string countType;
+					ss >> countType >> p.nameType;
+					p.isList = true;
+					p.listCountType = parseType(countType, p.listCountByteSize);
 				}
-				else {
-					//property belonging to unknown element
+				ss >> p.name;
+				if (activeElement == "vertex") {
+					if (p.name == "nx")	header.m_bHasNormals = true;
+					if (p.name == "red") header.m_bHasColors = true;
 				}
+				p.type = parseType(p.nameType, p.byteSize);
+				header.m_properties[activeElement].push_back(p);
 			}
 		}
 	};
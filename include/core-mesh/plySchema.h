@@ -0,0 +1,378 @@
+
+#ifndef CORE_MESH_PLYSCHEMA_H_
+#define CORE_MESH_PLYSCHEMA_H_
+
+namespace ml {
+
+	//! true if the byte order of a binary PLY file differs from the machine's
+	inline bool plyNeedsByteSwap(const PlyHeader& header) {
+		const unsigned int one = 1;
+		const bool machineBigEndian = (*(const BYTE*)&one == 0);
+		return header.m_bBigEndian != machineBigEndian;
+	}
+
+	template<class S>
+	inline S plyLoad(const BYTE* p, bool swapBytes) {
+		S s;
+		if (!swapBytes) {
+			memcpy(&s, p, sizeof(S));
+		}
+		else {
+			BYTE swapped[sizeof(S)];
+			for (size_t i = 0; i < sizeof(S); i++) swapped[i] = p[sizeof(S) - 1 - i];
+			memcpy(&s, swapped, sizeof(S));
+		}
+		return s;
+	}
+
+	//! converts the scalar of the given type at p
+	template<class T>
+	inline T plyReadScalar(const BYTE* p, PlyHeader::PlyType type, bool swapBytes) {
+		switch (type) {
+		case PlyHeader::PLY_CHAR:	return (T)(signed char)p[0];
+		case PlyHeader::PLY_UCHAR:	return (T)p[0];
+		case PlyHeader::PLY_SHORT:	return (T)plyLoad<short>(p, swapBytes);
+		case PlyHeader::PLY_USHORT:	return (T)plyLoad<unsigned short>(p, swapBytes);
+		case PlyHeader::PLY_INT:	return (T)plyLoad<int>(p, swapBytes);
+		case PlyHeader::PLY_UINT:	return (T)plyLoad<unsigned int>(p, swapBytes);
+		case PlyHeader::PLY_FLOAT:	return (T)plyLoad<float>(p, swapBytes);
+		default:					return (T)plyLoad<double>(p, swapBytes);
+		}
+	}
+
+	//! reads the binary body of a memory-mapped PLY file from the given byte offset: read(n) returns a pointer to the next n
+	//! bytes in the mapped pages, so the body is decoded without being copied into a buffer first
+	class PlyMappedReader {
+	public:
+		PlyMappedReader(const MemoryMappedFile& file, size_t offset) {
+			m_data = file.getData();
+			m_size = file.getSize();
+			m_offset = offset;
+			if (m_offset > m_size) throw MLIB_EXCEPTION("ply body starts after the end of the file");
+		}
+
+		//! the whole rest of the file is available at once
+		size_t getBlockSize() const {
+			return m_size - m_offset;
+		}
+
+		const BYTE* read(size_t n) {
+			if (n > m_size - m_offset) throw MLIB_EXCEPTION("unexpected end of ply file");
+			const BYTE* data = m_data + m_offset;
+			m_offset += n;
+			return data;
+		}
+
+	private:
+		const BYTE* m_data;
+		size_t m_size;
+		size_t m_offset;
+	};
+
+	//! reads the numbers of an ascii PLY body line by line, straight from the mapped pages of a PlyMappedReader: each number is
+	//! copied into a small buffer and converted with strtod/strtoul, so the body is never copied as a whole
+	class PlyAsciiReader {
+	public:
+		explicit PlyAsciiReader(PlyMappedReader& reader) {
+			const size_t size = reader.getBlockSize();
+			m_next = (const char*)reader.read(size);
+			m_end = m_next + size;
+			m_pos = m_lineEnd = m_next;
+		}
+
+		//! moves to the next line; false at the end of the body
+		bool nextLine() {
+			if (m_next == m_end) {
+				m_pos = m_lineEnd = m_end;
+				return false;
+			}
+			m_pos = m_next;
+			m_lineEnd = std::find(m_pos, m_end, '\n');
+			m_next = m_lineEnd == m_end ? m_end : m_lineEnd + 1;
+			return true;
+		}
+
+		//! the next number of the current line; false, leaving value unchanged, if the line has no more
+		template<class T>
+		bool read(T& value) {
+			while (m_pos != m_lineEnd && isBlank(*m_pos)) m_pos++;
+			const char* tokenEnd = m_pos;
+			while (tokenEnd != m_lineEnd && !isBlank(*tokenEnd)) tokenEnd++;
+			if (tokenEnd == m_pos) return false;
+
+			//the mapping is not null-terminated, so strtod must not run over its end
+			char token[64];
+			const size_t length = std::min((size_t)(tokenEnd - m_pos), sizeof(token) - 1);
+			memcpy(token, m_pos, length);
+			token[length] = 0;
+			m_pos = tokenEnd;
+			value = std::is_integral<T>::value ? (T)std::strtoul(token, nullptr, 10) : (T)std::strtod(token, nullptr);
+			return true;
+		}
+
+	private:
+		static bool isBlank(char c) {
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char* m_pos;
+		const char* m_lineEnd;
+		const char* m_next;
+		const char* m_end;
+	};
+
+	//! the vertex element of a binary PLY header compiled into a list of copy ops (offset, type, destination), so that
+	//! vertices are decoded without looking at property names. Positions, normals and colors accept every scalar type;
+	//! uchar and ushort colors are normalized to [0,1]. Other properties are copied into the PlyProperties that contain
+	//! them, in the machine's byte order.
+	template<class FloatType>
+	class PlyVertexSchema {
+	public:
+		//! normals and colors may be null; the arrays must hold header.m_numVertices elements
+		PlyVertexSchema(const PlyHeader& header, vec3<FloatType>* positions, vec3<FloatType>* normals = nullptr, vec4<FloatType>* colors = nullptr, PlyProperties* properties = nullptr) {
+			m_swapBytes = plyNeedsByteSwap(header);
+			m_vertexSize = 0;
+			auto it = header.m_properties.find("vertex");
+			if (it == header.m_properties.end()) return;
+
+			for (const PlyHeader::PlyPropertyHeader& p : it->second) {
+				if (p.isList) throw MLIB_EXCEPTION("list properties of vertices are not supported: " + p.name);
+
+				const std::string& n = p.name;
+				FloatType* destination = nullptr;
+				unsigned int stride = 0;
+				if (n == "x" || n == "y" || n == "z") {
+					destination = &positions[0].array[n[0] - 'x'];
+					stride = 3;
+				}
+				else if (normals != nullptr && (n == "nx" || n == "ny" || n == "nz")) {
+					destination = &normals[0].array[n[1] - 'x'];
+					stride = 3;
+				}
+				else if (colors != nullptr && (n == "red" || n == "green" || n == "blue" || n == "alpha")) {
+					destination = &colors[0].array[n == "red" ? 0 : n == "green" ? 1 : n == "blue" ? 2 : 3];
+					stride = 4;
+				}
+
+				if (destination != nullptr) {
+					CopyOp op;
+					op.offset = m_vertexSize;
+					op.type = p.type;
+					op.destination = destination;
+					op.stride = stride;
+					op.scale = (FloatType)1;
+					if (stride == 4 && p.type == PlyHeader::PLY_UCHAR) op.scale = (FloatType)1 / (FloatType)255;
+					if (stride == 4 && p.type == PlyHeader::PLY_USHORT) op.scale = (FloatType)1 / (FloatType)65535;
+					m_copyOps.push_back(op);
+				}
+				else if (properties != nullptr) {
+					auto prop = properties->find(n);
+					if (prop != properties->end()) {
+						RawOp op;
+						op.offset = m_vertexSize;
+						op.byteSize = p.byteSize;
+						op.destination = prop->second.data.data();
+						m_rawOps.push_back(op);
+					}
+				}
+				m_vertexSize += p.byteSize;
+			}
+		}
+
+		//! bytes of one vertex in the file
+		size_t getVertexSize() const {
+			return m_vertexSize;
+		}
+
+		//! decodes the vertices [first, first + count) from data, which holds them back to back
+		void decode(const BYTE* data, size_t first, size_t count) const {
+			for (size_t i = 0; i < count; i++) {
+				const BYTE* vertex = data + i * m_vertexSize;
+				const size_t index = first + i;
+				for (const CopyOp& op : m_copyOps) {
+					op.destination[index * op.stride] = plyReadScalar<FloatType>(vertex + op.offset, op.type, m_swapBytes) * op.scale;
+				}
+				for (const RawOp& op : m_rawOps) {
+					BYTE* destination = op.destination + index * op.byteSize;
+					for (unsigned int b = 0; b < op.byteSize; b++) {
+						destination[b] = vertex[op.offset + (m_swapBytes ? op.byteSize - 1 - b : b)];
+					}
+				}
+			}
+		}
+
+		//! decodes all vertices from the reader, a block at a time
+		template<class Reader>
+		void decode(Reader& reader, size_t numVertices) const {
+			if (m_vertexSize == 0) return;
+			const size_t verticesPerBlock = std::max(reader.getBlockSize() / m_vertexSize, (size_t)1);
+			for (size_t first = 0; first < numVertices; first += verticesPerBlock) {
+				const size_t count = std::min(verticesPerBlock, numVertices - first);
+				decode(reader.read(count * m_vertexSize), first, count);
+			}
+		}
+
+	private:
+		struct CopyOp {
+			unsigned int offset;
+			PlyHeader::PlyType type;
+			FloatType* destination;	//component of the first vertex
+			unsigned int stride;	//FloatTypes from one vertex's component to the next
+			FloatType scale;
+		};
+		struct RawOp {
+			unsigned int offset;
+			unsigned int byteSize;
+			BYTE* destination;
+		};
+
+		std::vector<CopyOp> m_copyOps;
+		std::vector<RawOp> m_rawOps;
+		size_t m_vertexSize;
+		bool m_swapBytes;
+	};
+
+	//! the face element of a binary PLY header compiled into ops: the vertex_indices (or vertex_index) list with any count
+	//! and index type is decoded, every other face property is skipped. Faces may be polygons of any valence.
+	class PlyFaceSchema {
+	public:
+		explicit PlyFaceSchema(const PlyHeader& header) {
+			m_swapBytes = plyNeedsByteSwap(header);
+			bool hasIndices = false;
+			auto it = header.m_properties.find("face");
+			if (it != header.m_properties.end()) {
+				for (const PlyHeader::PlyPropertyHeader& p : it->second) {
+					FaceOp op;
+					op.property = p;
+					op.isIndices = p.isList && (p.name == "vertex_indices" || p.name == "vertex_index") && !hasIndices;
+					if (op.isIndices) {
+						if (p.type == PlyHeader::PLY_FLOAT || p.type == PlyHeader::PLY_DOUBLE) throw MLIB_EXCEPTION("face indices must be integers");
+						hasIndices = true;
+					}
+					m_ops.push_back(op);
+				}
+			}
+			if (!hasIndices) throw MLIB_EXCEPTION("no face vertex indices found");
+		}
+
+		//! decodes numFaces faces from the reader and appends them to faces (a MeshData::Indices)
+		template<class Reader, class Indices>
+		void decode(Reader& reader, size_t numFaces, Indices& faces) const {
+			std::vector<unsigned int> face;
+			for (size_t i = 0; i < numFaces; i++) {
+				for (const FaceOp& op : m_ops) {
+					const PlyHeader::PlyPropertyHeader& p = op.property;
+					if (!p.isList) {
+						reader.read(p.byteSize);
+						continue;
+					}
+					const unsigned int count = plyReadScalar<unsigned int>(reader.read(p.listCountByteSize), p.listCountType, m_swapBytes);
+					const BYTE* items = reader.read(count * p.byteSize);
+					if (!op.isIndices) continue;
+					face.resize(count);
+					for (unsigned int j = 0; j < count; j++) {
+						face[j] = plyReadScalar<unsigned int>(items + j * p.byteSize, p.type, m_swapBytes);
+					}
+					faces.addFace(face.data(), count);
+				}
+			}
+		}
+
+	private:
+		struct FaceOp {
+			PlyHeader::PlyPropertyHeader property;
+			bool isIndices;
+		};
+
+		std::vector<FaceOp> m_ops;
+		bool m_swapBytes;
+	};
+
+	//! positions of the vertices of a mapped PLY file, read in place. Keeps the mapping alive.
+	template<class FloatType>
+	class PlyVertexView {
+	public:
+		PlyVertexView() : m_data(nullptr), m_stride(0), m_count(0) {}
+		PlyVertexView(const std::shared_ptr<MemoryMappedFile>& file, const BYTE* data, size_t stride, size_t count) : m_file(file), m_data(data), m_stride(stride), m_count(count) {}
+
+		size_t size() const {
+			return m_count;
+		}
+		//! works for any alignment of the file's vertices
+		vec3<FloatType> operator[](size_t i) const {
+			vec3<FloatType> v;
+			memcpy(v.array, m_data + i * m_stride, sizeof(v.array));
+			return v;
+		}
+		//! the vertices as an array, or nullptr if they have other properties in between or are not aligned for vec3
+		const vec3<FloatType>* getVertices() const {
+			if (m_stride != sizeof(vec3<FloatType>) || (size_t)m_data % std::alignment_of<vec3<FloatType>>::value != 0) return nullptr;
+			return (const vec3<FloatType>*)m_data;
+		}
+		const BYTE* getData() const {
+			return m_data;
+		}
+		size_t getStride() const {
+			return m_stride;
+		}
+
+	private:
+		std::shared_ptr<MemoryMappedFile> m_file;
+		const BYTE* m_data;
+		size_t m_stride;
+		size_t m_count;
+	};
+
+	//! a binary PLY file mapped into memory, with the header parsed from the mapping. If the vertices start with x, y, z of
+	//! FloatType in the machine's byte order, getVertexView exposes them without any copy; otherwise they are decoded from
+	//! getReader() with a PlyVertexSchema, which reads the mapped pages directly as well
+	class PlyMappedFile {
+	public:
+		explicit PlyMappedFile(const std::string& filename) : m_file(new MemoryMappedFile(filename)) {
+			const char* data = (const char*)m_file->getData();
+			const std::string end = "end_header";
+			const char* headerEnd = std::search(data, data + m_file->getSize(), end.begin(), end.end());
+			if (headerEnd == data + m_file->getSize()) throw MLIB_EXCEPTION("no ply header found in " + filename);
+			headerEnd = std::find(headerEnd, data + m_file->getSize(), '\n');
+			m_bodyOffset = (size_t)(headerEnd - data) + (headerEnd == data + m_file->getSize() ? 0 : 1);
+
+			std::istringstream header(std::string(data, m_bodyOffset));
+			m_header.read(header);
+		}
+
+		const PlyHeader& getHeader() const {
+			return m_header;
+		}
+		const std::shared_ptr<MemoryMappedFile>& getMapping() const {
+			return m_file;
+		}
+		//! starts at the first vertex
+		PlyMappedReader getReader() const {
+			return PlyMappedReader(*m_file, m_bodyOffset);
+		}
+
+		//! returns false and leaves view unchanged if the vertex layout does not allow reading positions in place
+		template<class FloatType>
+		bool getVertexView(PlyVertexView<FloatType>& view) const {
+			auto it = m_header.m_properties.find("vertex");
+			if (!m_header.m_bBinary || plyNeedsByteSwap(m_header) || it == m_header.m_properties.end() || it->second.size() < 3) return false;
+			const PlyHeader::PlyType type = std::is_same<FloatType, double>::value ? PlyHeader::PLY_DOUBLE : PlyHeader::PLY_FLOAT;
+			for (unsigned int i = 0; i < 3; i++) {
+				const PlyHeader::PlyPropertyHeader& p = it->second[i];
+				if (p.isList || p.type != type || p.byteSize != sizeof(FloatType) || p.name != std::string(1, (char)('x' + i))) return false;
+			}
+			const size_t stride = m_header.getElementSize("vertex");
+			if (stride == 0 || m_bodyOffset + stride * (size_t)m_header.m_numVertices > m_file->getSize()) return false;
+			view = PlyVertexView<FloatType>(m_file, m_file->getData() + m_bodyOffset, stride, m_header.m_numVertices);
+			return true;
+		}
+
+	private:
+		std::shared_ptr<MemoryMappedFile> m_file;
+		PlyHeader m_header;
+		size_t m_bodyOffset;
+	};
+
+} // namespace ml
+
+#endif
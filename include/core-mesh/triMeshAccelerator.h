@@ -25,25 +25,7 @@ public:
 	}
 
 	void build(const std::vector<const TriMesh<FloatType>* >& triMeshes, bool storeLocalCopy = false) {
-		destroy();
-		std::vector<const std::vector<typename TriMesh<FloatType>::Vertex>*> vertices(triMeshes.size());
-		std::vector<const std::vector<vec3ui>*> indices(triMeshes.size());
-
-		if (storeLocalCopy) {
-			m_VerticesCopy.resize(triMeshes.size());
-			for (size_t i = 0; i < triMeshes.size(); i++) {
-				m_VerticesCopy[i] = triMeshes[i]->getVertices();
-				vertices[i] = &m_VerticesCopy[i];
-				indices[i] = &triMeshes[i]->getIndices();
-			}
-		} else {
-			for (size_t i = 0; i < triMeshes.size(); i++) {
-				vertices[i] = &triMeshes[i]->getVertices();
-				indices[i] = &triMeshes[i]->getIndices();
-			}
-		}
-		createTrianglePointers(vertices, indices);
-
+		createTriangles(triMeshes, storeLocalCopy);
 		buildInternal();	//construct the acceleration structure
 	}
 
@@ -80,6 +62,38 @@ public:
 		return m_Triangles.size();
 	}
 
+	//! bounds of all triangles at their current vertex positions
+	BoundingBox3<FloatType> computeBoundingBox() const {
+		BoundingBox3<FloatType> bb;
+		for (const auto& tri : m_Triangles) {
+			tri.includeInBoundingBox(bb);
+		}
+		return bb;
+	}
+
+	//! replaces the vertex positions of the local copy made by build(..., true) or by the transformed build with those of triMeshes,
+	//! which must have the same vertex counts as the meshes that were built (the positions are taken as they are, without transform).
+	//! Without a local copy, the triangles reference the meshes' own vertices, so changing those in place replaces this call.
+	//! Either way, the ray queries of accelerators that keep bounds or triangle blocks (the BVHs) only see the new positions
+	//! after refit(); the brute force accelerator and the collision queries read the vertices directly.
+	void updateVertices(const std::vector<const TriMesh<FloatType>* >& triMeshes) {
+		if (m_VerticesCopy.empty()) throw MLIB_EXCEPTION("updateVertices requires a local vertex copy");
+		if (triMeshes.size() != m_VerticesCopy.size()) throw MLIB_EXCEPTION("mesh count differs from the build");
+		for (size_t m = 0; m < triMeshes.size(); m++) {
+			const std::vector<typename TriMesh<FloatType>::Vertex>& vertices = triMeshes[m]->getVertices();
+			if (vertices.size() != m_VerticesCopy[m].size()) throw MLIB_EXCEPTION("vertex count of mesh " + std::to_string(m) + " differs from the build");
+			for (size_t i = 0; i < vertices.size(); i++) {
+				m_VerticesCopy[m][i].position = vertices[i].position;
+			}
+		}
+	}
+
+	void updateVertices(const TriMesh<FloatType>& mesh) {
+		std::vector<const TriMesh<FloatType>* > meshes;
+		meshes.push_back(&mesh);
+		updateVertices(meshes);
+	}
+
 protected:
 
 	//template <class FloatType = FloatType> using Vertex = typename TriMesh<FloatType>::Vertex;
@@ -89,6 +103,28 @@ protected:
 	std::vector<typename TriMesh<FloatType>::Triangle>				m_Triangles;
 	std::vector<typename TriMesh<FloatType>::Triangle*>				m_TrianglePointers;
 
+	//! creates the triangles of triMeshes in mesh order without building, for accelerators that restore their structure otherwise
+	void createTriangles(const std::vector<const TriMesh<FloatType>* >& triMeshes, bool storeLocalCopy) {
+		destroy();
+		std::vector<const std::vector<typename TriMesh<FloatType>::Vertex>*> vertices(triMeshes.size());
+		std::vector<const std::vector<vec3ui>*> indices(triMeshes.size());
+
+		if (storeLocalCopy) {
+			m_VerticesCopy.resize(triMeshes.size());
+			for (size_t i = 0; i < triMeshes.size(); i++) {
+				m_VerticesCopy[i] = triMeshes[i]->getVertices();
+				vertices[i] = &m_VerticesCopy[i];
+				indices[i] = &triMeshes[i]->getIndices();
+			}
+		} else {
+			for (size_t i = 0; i < triMeshes.size(); i++) {
+				vertices[i] = &triMeshes[i]->getVertices();
+				indices[i] = &triMeshes[i]->getIndices();
+			}
+		}
+		createTrianglePointers(vertices, indices);
+	}
+
 private:
 
 	//! takes a vector of meshes: including vertices and indices
@@ -5,12 +5,62 @@
 
 namespace ml {
 
+//! how TriMeshAcceleratorBVH partitions the triangles of a node
+enum TriMeshBVHBuildStrategy {
+	TriMeshBVHBuildMedian,		//object median along a round-robin axis, built level by level
+	TriMeshBVHBuildMidPoint,	//spatial midpoint of the longest centroid axis
+	TriMeshBVHBuildSAH,			//binned surface area heuristic
+	TriMeshBVHBuildLBVH			//linear BVH from Morton codes of the centers; fastest build, lower quality
+};
+
+struct TriMeshBVHBuildOptions {
+	TriMeshBVHBuildOptions() {
+		strategy = TriMeshBVHBuildMedian;
+		binCount = 16;
+		traversalCost = 1.0f;
+		intersectionCost = 1.0f;
+		parallelSubtreeSize = 4096;
+		maxLeafSize = 1;
+		mortonCodeBits = 30;
+		treeletSize = 0;
+	}
+
+	TriMeshBVHBuildStrategy strategy;
+	//! number of centroid bins per axis for TriMeshBVHBuildSAH
+	unsigned int binCount;
+	//! relative costs of visiting a node and of intersecting a triangle; used by the SAH split and by getSAHCost
+	float traversalCost;
+	float intersectionCost;
+	//! TriMeshBVHBuildSAH builds subtrees with at least this many triangles as separate tasks on the global ThreadPool, and refit()
+	//! splits the tree into subtrees of at least this many nodes that are refit in parallel; 0 builds and refits serially
+	size_t parallelSubtreeSize;
+	//! maximum number of triangles per leaf. The median and midpoint builds split until a node fits, the SAH build also
+	//! stops earlier if a leaf is cheaper than the best split
+	size_t maxLeafSize;
+	//! TriMeshBVHBuildLBVH: 30 (10 bits per axis) or 63 (21 bits per axis); more bits separate close centers in large scenes
+	unsigned int mortonCodeBits;
+	//! TriMeshBVHBuildLBVH: if at least 3, every subtree is restructured afterwards by choosing the SAH-optimal topology for
+	//! a treelet of this many nodes (at most 8; 7 is a good trade-off), bottom-up; 0 keeps the tree as built
+	unsigned int treeletSize;
+};
+
+//! node of the tree while it is being built; TriMeshAcceleratorBVH flattens it into TriangleBVHFlatNodes afterwards
 template <class FloatType>
 struct TriangleBVHNode {
-	TriangleBVHNode() : rChild(0), lChild(0), leafTri(0) {}
+	TriangleBVHNode() : rChild(0), lChild(0), leafTris(0), leafCount(0), sahCost(0) {}
+	//! deletes the subtree with an explicit stack, so deep trees cannot overflow the call stack
 	~TriangleBVHNode() {
-		SAFE_DELETE(rChild);
-		SAFE_DELETE(lChild);
+		std::vector<TriangleBVHNode*> pending;
+		if (lChild) pending.push_back(lChild);
+		if (rChild) pending.push_back(rChild);
+		while (!pending.empty()) {
+			TriangleBVHNode* node = pending.back();
+			pending.pop_back();
+			if (node->lChild) pending.push_back(node->lChild);
+			if (node->rChild) pending.push_back(node->rChild);
+			node->lChild = node->rChild = nullptr;
+			delete node;
+		}
 	}
 
 	//wait for vs 2013
@@ -18,7 +68,11 @@ struct TriangleBVHNode {
 	//using Triangle = TriMesh::Triangle<T>;
 
 	BoundingBox3<FloatType> boundingBox;
-	const typename TriMesh<FloatType>::Triangle* leafTri;
+	//! triangles of a leaf, a range of the array that is being partitioned
+	typename TriMesh<FloatType>::Triangle* const* leafTris;
+	size_t leafCount;
+	//! SAH cost of the subtree (not normalized by the root area); only maintained by the treelet optimization
+	FloatType sahCost;
 
 
 	TriangleBVHNode<FloatType> *lChild;
@@ -28,7 +82,9 @@ struct TriangleBVHNode {
 		boundingBox.reset();
 		
 		if (!lChild && !rChild) {
-			leafTri->includeInBoundingBox(boundingBox);
+			for (size_t i = 0; i < leafCount; i++) {
+				leafTris[i]->includeInBoundingBox(boundingBox);
+			}
 		} else {
 			if (lChild)	{
 				lChild->computeBoundingBox();
@@ -41,8 +97,13 @@ struct TriangleBVHNode {
 		}
 	}
 
-	void splitMidPoint(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator& begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator& end) {
-		if (end - begin > 1) {
+	void setLeaf(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator end) {
+		leafTris = &*begin;
+		leafCount = end - begin;
+	}
+
+	void splitMidPoint(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator end, size_t maxLeafSize = 1) {
+		if ((size_t)(end - begin) > std::max(maxLeafSize, (size_t)1)) {
 			//determine longest axis
 			BoundingBox3<FloatType> bbox;
 			for (auto iter = begin; iter != end; iter++) {
@@ -79,19 +140,19 @@ struct TriangleBVHNode {
 			lChild = new TriangleBVHNode;
 			rChild = new TriangleBVHNode;
 
-			lChild->splitMidPoint(begin, midIter);
-			rChild->splitMidPoint(midIter, end);
+			lChild->splitMidPoint(begin, midIter, maxLeafSize);
+			rChild->splitMidPoint(midIter, end, maxLeafSize);
 
 		}
 		else {
-			assert(end - begin == 1);
-			leafTri = *begin;	//found a leaf
+			assert(end - begin >= 1);
+			setLeaf(begin, end);	//found a leaf
 		}
 	}
 
-	void splitMedian(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator& begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator& end, unsigned int lastSortAxis) {
+	void splitMedian(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator end, unsigned int lastSortAxis, size_t maxLeafSize = 1) {
 
-		if (end - begin > 1) {
+		if ((size_t)(end - begin) > std::max(maxLeafSize, (size_t)1)) {
 			if (lastSortAxis == 0)		std::stable_sort(begin, end, cmpX);
 			else if (lastSortAxis == 1)	std::stable_sort(begin, end, cmpY);
 			else						std::stable_sort(begin, end, cmpZ);
@@ -100,138 +161,126 @@ struct TriangleBVHNode {
 			rChild = new TriangleBVHNode;
 
 			const unsigned int newSortAxis = (lastSortAxis + 1) % 3;
-			lChild->splitMedian(begin, begin + ((end - begin) / 2), newSortAxis);
-			rChild->splitMedian(begin + ((end - begin) / 2), end, newSortAxis);
+			lChild->splitMedian(begin, begin + ((end - begin) / 2), newSortAxis, maxLeafSize);
+			rChild->splitMedian(begin + ((end - begin) / 2), end, newSortAxis, maxLeafSize);
 
 		}
 		else {
-			assert(end - begin == 1);
-			leafTri = *begin;	//found a leaf
+			assert(end - begin >= 1);
+			setLeaf(begin, end);	//found a leaf
 		}
 	}
 
-	inline bool isLeaf() const {
-		return !(lChild || rChild);
-	}
+	void splitSAH(typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator begin, typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator end, const TriMeshBVHBuildOptions& options) {
+		const size_t count = end - begin;
+		if (count == 0) return;
+		if (count == 1) {
+			setLeaf(begin, end);	//found a leaf
+			return;
+		}
 
-	const typename TriMesh<FloatType>::Triangle* intersect(const Ray<FloatType> &r, FloatType& t, FloatType& u, FloatType& v, FloatType& tmin, FloatType& tmax, bool onlyFrontFaces = false) const {
-		if (t < tmin || t > tmax)	return nullptr;	//early out (warning t must be initialized)
-		if (boundingBox.intersect(r, tmin, tmax)) {
-			if (isLeaf()) {
-				if (leafTri->intersect(r, t, u, v, tmin, tmax, onlyFrontFaces))	{
-					tmax = t;
-					return leafTri;
-				}
-			} else {
-				const typename TriMesh<FloatType>::Triangle* t0 = lChild->intersect(r, t, u, v, tmin, tmax, onlyFrontFaces);
-				const typename TriMesh<FloatType>::Triangle* t1 = rChild->intersect(r, t, u, v, tmin, tmax, onlyFrontFaces);
-				if (t1)	return t1;
-				if (t0)	return t0;
+		BoundingBox3<FloatType> nodeBox, centerBox;
+		for (auto iter = begin; iter != end; iter++) {
+			(*iter)->includeInBoundingBox(nodeBox);
+			centerBox.include((*iter)->getCenter());
+		}
+
+		//bin the triangles by their centers along every axis and sweep the bin boundaries for the cheapest split
+		const unsigned int binCount = std::max(options.binCount, 2u);
+		std::vector<BoundingBox3<FloatType>> binBoxes(binCount), rightBoxes(binCount);
+		std::vector<size_t> binCounts(binCount);
+
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		FloatType bestCost = std::numeric_limits<FloatType>::max();
+		for (unsigned int axis = 0; axis < 3; axis++) {
+			const FloatType minCenter = centerBox.getMin()[axis];
+			const FloatType extent = centerBox.getMax()[axis] - minCenter;
+			if (extent <= (FloatType)0) continue;
+			const FloatType binScale = (FloatType)binCount / extent;
+
+			for (unsigned int bin = 0; bin < binCount; bin++) {
+				binBoxes[bin].reset();
+				binCounts[bin] = 0;
+			}
+			for (auto iter = begin; iter != end; iter++) {
+				const unsigned int bin = getSAHBin((*iter)->getCenter()[axis], minCenter, binScale, binCount);
+				(*iter)->includeInBoundingBox(binBoxes[bin]);
+				binCounts[bin]++;
 			}
-		} 
-		return nullptr;
-	}
 
-    // collisions with other Triangles
-	bool intersects(const typename TriMesh<FloatType>::Triangle* tri) const {
-		if (boundingBox.intersects(tri->getV0().position, tri->getV1().position, tri->getV2().position)) {
-			if (isLeaf()) {
-				return tri->intersects(*leafTri);
-			} else {
-				return lChild->intersects(tri) || rChild->intersects(tri);
+			BoundingBox3<FloatType> box;
+			for (unsigned int bin = binCount - 1; bin > 0; bin--) {
+				box.include(binBoxes[bin]);
+				rightBoxes[bin] = box;
 			}
-		} else {
-			return false;
-		}
-	}
-    bool intersects(const typename TriMesh<FloatType>::Triangle* tri, const Matrix4x4<FloatType>& transform) const {
-
-        typename TriMesh<FloatType>::Vertex v0(transform * tri->getV0().position);
-        typename TriMesh<FloatType>::Vertex v1(transform * tri->getV1().position);
-        typename TriMesh<FloatType>::Vertex v2(transform * tri->getV2().position);
-        typename TriMesh<FloatType>::Triangle triTrans(&v0,&v1,&v2);
-
-        if (boundingBox.intersects(triTrans.getV0().position, triTrans.getV1().position, triTrans.getV2().position)) {
-            if (isLeaf()) {
-                return triTrans.intersects(*leafTri);
-            }
-            else {
-                return lChild->intersects(&triTrans) || rChild->intersects(&triTrans);
-            }
-        }
-        else {
-            return false;
-        }
-    }
-    
-    // collisions with other TriangleBVHNodes
-	bool intersects(const TriangleBVHNode& other) const {
-		if (boundingBox.intersects(other.boundingBox)) {
-			if (isLeaf()) {
-				return other.intersects(leafTri);
-			} else {
-				return lChild->intersects(other) || rChild->intersects(other);
+
+			//a split after bin puts bins [0, bin] to the left
+			box.reset();
+			size_t leftCount = 0;
+			for (unsigned int bin = 0; bin + 1 < binCount; bin++) {
+				box.include(binBoxes[bin]);
+				leftCount += binCounts[bin];
+				const size_t rightCount = count - leftCount;
+				if (leftCount == 0 || rightCount == 0) continue;
+
+				const FloatType cost = box.getSurfaceArea() * leftCount + rightBoxes[bin + 1].getSurfaceArea() * rightCount;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
 			}
-		} else {
-			return false;
-		}
-	}
-
-    bool intersects(const TriangleBVHNode& other, const Matrix4x4<FloatType>& transform) const {
-        if (boundingBox.intersects(other.boundingBox * transform)) { //TODO fix OBB
-            if (isLeaf()) {
-                return other.intersects(leafTri, transform.getInverse());
-            }
-            else {
-                return lChild->intersects(other, transform) || rChild->intersects(other, transform);
-            }
-        }
-        else {
-            return false;
-        }
-    }
-
-    bool collisionBBoxOnly(const TriangleBVHNode& other, const Matrix4x4<FloatType>& transform) const {
-        if (boundingBox.intersects(other.boundingBox * transform)) { //TODO fix OBB
-            if (isLeaf()) {
-                return true;
-            }
-            else {
-                return lChild->collisionBBoxOnly(other, transform) || rChild->collisionBBoxOnly(other, transform);
-            }
-        }
-        else {
-            return false;
-        }
-    }
-
-
-
-	unsigned int getTreeDepthRec() const {
-		unsigned int maxDepth = 0;
-		if (lChild)	maxDepth = std::max(maxDepth, lChild->getTreeDepthRec());	
-		if (rChild) maxDepth = std::max(maxDepth, rChild->getTreeDepthRec());
-		return maxDepth+1;
-	}
-
-	unsigned int getNumNodesRec() const {
-		unsigned int numNodes = 1;
-		if (lChild)	numNodes += lChild->getNumNodesRec();	
-		if (rChild) numNodes += rChild->getNumNodesRec();
-		return numNodes;
-	}
-
-	unsigned int getNumLeaves() const {
-		unsigned int numLeaves = 0;
-		if (lChild) numLeaves += lChild->getNumLeaves();
-		if (rChild) numLeaves += rChild->getNumLeaves();
-		if (!lChild && !rChild) {
-			assert(leafTri);
-			numLeaves++;
 		}
-		return numLeaves;
+
+		//a small node becomes a leaf if intersecting all of its triangles is cheaper than descending
+		const size_t maxLeafSize = std::max(options.maxLeafSize, (size_t)1);
+		if (count <= maxLeafSize) {
+			const FloatType nodeArea = nodeBox.getSurfaceArea();
+			const FloatType leafCost = (FloatType)options.intersectionCost * count;
+			const FloatType splitCost = nodeArea > (FloatType)0 ? (FloatType)options.traversalCost + (FloatType)options.intersectionCost * bestCost / nodeArea : leafCost;
+			if (bestAxis < 0 || leafCost <= splitCost) {
+				setLeaf(begin, end);
+				return;
+			}
+		}
+
+		typename std::vector<typename TriMesh<FloatType>::Triangle*>::iterator midIter;
+		if (bestAxis >= 0) {
+			const FloatType minCenter = centerBox.getMin()[bestAxis];
+			const FloatType binScale = (FloatType)binCount / (centerBox.getMax()[bestAxis] - minCenter);
+			midIter = std::partition(begin, end, [&](const typename TriMesh<FloatType>::Triangle* tri) {
+				return getSAHBin(tri->getCenter()[bestAxis], minCenter, binScale, binCount) <= bestBin;
+			});
+		}
+		else {
+			//all centers coincide; any split is as good as another
+			midIter = begin + (end - begin) / 2;
+		}
+
+		lChild = new TriangleBVHNode;
+		rChild = new TriangleBVHNode;
+
+		if (options.parallelSubtreeSize > 0 && (size_t)(end - begin) >= options.parallelSubtreeSize) {
+			TriangleBVHNode *left = lChild;
+			TaskFuture<void> leftDone = ThreadPool::getGlobal().submit([=, &options]() { left->splitSAH(begin, midIter, options); });
+			rChild->splitSAH(midIter, end, options);
+			leftDone.get();
+		}
+		else {
+			lChild->splitSAH(begin, midIter, options);
+			rChild->splitSAH(midIter, end, options);
+		}
+	}
+
+	inline bool isLeaf() const {
+		return !(lChild || rChild);
 	}
 
+	static unsigned int getSAHBin(FloatType center, FloatType minCenter, FloatType binScale, unsigned int binCount) {
+		const int bin = (int)((center - minCenter) * binScale);
+		return (unsigned int)math::clamp(bin, 0, (int)binCount - 1);
+	}
 
 	static bool cmpX(typename TriMesh<FloatType>::Triangle *t0, typename TriMesh<FloatType>::Triangle *t1) {
 		return t0->getCenter().x < t1->getCenter().x;
@@ -246,16 +295,228 @@ struct TriangleBVHNode {
 	}
 };
 
+//! node of the linearized tree. Nodes are stored in depth-first order, so the first child of an inner node is the next node.
+//! Indices are as wide as the bounds components, which keeps a node at 32 bytes for float and 64 bytes for double.
+template <class FloatType>
+struct TriangleBVHFlatNode {
+	typedef typename std::conditional<sizeof(FloatType) == 8, UINT64, UINT32>::type IndexType;
+
+	BoundingBox3<FloatType> boundingBox;
+	//! inner node: index of the second child; leaf: first triangle in the accelerator's triangle order
+	IndexType offset;
+	//! number of triangles; 0 for inner nodes
+	IndexType count;
+
+	inline bool isLeaf() const {
+		return count > 0;
+	}
+};
+
+//! the flat nodes of a TriMeshAcceleratorBVH: either owned, or used in place from a memory-mapped tree file, which stays mapped as
+//! long as the nodes refer to it. Mapped nodes are copy-on-write, so refitting them only duplicates the pages that change
+template <class FloatType>
+class TriangleBVHFlatNodeArray {
+public:
+	typedef TriangleBVHFlatNode<FloatType> Node;
+
+	TriangleBVHFlatNodeArray() : m_Data(nullptr), m_Size(0) {}
+	TriangleBVHFlatNodeArray(const TriangleBVHFlatNodeArray& other) : m_Owned(other.begin(), other.end()) {
+		m_Data = m_Owned.data();
+		m_Size = m_Owned.size();
+	}
+	TriangleBVHFlatNodeArray& operator=(const TriangleBVHFlatNodeArray& other) {
+		if (this != &other) {
+			m_Mapping.reset();
+			m_Owned.assign(other.begin(), other.end());
+			m_Data = m_Owned.data();
+			m_Size = m_Owned.size();
+		}
+		return *this;
+	}
+
+	//! uses count nodes at data, which must lie in mapping
+	void assign(const std::shared_ptr<MemoryMappedFile>& mapping, Node* data, size_t count) {
+		m_Owned.clear();
+		m_Mapping = mapping;
+		m_Data = data;
+		m_Size = count;
+	}
+	//! switches back to owned nodes
+	void clear() {
+		m_Mapping.reset();
+		m_Owned.clear();
+		m_Data = m_Owned.data();
+		m_Size = 0;
+	}
+	//! the following expect owned nodes, i.e., clear() after assign()
+	void reserve(size_t count) {
+		m_Owned.reserve(count);
+		m_Data = m_Owned.data();
+	}
+	void resize(size_t count) {
+		m_Owned.resize(count);
+		m_Data = m_Owned.data();
+		m_Size = m_Owned.size();
+	}
+	void push_back(const Node& node) {
+		m_Owned.push_back(node);
+		m_Data = m_Owned.data();
+		m_Size = m_Owned.size();
+	}
+
+	//! exchanges the nodes, including their mappings
+	void swap(TriangleBVHFlatNodeArray& other) {
+		m_Owned.swap(other.m_Owned);
+		m_Mapping.swap(other.m_Mapping);
+		std::swap(m_Data, other.m_Data);
+		std::swap(m_Size, other.m_Size);
+	}
+
+	bool isMapped() const {
+		return m_Mapping != nullptr;
+	}
+	size_t size() const {
+		return m_Size;
+	}
+	bool empty() const {
+		return m_Size == 0;
+	}
+	Node& operator[](size_t i) {
+		return m_Data[i];
+	}
+	const Node& operator[](size_t i) const {
+		return m_Data[i];
+	}
+	Node* data() {
+		return m_Data;
+	}
+	const Node* data() const {
+		return m_Data;
+	}
+	const Node* begin() const {
+		return m_Data;
+	}
+	const Node* end() const {
+		return m_Data + m_Size;
+	}
+
+private:
+	std::vector<Node, AlignedAllocator<Node, 32>> m_Owned;
+	std::shared_ptr<MemoryMappedFile> m_Mapping;
+	Node* m_Data;
+	size_t m_Size;
+};
+
+//! layout of a saved TriMeshAcceleratorBVH: this header, nodeCount nodes (at byte 64, so they keep their alignment in a mapped
+//! file), and for every triangle in leaf order its mesh index and its triangle index within that mesh (two UINT32)
+struct TriangleBVHFileHeader {
+	static const UINT32 magicNumber = 0x4856424d;	//"MBVH"
+	static const UINT32 currentVersion = 1;
+
+	UINT32 magic;
+	UINT32 version;
+	UINT32 floatSize;
+	UINT32 nodeSize;
+	//! TriMeshAcceleratorBVH::computeSourceHash of the meshes the tree was built over
+	UINT64 sourceHash;
+	UINT64 nodeCount;
+	UINT64 triangleCount;
+	double buildSAHCost;
+	UINT32 depth;
+	UINT32 reserved[3];
+};
+
+//! the tests of a region that TriMeshAcceleratorBVH::forEachOverlapping needs: intersects(box) may accept boxes that do not touch
+//! the region, contains(box) may reject boxes that lie inside it, and intersects(p0, p1, p2) decides for a triangle.
+//! Sphere and Frustum provide them; BoundingBox3 and OrientedBoundingBox3 are adapted below
+template <class Region, class FloatType>
+struct TriangleBVHRegion {
+	explicit TriangleBVHRegion(const Region& r) : region(r) {}
+
+	bool intersects(const BoundingBox3<FloatType>& box) const {
+		return region.intersects(box);
+	}
+	bool contains(const BoundingBox3<FloatType>& box) const {
+		return region.contains(box);
+	}
+	bool intersects(const vec3<FloatType>& p0, const vec3<FloatType>& p1, const vec3<FloatType>& p2) const {
+		return region.intersects(p0, p1, p2);
+	}
+
+	const Region& region;
+};
+
+template <class FloatType>
+struct TriangleBVHRegion<BoundingBox3<FloatType>, FloatType> {
+	explicit TriangleBVHRegion(const BoundingBox3<FloatType>& r) : region(r) {}
+
+	bool intersects(const BoundingBox3<FloatType>& box) const {
+		return region.intersects(box);
+	}
+	bool contains(const BoundingBox3<FloatType>& box) const {
+		return region.intersects(box.getMin()) && region.intersects(box.getMax());
+	}
+	bool intersects(const vec3<FloatType>& p0, const vec3<FloatType>& p1, const vec3<FloatType>& p2) const {
+		return region.intersects(p0, p1, p2);
+	}
+
+	const BoundingBox3<FloatType>& region;
+};
+
+//! the triangles are tested in the frame of the box, where it is the unit cube
+template <class FloatType>
+struct TriangleBVHRegion<OrientedBoundingBox3<FloatType>, FloatType> {
+	explicit TriangleBVHRegion(const OrientedBoundingBox3<FloatType>& r) : region(r), worldToBox(r.getWorldToOBB()) {
+		for (const vec3<FloatType>& corner : r.getVertices()) bounds.include(corner);
+	}
+
+	bool intersects(const BoundingBox3<FloatType>& box) const {
+		if (!bounds.intersects(box)) return false;
+		vec3<FloatType> corners[8];
+		box.getVertices(corners);
+		BoundingBox3<FloatType> local;
+		for (unsigned int i = 0; i < 8; i++) local.include(worldToBox * corners[i]);
+		return local.intersects(unitCube());
+	}
+	bool contains(const BoundingBox3<FloatType>& box) const {
+		vec3<FloatType> corners[8];
+		box.getVertices(corners);
+		for (unsigned int i = 0; i < 8; i++) {
+			if (!unitCube().intersects(worldToBox * corners[i])) return false;
+		}
+		return true;
+	}
+	bool intersects(const vec3<FloatType>& p0, const vec3<FloatType>& p1, const vec3<FloatType>& p2) const {
+		return unitCube().intersects(worldToBox * p0, worldToBox * p1, worldToBox * p2);
+	}
+
+	static BoundingBox3<FloatType> unitCube() {
+		return BoundingBox3<FloatType>(vec3<FloatType>::origin, vec3<FloatType>((FloatType)1, (FloatType)1, (FloatType)1));
+	}
+
+	const OrientedBoundingBox3<FloatType>& region;
+	Matrix4x4<FloatType> worldToBox;
+	BoundingBox3<FloatType> bounds;
+};
+
 template <class FloatType>
 class TriMeshAcceleratorBVH : public TriMeshRayAccelerator<FloatType>, public TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBVH<FloatType>>
 {
 public:
+	typedef TriangleBVHFlatNode<FloatType> Node;
 
 	TriMeshAcceleratorBVH() {
-		m_Root = nullptr;
+		m_Depth = 0;
+		m_BuildSAHCost = (FloatType)0;
+	}
+	explicit TriMeshAcceleratorBVH(const TriMeshBVHBuildOptions& options) {
+		m_Depth = 0;
+		m_BuildSAHCost = (FloatType)0;
+		m_Options = options;
 	}
 	TriMeshAcceleratorBVH(const TriMesh<FloatType>& triMesh, bool storeLocalCopy = false) {
-		m_Root = nullptr;
+		m_Depth = 0;
+		m_BuildSAHCost = (FloatType)0;
 		build(triMesh, storeLocalCopy);
 		
 		//std::vector<const TriMesh<FloatType>*> meshes;
@@ -267,52 +528,1001 @@ public:
 		//build(meshes);
 
 	}
+	TriMeshAcceleratorBVH(const TriMesh<FloatType>& triMesh, const TriMeshBVHBuildOptions& options, bool storeLocalCopy = false) {
+		m_Depth = 0;
+		m_BuildSAHCost = (FloatType)0;
+		m_Options = options;
+		this->build(triMesh, storeLocalCopy);
+	}
+
+	//! updates the bounds of all nodes after the vertices moved but the triangles stayed the same (e.g., an animated or deforming
+	//! mesh): either the meshes were built without a local copy and changed in place, or updateVertices() was called. The tree
+	//! topology is kept; disjoint subtrees are refit in parallel on the global ThreadPool.
+	//! If rebuildThreshold > 0 and the SAH cost grew beyond rebuildThreshold times the cost after the last build, the tree is
+	//! rebuilt instead; returns true in that case
+	bool refit(FloatType rebuildThreshold = (FloatType)0) {
+		if (m_Nodes.empty()) return false;
+		refitNodes();
+		if (rebuildThreshold > (FloatType)0 && getSAHCost() > rebuildThreshold * m_BuildSAHCost) {
+			buildInternal();
+			return true;
+		}
+		this->updateTriangleBlocks();
+		refitInternal();
+		return false;
+	}
+
+	//! SAH cost of the tree right after the last build, the reference of refit's rebuild threshold
+	FloatType getBuildSAHCost() const {
+		return m_BuildSAHCost;
+	}
 
-	~TriMeshAcceleratorBVH() {
-		SAFE_DELETE(m_Root);
+	//! takes effect with the next build()
+	void setBuildOptions(const TriMeshBVHBuildOptions& options) {
+		m_Options = options;
+	}
+	const TriMeshBVHBuildOptions& getBuildOptions() const {
+		return m_Options;
+	}
+
+	//! expected cost of a random ray relative to the root box, using the traversal and intersection costs of the build options;
+	//! lower is better and allows comparing trees built with different strategies
+	FloatType getSAHCost() const {
+		if (m_Nodes.empty()) return (FloatType)0;
+		const FloatType rootArea = m_Nodes[0].boundingBox.getSurfaceArea();
+		if (rootArea <= (FloatType)0) return (FloatType)0;
+
+		FloatType cost = (FloatType)0;
+		for (const Node& node : m_Nodes) {
+			const FloatType nodeCost = node.isLeaf() ? (FloatType)m_Options.intersectionCost * node.count : (FloatType)m_Options.traversalCost;
+			cost += node.boundingBox.getSurfaceArea() * nodeCost;
+		}
+		return cost / rootArea;
 	}
 
+	const TriangleBVHFlatNodeArray<FloatType>& getNodes() const {
+		return m_Nodes;
+	}
+	unsigned int getTreeDepth() const {
+		return m_Depth;
+	}
+	size_t getMemoryUsage() const {
+		return TriMeshRayAccelerator<FloatType>::getMemoryUsage() + m_Nodes.size() * sizeof(Node);
+	}
+	size_t getLeafCount() const {
+		size_t leafCount = 0;
+		for (const Node& node : m_Nodes) {
+			if (node.isLeaf()) leafCount++;
+		}
+		return leafCount;
+	}
 	
 	void printInfo() const {
 		std::cout << "Info: TriangleBVHAccelerator build done ( " << TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size() << " tris )" << std::endl;
-		std::cout << "Info: Tree depth " << m_Root->getTreeDepthRec() << std::endl;
-		std::cout << "Info: NumNodes " << m_Root->getNumNodesRec() << std::endl;
-		std::cout << "Info: NumLeaves " << m_Root->getNumLeaves() << std::endl;
+		std::cout << "Info: Tree depth " << m_Depth << std::endl;
+		std::cout << "Info: NumNodes " << m_Nodes.size() << std::endl;
+		std::cout << "Info: NumLeaves " << getLeafCount() << " ( max " << std::max(m_Options.maxLeafSize, (size_t)1) << " tris per leaf, "
+			<< (double)TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size() / std::max(getLeafCount(), (size_t)1) << " on average )" << std::endl;
+		std::cout << "Info: SAH cost " << getSAHCost() << std::endl;
+	}
+
+	//! result of a closest-point query: t is the distance to the query point, and u, v are the barycentric coordinates of the
+	//! closest point on the triangle, so the surface getters return its position and attributes
+	struct ClosestPoint : public TriMeshRayAccelerator<FloatType>::Intersection
+	{
+		FloatType getDistance() const {
+			return this->t;
+		}
+	};
+
+	//! closest point on any triangle to p within maxDist; the result is invalid if no triangle is that close. Of equally
+	//! distant triangles the one stored first is returned, so the result does not depend on the traversal
+	ClosestPoint closestPoint(const vec3<FloatType>& p, FloatType maxDist = std::numeric_limits<FloatType>::max()) const {
+		ClosestPoint result;
+		closestPoint(p, result, maxDist);
+		return result;
+	}
+
+	bool closestPoint(const vec3<FloatType>& p, ClosestPoint& result, FloatType maxDist = std::numeric_limits<FloatType>::max()) const {
+		const FloatType maxDistSq = maxDist < std::sqrt(std::numeric_limits<FloatType>::max()) ? maxDist * maxDist : std::numeric_limits<FloatType>::max();
+		closestPointInternal(p, maxDistSq, nullptr, result);
+		return result.isValid();
+	}
+
+	//! closest points of a batch of query points; results[i] is identical to closestPoint(points[i], maxDist). Consecutive points
+	//! are distributed over the global ThreadPool in windows; within a window, the triangle found for the previous point bounds the
+	//! search of the next one, which prunes most of the tree if the points are coherent (e.g., samples of another surface)
+	void closestPoint(const vec3<FloatType>* points, size_t count, ClosestPoint* results, FloatType maxDist = std::numeric_limits<FloatType>::max()) const {
+		if (count == 0) return;
+		const FloatType maxDistSq = maxDist < std::sqrt(std::numeric_limits<FloatType>::max()) ? maxDist * maxDist : std::numeric_limits<FloatType>::max();
+		const size_t windowSize = 256;
+		const size_t windowCount = (count + windowSize - 1) / windowSize;
+		parallelFor(0, windowCount, 1, [&](size_t window) {
+			const size_t end = std::min(count, (window + 1) * windowSize);
+			const typename TriMesh<FloatType>::Triangle* previous = nullptr;
+			for (size_t i = window * windowSize; i < end; i++) {
+				closestPointInternal(points[i], maxDistSq, previous, results[i]);
+				if (results[i].isValid()) previous = results[i].triangle;
+			}
+		});
 	}
+
+	void closestPoint(const std::vector<vec3<FloatType>>& points, std::vector<ClosestPoint>& results, FloatType maxDist = std::numeric_limits<FloatType>::max()) const {
+		results.resize(points.size());
+		closestPoint(points.data(), points.size(), results.data(), maxDist);
+	}
+
+	//! calls callback(triangle) for every triangle that overlaps region, in storage order. The region is a BoundingBox3, an
+	//! OrientedBoundingBox3, a Sphere or a Frustum (e.g., Frustum<FloatType>(camera.getViewProj()) for the triangles in view).
+	//! Subtrees whose boxes lie inside the region are reported without testing their triangles
+	template <class Region, class Callback>
+	void forEachOverlapping(const Region& region, Callback callback) const {
+		if (m_Nodes.empty()) return;
+		const TriangleBVHRegion<Region, FloatType> test(region);
+		forEachOverlappingInternal(test, 0, callback);
+	}
+
+	//! the triangles that overlap region, in storage order. With parallel, the subtrees below the top levels of the tree are
+	//! searched on the global ThreadPool; the result is the same
+	template <class Region>
+	void findOverlapping(const Region& region, std::vector<const typename TriMesh<FloatType>::Triangle*>& result, bool parallel = false) const {
+		result.clear();
+		if (m_Nodes.empty()) return;
+		const TriangleBVHRegion<Region, FloatType> test(region);
+		if (!parallel) {
+			forEachOverlappingInternal(test, 0, [&](const typename TriMesh<FloatType>::Triangle* tri) { result.push_back(tri); });
+			return;
+		}
+
+		//split the largest overlapping subtree until there are enough tasks; the tasks stay in storage order
+		struct Subtree {
+			size_t root;
+			size_t end;
+		};
+		std::vector<Subtree> subtrees;
+		if (test.intersects(m_Nodes[0].boundingBox)) {
+			Subtree all = { 0, m_Nodes.size() };
+			subtrees.push_back(all);
+		}
+		const size_t taskCount = 4 * ((size_t)ThreadPool::getGlobal().getThreadCount() + 1);
+		const size_t minTaskNodes = 64;
+		while (!subtrees.empty() && subtrees.size() < taskCount) {
+			size_t largest = 0;
+			for (size_t i = 1; i < subtrees.size(); i++) {
+				if (subtrees[i].end - subtrees[i].root > subtrees[largest].end - subtrees[largest].root) largest = i;
+			}
+			const Subtree split = subtrees[largest];
+			if (split.end - split.root < minTaskNodes || test.contains(m_Nodes[split.root].boundingBox)) break;
+
+			Subtree children[2] = { { split.root + 1, (size_t)m_Nodes[split.root].offset }, { (size_t)m_Nodes[split.root].offset, split.end } };
+			subtrees.erase(subtrees.begin() + largest);
+			for (unsigned int c = 2; c-- > 0;) {
+				if (test.intersects(m_Nodes[children[c].root].boundingBox)) subtrees.insert(subtrees.begin() + largest, children[c]);
+			}
+		}
+
+		std::vector<std::vector<const typename TriMesh<FloatType>::Triangle*>> found(subtrees.size());
+		parallelFor(0, subtrees.size(), 1, [&](size_t i) {
+			forEachOverlappingInternal(test, subtrees[i].root, [&](const typename TriMesh<FloatType>::Triangle* tri) { found[i].push_back(tri); });
+		});
+		size_t total = 0;
+		for (const auto& f : found) total += f.size();
+		result.reserve(total);
+		for (const auto& f : found) result.insert(result.end(), f.begin(), f.end());
+	}
+
+	template <class Region>
+	std::vector<const typename TriMesh<FloatType>::Triangle*> findOverlapping(const Region& region, bool parallel = false) const {
+		std::vector<const typename TriMesh<FloatType>::Triangle*> result;
+		findOverlapping(region, result, parallel);
+		return result;
+	}
+
+	//! writes the tree in the layout of TriangleBVHFileHeader. The meshes are not stored: load() takes the same meshes again and
+	//! rejects the tree if their geometry changed since. A file written by save(filename) is memory-mapped by load(meshes, filename)
+	void save(const std::string& filename) const {
+		BinaryDataStreamFile s(filename, true);
+		save(s);
+	}
+
+	template<class BinaryDataBuffer, class BinaryDataCompressor>
+	void save(BinaryDataStream<BinaryDataBuffer, BinaryDataCompressor>& s) const {
+		const std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		TriangleBVHFileHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = TriangleBVHFileHeader::magicNumber;
+		header.version = TriangleBVHFileHeader::currentVersion;
+		header.floatSize = sizeof(FloatType);
+		header.nodeSize = sizeof(Node);
+		header.sourceHash = computeSourceHash();
+		header.nodeCount = m_Nodes.size();
+		header.triangleCount = tris.size();
+		header.buildSAHCost = (double)m_BuildSAHCost;
+		header.depth = m_Depth;
+		s.writeData(header);
+		if (!m_Nodes.empty()) s.writeData((const BYTE*)m_Nodes.data(), sizeof(Node) * m_Nodes.size());
+
+		std::vector<UINT32> order(2 * tris.size());
+		for (size_t i = 0; i < tris.size(); i++) {
+			order[2 * i] = tris[i]->getMeshIndex();
+			order[2 * i + 1] = tris[i]->getIndex();
+		}
+		if (!order.empty()) s.writeData((const BYTE*)order.data(), sizeof(UINT32) * order.size());
+	}
+
+	//! restores a tree saved for meshes without building it: the file is memory-mapped and its nodes are used in place, so processes
+	//! loading the same file share its pages; only the triangles are recreated. Returns false and leaves the accelerator unchanged if
+	//! the file does not exist, was saved with another FloatType or version, or was saved for different geometry
+	bool load(const std::vector<const TriMesh<FloatType>*>& meshes, const std::string& filename, bool storeLocalCopy = false) {
+		if (!util::fileExists(filename)) return false;
+		std::shared_ptr<MemoryMappedFile> file(new MemoryMappedFile(filename));
+		if (file->getSize() < sizeof(TriangleBVHFileHeader)) return false;
+		const TriangleBVHFileHeader& header = *(const TriangleBVHFileHeader*)file->getData();
+		const size_t available = file->getSize() - sizeof(TriangleBVHFileHeader);
+		if (!isCompatible(header) || header.nodeCount > available / sizeof(Node) ||
+			header.triangleCount > (available - header.nodeCount * sizeof(Node)) / (2 * sizeof(UINT32))) return false;
+		if (header.sourceHash != computeSourceHash(meshes)) return false;
+
+		Node* nodes = (Node*)(file->getData() + sizeof(TriangleBVHFileHeader));
+		const UINT32* order = (const UINT32*)(nodes + header.nodeCount);
+		if (!createOrderedTriangles(meshes, order, (size_t)header.triangleCount, storeLocalCopy)) return false;
+		m_Nodes.assign(file, nodes, (size_t)header.nodeCount);
+		m_Depth = header.depth;
+		m_BuildSAHCost = (FloatType)header.buildSAHCost;
+		this->updateTriangleBlocks();
+		refitInternal();
+		return true;
+	}
+
+	bool load(const TriMesh<FloatType>& mesh, const std::string& filename, bool storeLocalCopy = false) {
+		std::vector<const TriMesh<FloatType>*> meshes;
+		meshes.push_back(&mesh);
+		return load(meshes, filename, storeLocalCopy);
+	}
+
+	//! reads a tree written by save(s) into owned memory; returns false as load(meshes, filename) does. If the header does not
+	//! match, nothing else is read and the rest of the tree remains in the stream
+	template<class BinaryDataBuffer, class BinaryDataCompressor>
+	bool load(const std::vector<const TriMesh<FloatType>*>& meshes, BinaryDataStream<BinaryDataBuffer, BinaryDataCompressor>& s, bool storeLocalCopy = false) {
+		TriangleBVHFileHeader header;
+		s.readData(header);
+		if (!isCompatible(header)) return false;
+
+		TriangleBVHFlatNodeArray<FloatType> nodes;
+		nodes.resize((size_t)header.nodeCount);
+		if (!nodes.empty()) s.readData((BYTE*)nodes.data(), sizeof(Node) * nodes.size());
+		std::vector<UINT32> order(2 * (size_t)header.triangleCount);
+		if (!order.empty()) s.readData((BYTE*)order.data(), sizeof(UINT32) * order.size());
+
+		if (header.sourceHash != computeSourceHash(meshes)) return false;
+		if (!createOrderedTriangles(meshes, order.data(), (size_t)header.triangleCount, storeLocalCopy)) return false;
+		m_Nodes.swap(nodes);
+		m_Depth = header.depth;
+		m_BuildSAHCost = (FloatType)header.buildSAHCost;
+		this->updateTriangleBlocks();
+		refitInternal();
+		return true;
+	}
+
+	//! fingerprint of the geometry a tree is built over: the corners and the mesh index of every triangle, in mesh order
+	static UINT64 computeSourceHash(const std::vector<const TriMesh<FloatType>*>& meshes) {
+		std::vector<size_t> meshOffsets(meshes.size() + 1, 0);
+		for (size_t m = 0; m < meshes.size(); m++) {
+			meshOffsets[m + 1] = meshOffsets[m] + meshes[m]->getIndices().size();
+		}
+		return hashTriangles(meshOffsets.back(), [&](size_t i, vec3<FloatType>* corners) {
+			const size_t m = std::upper_bound(meshOffsets.begin(), meshOffsets.end(), i) - meshOffsets.begin() - 1;
+			const vec3ui& indices = meshes[m]->getIndices()[i - meshOffsets[m]];
+			const std::vector<typename TriMesh<FloatType>::Vertex>& vertices = meshes[m]->getVertices();
+			corners[0] = vertices[indices.x].position;
+			corners[1] = vertices[indices.y].position;
+			corners[2] = vertices[indices.z].position;
+			return (UINT32)m;
+		});
+	}
+
 private:
+	static bool isCompatible(const TriangleBVHFileHeader& header) {
+		return header.magic == TriangleBVHFileHeader::magicNumber && header.version == TriangleBVHFileHeader::currentVersion &&
+			header.floatSize == sizeof(FloatType) && header.nodeSize == sizeof(Node);
+	}
+
+	//! the same fingerprint as computeSourceHash(meshes), from the triangles of this accelerator
+	UINT64 computeSourceHash() const {
+		const std::vector<typename TriMesh<FloatType>::Triangle>& triangles = TriMeshAccelerator<FloatType>::m_Triangles;
+		std::vector<size_t> meshOffsets;
+		for (const auto& tri : triangles) {
+			if (tri.getMeshIndex() + 1 >= meshOffsets.size()) meshOffsets.resize(tri.getMeshIndex() + 2, 0);
+			meshOffsets[tri.getMeshIndex() + 1]++;
+		}
+		for (size_t m = 1; m < meshOffsets.size(); m++) meshOffsets[m] += meshOffsets[m - 1];
+		std::vector<const typename TriMesh<FloatType>::Triangle*> meshOrder(triangles.size());
+		for (const auto& tri : triangles) {
+			meshOrder[meshOffsets[tri.getMeshIndex()] + tri.getIndex()] = &tri;
+		}
+		return hashTriangles(meshOrder.size(), [&](size_t i, vec3<FloatType>* corners) {
+			corners[0] = meshOrder[i]->getV0().position;
+			corners[1] = meshOrder[i]->getV1().position;
+			corners[2] = meshOrder[i]->getV2().position;
+			return (UINT32)meshOrder[i]->getMeshIndex();
+		});
+	}
+
+	//! getTriangle(i, corners) stores the corners of the i-th triangle and returns its mesh index. Blocks of triangles are hashed in
+	//! parallel and then combined in order, so the result does not depend on the thread count
+	template <class TriangleAccess>
+	static UINT64 hashTriangles(size_t count, TriangleAccess getTriangle) {
+		const UINT64 prime = 0x100000001b3ull;
+		const size_t blockSize = 1 << 16;
+		std::vector<UINT64> blockHashes((count + blockSize - 1) / blockSize);
+		parallelFor(0, blockHashes.size(), 1, [&](size_t block) {
+			UINT64 hash = 0;
+			const size_t end = std::min(count, (block + 1) * blockSize);
+			for (size_t i = block * blockSize; i < end; i++) {
+				vec3<FloatType> corners[3];
+				const UINT32 mesh = getTriangle(i, corners);
+				hash = (hash ^ util::hash64(corners)) * prime;
+				hash = (hash ^ mesh) * prime;
+			}
+			blockHashes[block] = hash;
+		});
+		UINT64 hash = util::hash64((UINT64)count);
+		for (UINT64 blockHash : blockHashes) hash = (hash ^ blockHash) * prime;
+		return hash;
+	}
+
+	//! recreates the triangles in a saved leaf order of (mesh index, triangle index) pairs; false if the pairs do not fit the meshes
+	bool createOrderedTriangles(const std::vector<const TriMesh<FloatType>*>& meshes, const UINT32* order, size_t count, bool storeLocalCopy) {
+		std::vector<size_t> meshOffsets(meshes.size() + 1, 0);
+		for (size_t m = 0; m < meshes.size(); m++) {
+			meshOffsets[m + 1] = meshOffsets[m] + meshes[m]->getIndices().size();
+		}
+		if (meshOffsets.back() != count) return false;
+		for (size_t i = 0; i < count; i++) {
+			if (order[2 * i] >= meshes.size() || order[2 * i + 1] >= meshes[order[2 * i]]->getIndices().size()) return false;
+		}
+
+		TriMeshAccelerator<FloatType>::createTriangles(meshes, storeLocalCopy);
+		std::vector<typename TriMesh<FloatType>::Triangle>& triangles = TriMeshAccelerator<FloatType>::m_Triangles;
+		std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		std::vector<typename TriMesh<FloatType>::Triangle> orderedTriangles;
+		orderedTriangles.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			orderedTriangles.push_back(triangles[meshOffsets[order[2 * i]] + order[2 * i + 1]]);
+		}
+		triangles.swap(orderedTriangles);
+		for (size_t i = 0; i < count; i++) {
+			tris[i] = &triangles[i];
+		}
+		return true;
+	}
+
 	//! defined by the interface
 	bool collisionInternal(const TriMeshAcceleratorBVH<FloatType>& other) const {
-		return m_Root->intersects(*other.m_Root);
+		return collide(other, Matrix4x4<FloatType>::identity(), true, false, nullptr);
+	}
+
+	bool collisionTransformInternal(const TriMeshAcceleratorBVH<FloatType>& other, const Matrix4x4<FloatType>& transform) const {
+		return collide(other, transform, true, false, nullptr);
 	}
 
-    bool collisionTransformInternal(const TriMeshAcceleratorBVH<FloatType>& other, const Matrix4x4<FloatType>& transform) const {
-        return m_Root->intersects(*other.m_Root, transform);
-    }
+	//! true if any pair of leaf boxes overlaps, without testing triangles
+	bool collisionTransformBBoxOnlyInternal(const TriMeshAcceleratorBVH<FloatType>& other, const Matrix4x4<FloatType>& transform) const {
+		return collide(other, transform, true, true, nullptr);
+	}
 
-    bool collisionTransformBBoxOnlyInternal(const TriMeshAcceleratorBVH<FloatType>& other, const Matrix4x4<FloatType>& transform) const {
-        return m_Root->collisionBBoxOnly(*other.m_Root, transform);
-    }
+	bool collisionPairsInternal(const TriMeshAcceleratorBVH<FloatType>& other, const Matrix4x4<FloatType>& transform, std::vector<typename TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBVH<FloatType>>::TrianglePair>& pairs, bool firstOnly) const {
+		return collide(other, transform, firstOnly, false, &pairs);
+	}
 
 	//! defined by the interface
 	const typename TriMesh<FloatType>::Triangle* intersectInternal(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
 		u = v = std::numeric_limits<FloatType>::max();	
-		t = tmax;	//TODO MATTHIAS: probably we don't have to track tmax since t must always be smaller than the prev
-		return m_Root->intersect(r, t, u, v, tmin, tmax, onlyFrontFaces);
+		t = tmax;
+		if (m_Nodes.empty()) return nullptr;
+
+		FloatType tRoot;
+		if (!m_Nodes[0].boundingBox.intersect(r, tmin, tmax, tRoot)) return nullptr;
+		const TriangleBlockRay<FloatType> blockRay(r);
+
+		//one pending node per level suffices, the farther child is pushed while the nearer one is visited next
+		struct StackEntry {
+			size_t node;
+			FloatType tNear;
+		};
+		const unsigned int fixedStackSize = 64;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		const typename TriMesh<FloatType>::Triangle* hit = nullptr;
+		size_t stackSize = 0;
+		size_t nodeIndex = 0;
+		while (true) {
+			const Node& node = m_Nodes[nodeIndex];
+			if (node.isLeaf()) {
+				this->intersectTriangles(blockRay, (size_t)node.offset, (size_t)(node.offset + node.count), t, u, v, tmin, tmax, onlyFrontFaces, hit);
+			}
+			else {
+				FloatType tFirst, tSecond;
+				const bool hitFirst = m_Nodes[nodeIndex + 1].boundingBox.intersect(r, tmin, tmax, tFirst);
+				const bool hitSecond = m_Nodes[(size_t)node.offset].boundingBox.intersect(r, tmin, tmax, tSecond);
+				if (hitFirst && hitSecond) {
+					const bool secondIsNearer = tSecond < tFirst;
+					StackEntry farther = { secondIsNearer ? nodeIndex + 1 : (size_t)node.offset, secondIsNearer ? tFirst : tSecond };
+					stack[stackSize++] = farther;
+					nodeIndex = secondIsNearer ? (size_t)node.offset : nodeIndex + 1;
+					continue;
+				}
+				if (hitFirst || hitSecond) {
+					nodeIndex = hitFirst ? nodeIndex + 1 : (size_t)node.offset;
+					continue;
+				}
+			}
+
+			//skip pending subtrees that start behind the closest hit found so far
+			while (stackSize > 0 && stack[stackSize - 1].tNear > tmax) stackSize--;
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize].node;
+		}
+		return hit;
 	}
 
-	//! defined by the interface
+	//! branch and bound: the child whose box is nearer to p is visited first, and pending subtrees whose boxes are farther than the
+	//! closest triangle found so far are skipped. A triangle given as hint (usually the result of a nearby point) is tested first to
+	//! start with a tight bound; it cannot change the result, since equal distances always go to the triangle stored first
+	void closestPointInternal(const vec3<FloatType>& p, FloatType maxDistSq, const typename TriMesh<FloatType>::Triangle* hint, ClosestPoint& result) const {
+		result.triangle = nullptr;
+		result.t = result.u = result.v = std::numeric_limits<FloatType>::max();
+		if (m_Nodes.empty()) return;
+
+		const typename TriMesh<FloatType>::Triangle* const* tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers.data();
+		FloatType bestDistSq = maxDistSq;
+		size_t best = std::numeric_limits<size_t>::max();
+		auto testTriangle = [&](size_t i) {
+			FloatType u, v;
+			const vec3<FloatType> q = closestPointOnTriangle(p, tris[i]->getV0().position, tris[i]->getV1().position, tris[i]->getV2().position, u, v);
+			const FloatType d = distSq(p, q);
+			if (d < bestDistSq || (d == bestDistSq && i < best)) {
+				bestDistSq = d;
+				best = i;
+				result.u = u;
+				result.v = v;
+			}
+		};
+		//the triangles are stored in leaf order, so the pointer gives the index of the hint
+		if (hint) testTriangle((size_t)(hint - TriMeshAccelerator<FloatType>::m_Triangles.data()));
+
+		struct StackEntry {
+			size_t node;
+			FloatType distSq;
+		};
+		const unsigned int fixedStackSize = 64;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		size_t stackSize = 0;
+		size_t nodeIndex = 0;
+		if (distSq(m_Nodes[0].boundingBox, p) <= bestDistSq) {
+			while (true) {
+				const Node& node = m_Nodes[nodeIndex];
+				if (node.isLeaf()) {
+					for (size_t i = (size_t)node.offset; i < (size_t)(node.offset + node.count); i++) {
+						testTriangle(i);
+					}
+				}
+				else {
+					const FloatType dFirst = distSq(m_Nodes[nodeIndex + 1].boundingBox, p);
+					const FloatType dSecond = distSq(m_Nodes[(size_t)node.offset].boundingBox, p);
+					const bool visitFirst = dFirst <= bestDistSq;
+					const bool visitSecond = dSecond <= bestDistSq;
+					if (visitFirst && visitSecond) {
+						const bool secondIsNearer = dSecond < dFirst;
+						StackEntry farther = { secondIsNearer ? nodeIndex + 1 : (size_t)node.offset, secondIsNearer ? dFirst : dSecond };
+						stack[stackSize++] = farther;
+						nodeIndex = secondIsNearer ? (size_t)node.offset : nodeIndex + 1;
+						continue;
+					}
+					if (visitFirst || visitSecond) {
+						nodeIndex = visitFirst ? nodeIndex + 1 : (size_t)node.offset;
+						continue;
+					}
+				}
+
+				while (stackSize > 0 && stack[stackSize - 1].distSq > bestDistSq) stackSize--;
+				if (stackSize == 0) break;
+				nodeIndex = stack[--stackSize].node;
+			}
+		}
+
+		if (best == std::numeric_limits<size_t>::max()) {
+			result.u = result.v = std::numeric_limits<FloatType>::max();
+			return;
+		}
+		result.triangle = tris[best];
+		result.t = std::sqrt(bestDistSq);
+	}
+
+	//! reports the overlapping triangles of the subtree at root; the first child is visited first, so they come in storage order
+	template <class Region, class Callback>
+	void forEachOverlappingInternal(const TriangleBVHRegion<Region, FloatType>& test, size_t root, Callback&& callback) const {
+		const unsigned int fixedStackSize = 64;
+		size_t fixedStack[fixedStackSize];
+		std::vector<size_t> largeStack;
+		size_t* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		const typename TriMesh<FloatType>::Triangle* const* tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers.data();
+		size_t stackSize = 0;
+		size_t nodeIndex = root;
+		while (true) {
+			const Node& node = m_Nodes[nodeIndex];
+			if (test.intersects(node.boundingBox)) {
+				if (test.contains(node.boundingBox)) {
+					//the triangles of a subtree are contiguous, from its leftmost to its rightmost leaf
+					size_t first = nodeIndex, last = nodeIndex;
+					while (!m_Nodes[first].isLeaf()) first++;
+					while (!m_Nodes[last].isLeaf()) last = (size_t)m_Nodes[last].offset;
+					for (size_t i = (size_t)m_Nodes[first].offset; i < (size_t)(m_Nodes[last].offset + m_Nodes[last].count); i++) callback(tris[i]);
+				}
+				else if (node.isLeaf()) {
+					for (size_t i = (size_t)node.offset; i < (size_t)(node.offset + node.count); i++) {
+						if (test.intersects(tris[i]->getV0().position, tris[i]->getV1().position, tris[i]->getV2().position)) callback(tris[i]);
+					}
+				}
+				else {
+					stack[stackSize++] = (size_t)node.offset;
+					nodeIndex++;
+					continue;
+				}
+			}
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize];
+		}
+	}
+
+	//! defined by the interface; any hit ends the traversal, so the children are visited in storage order
+	bool occludedInternal(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		if (m_Nodes.empty()) return false;
+
+		const unsigned int fixedStackSize = 64;
+		size_t fixedStack[fixedStackSize];
+		std::vector<size_t> largeStack;
+		size_t* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		const TriangleBlockRay<FloatType> blockRay(r);
+		size_t stackSize = 0;
+		size_t nodeIndex = 0;
+		while (true) {
+			const Node& node = m_Nodes[nodeIndex];
+			if (node.boundingBox.intersect(r, tmin, tmax)) {
+				if (!node.isLeaf()) {
+					stack[stackSize++] = (size_t)node.offset;
+					nodeIndex++;
+					continue;
+				}
+				if (this->occludedTriangles(blockRay, (size_t)node.offset, (size_t)(node.offset + node.count), tmin, tmax, onlyFrontFaces)) return true;
+			}
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize];
+		}
+		return false;
+	}
+
+	//! the packet shares one traversal in storage order; every ray tests all triangles of the leaves whose boxes it hits within its
+	//! current closest distance, and intersectTriangles makes the result independent of that order, so it matches intersectInternal
+	void intersectPacketInternal(const Ray<FloatType>* const* rays, typename TriMeshRayAccelerator<FloatType>::Intersection* const* results, unsigned int count, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		const unsigned int packetSize = TriMeshRayAccelerator<FloatType>::rayPacketSize;
+		const typename TriMesh<FloatType>::Triangle* hits[packetSize];
+		FloatType rayTMax[packetSize];
+		for (unsigned int i = 0; i < count; i++) {
+			results[i]->u = results[i]->v = std::numeric_limits<FloatType>::max();
+			results[i]->t = tmax;
+			hits[i] = nullptr;
+			rayTMax[i] = tmax;
+		}
+		if (m_Nodes.empty() || count == 0) {
+			for (unsigned int i = 0; i < count; i++) results[i]->triangle = nullptr;
+			return;
+		}
+
+		//sharing the traversal only pays off for rays that start close together and point into the same octant (e.g., from a camera);
+		//incoherent packets would visit the union of their paths, so their rays are traced one by one
+		BoundingBox3<FloatType> origins;
+		for (unsigned int i = 0; i < count; i++) {
+			origins.include(rays[i]->getOrigin());
+			if (rays[i]->getSign() != rays[0]->getSign()) origins.include(m_Nodes[0].boundingBox);
+		}
+		if (origins.getExtent().length() > (FloatType)0.01 * m_Nodes[0].boundingBox.getExtent().length()) {
+			TriMeshRayAccelerator<FloatType>::intersectPacketInternal(rays, results, count, tmin, tmax, onlyFrontFaces);
+			return;
+		}
+
+		//rays before firstActive missed an ancestor; the ones after it are only tested where needed (first-hit traversal)
+		struct StackEntry {
+			size_t node;
+			unsigned int firstActive;
+		};
+		const unsigned int fixedStackSize = 64;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		TriangleBlockRay<FloatType> blockRays[packetSize];
+		for (unsigned int i = 0; i < count; i++) blockRays[i] = TriangleBlockRay<FloatType>(*rays[i]);
+		size_t stackSize = 0;
+		size_t nodeIndex = 0;
+		unsigned int firstActive = 0;
+		while (true) {
+			const Node& node = m_Nodes[nodeIndex];
+			while (firstActive < count && !node.boundingBox.intersect(*rays[firstActive], tmin, rayTMax[firstActive])) firstActive++;
+
+			if (firstActive < count) {
+				if (!node.isLeaf()) {
+					StackEntry second = { (size_t)node.offset, firstActive };
+					stack[stackSize++] = second;
+					nodeIndex++;
+					continue;
+				}
+				for (unsigned int i = firstActive; i < count; i++) {
+					if (i != firstActive && !node.boundingBox.intersect(*rays[i], tmin, rayTMax[i])) continue;
+					typename TriMeshRayAccelerator<FloatType>::Intersection& result = *results[i];
+					this->intersectTriangles(blockRays[i], (size_t)node.offset, (size_t)(node.offset + node.count), result.t, result.u, result.v, tmin, rayTMax[i], onlyFrontFaces, hits[i]);
+				}
+			}
+			if (stackSize == 0) break;
+			stackSize--;
+			nodeIndex = stack[stackSize].node;
+			firstActive = stack[stackSize].firstActive;
+		}
+
+		for (unsigned int i = 0; i < count; i++) {
+			results[i]->triangle = hits[i];
+		}
+	}
+
+	//! separating axis test between the axis-aligned boxes of this tree and the boxes of another tree moved by an affine transform,
+	//! which are oriented boxes (parallelepipeds if the transform shears). The candidate axes only depend on the transform: the
+	//! three coordinate axes, the three face normals of the moved boxes, and the nine cross products of their edge directions
+	struct CollisionAxes {
+		explicit CollisionAxes(const Matrix4x4<FloatType>& t) : transform(t) {
+			vec3<FloatType> columns[3];
+			for (unsigned int j = 0; j < 3; j++) {
+				columns[j] = vec3<FloatType>(t(0, j), t(1, j), t(2, j));
+			}
+			scale = std::max(columns[0].length(), std::max(columns[1].length(), columns[2].length()));
+
+			//without rotation or shear the moved boxes stay axis-aligned and the coordinate axes suffice
+			const bool axisAligned = t(0, 1) == 0 && t(0, 2) == 0 && t(1, 0) == 0 && t(1, 2) == 0 && t(2, 0) == 0 && t(2, 1) == 0;
+			axisCount = 0;
+			for (unsigned int i = 0; i < 3; i++) {
+				vec3<FloatType> axis((FloatType)0, (FloatType)0, (FloatType)0);
+				axis[i] = (FloatType)1;
+				addAxis(axis, columns);
+			}
+			if (axisAligned) return;
+			for (unsigned int j = 0; j < 3; j++) {
+				addAxis(columns[(j + 1) % 3] ^ columns[(j + 2) % 3], columns);
+			}
+			for (unsigned int i = 0; i < 3; i++) {
+				for (unsigned int j = 0; j < 3; j++) {
+					vec3<FloatType> axis((FloatType)0, (FloatType)0, (FloatType)0);
+					axis[i] = (FloatType)1;
+					addAxis(axis ^ columns[j], columns);
+				}
+			}
+		}
+
+		//! box is in the space of this tree, otherBox in the space of the other tree
+		bool overlap(const BoundingBox3<FloatType>& box, const BoundingBox3<FloatType>& otherBox) const {
+			const vec3<FloatType> halfExtent = box.getExtent() * (FloatType)0.5;
+			const vec3<FloatType> otherHalfExtent = otherBox.getExtent() * (FloatType)0.5;
+			const vec3<FloatType> distance = transform.transformAffine(otherBox.getCenter()) - box.getCenter();
+			for (unsigned int i = 0; i < axisCount; i++) {
+				const FloatType projectedDistance = std::abs(axes[i] | distance);
+				const FloatType radius = (absAxes[i] | halfExtent) + (projectedColumns[i] | otherHalfExtent);
+				//the tolerance keeps rounding from separating touching boxes
+				if (projectedDistance > radius + (FloatType)1e-5 * (radius + projectedDistance)) return false;
+			}
+			return true;
+		}
+
+		Matrix4x4<FloatType> transform;
+		//! largest scale factor of the transform, to compare box sizes across the trees
+		FloatType scale;
+
+	private:
+		void addAxis(const vec3<FloatType>& axis, const vec3<FloatType>* columns) {
+			if (axis.lengthSq() <= std::numeric_limits<FloatType>::min()) return;
+			axes[axisCount] = axis;
+			absAxes[axisCount] = vec3<FloatType>(std::abs(axis.x), std::abs(axis.y), std::abs(axis.z));
+			projectedColumns[axisCount] = vec3<FloatType>(std::abs(axis | columns[0]), std::abs(axis | columns[1]), std::abs(axis | columns[2]));
+			axisCount++;
+		}
+
+		unsigned int axisCount;
+		vec3<FloatType> axes[15];
+		//! projects the half extents of an axis-aligned box onto the axis
+		vec3<FloatType> absAxes[15];
+		//! projects the half extents of a moved box onto the axis: |axis . column k| of the transform
+		vec3<FloatType> projectedColumns[15];
+	};
+
+	typedef std::pair<size_t, size_t> NodePair;
+
+	//! simultaneous descent of both trees, always splitting the larger box. The top node pairs are expanded breadth-first until there
+	//! are enough for all threads, and every pair below them is descended as one task. With boxesOnly, overlapping leaf boxes count as a
+	//! collision. Collects the intersecting triangle pairs into pairs if given; with firstOnly all tasks end after any pair is found
+	bool collide(const TriMeshAcceleratorBVH& other, const Matrix4x4<FloatType>& transform, bool firstOnly, bool boxesOnly, std::vector<typename TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBVH<FloatType>>::TrianglePair>* pairs) const {
+		if (m_Nodes.empty() || other.m_Nodes.empty()) return false;
+		const CollisionAxes axes(transform);
+
+		std::vector<NodePair> tasks(1, NodePair(0, 0));
+		const size_t taskCount = 4 * ((size_t)ThreadPool::getGlobal().getThreadCount() + 1);
+		while (tasks.size() < taskCount) {
+			std::vector<NodePair> next;
+			bool expanded = false;
+			for (const NodePair& task : tasks) {
+				if (!axes.overlap(m_Nodes[task.first].boundingBox, other.m_Nodes[task.second].boundingBox)) continue;
+				NodePair children[2];
+				if (!splitNodePair(task, other, axes, children)) {
+					next.push_back(task);
+					continue;
+				}
+				next.push_back(children[0]);
+				next.push_back(children[1]);
+				expanded = true;
+			}
+			tasks.swap(next);
+			if (!expanded) break;
+		}
+
+		std::atomic<bool> found(false);
+		std::vector<std::vector<typename TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBVH<FloatType>>::TrianglePair>> taskPairs(pairs ? tasks.size() : 0);
+		parallelFor(0, tasks.size(), 1, [&](size_t i) {
+			collideNodes(tasks[i], other, axes, firstOnly, boxesOnly, found, pairs ? &taskPairs[i] : nullptr);
+		});
+
+		if (pairs) {
+			for (const auto& p : taskPairs) pairs->insert(pairs->end(), p.begin(), p.end());
+			if (firstOnly && pairs->size() > 1) pairs->resize(1);
+		}
+		return found;
+	}
+
+	//! the child pairs of an overlapping node pair; false if both nodes are leaves
+	bool splitNodePair(const NodePair& pair, const TriMeshAcceleratorBVH& other, const CollisionAxes& axes, NodePair* children) const {
+		const Node& node = m_Nodes[pair.first];
+		const Node& otherNode = other.m_Nodes[pair.second];
+		if (node.isLeaf() && otherNode.isLeaf()) return false;
+		const bool splitThis = !node.isLeaf() && (otherNode.isLeaf() ||
+			node.boundingBox.getExtent().lengthSq() >= axes.scale * axes.scale * otherNode.boundingBox.getExtent().lengthSq());
+		if (splitThis) {
+			children[0] = NodePair(pair.first + 1, pair.second);
+			children[1] = NodePair((size_t)node.offset, pair.second);
+		}
+		else {
+			children[0] = NodePair(pair.first, pair.second + 1);
+			children[1] = NodePair(pair.first, (size_t)otherNode.offset);
+		}
+		return true;
+	}
+
+	void collideNodes(const NodePair& root, const TriMeshAcceleratorBVH& other, const CollisionAxes& axes, bool firstOnly, bool boxesOnly, std::atomic<bool>& found, std::vector<typename TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBVH<FloatType>>::TrianglePair>* pairs) const {
+		const typename TriMesh<FloatType>::Triangle* const* tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers.data();
+		const typename TriMesh<FloatType>::Triangle* const* otherTris = other.TriMeshRayAccelerator<FloatType>::m_TrianglePointers.data();
+		std::vector<vec3<FloatType>> movedCorners;
+
+		std::vector<NodePair> stack(1, root);
+		while (!stack.empty()) {
+			if (firstOnly && found.load(std::memory_order_relaxed)) return;
+			const NodePair pair = stack.back();
+			stack.pop_back();
+			const Node& node = m_Nodes[pair.first];
+			const Node& otherNode = other.m_Nodes[pair.second];
+			if (!axes.overlap(node.boundingBox, otherNode.boundingBox)) continue;
+
+			NodePair children[2];
+			if (splitNodePair(pair, other, axes, children)) {
+				stack.push_back(children[1]);
+				stack.push_back(children[0]);
+				continue;
+			}
+			if (boxesOnly) {
+				found = true;
+				return;
+			}
+
+			//both are leaves: the other leaf's triangles are moved into this space once
+			movedCorners.resize(3 * (size_t)otherNode.count);
+			for (size_t j = 0; j < (size_t)otherNode.count; j++) {
+				const typename TriMesh<FloatType>::Triangle* otherTri = otherTris[(size_t)otherNode.offset + j];
+				movedCorners[3 * j] = axes.transform.transformAffine(otherTri->getV0().position);
+				movedCorners[3 * j + 1] = axes.transform.transformAffine(otherTri->getV1().position);
+				movedCorners[3 * j + 2] = axes.transform.transformAffine(otherTri->getV2().position);
+			}
+			for (size_t i = (size_t)node.offset; i < (size_t)(node.offset + node.count); i++) {
+				for (size_t j = 0; j < (size_t)otherNode.count; j++) {
+					if (!intersection::intersectTriangleTriangle(tris[i]->getV0().position, tris[i]->getV1().position, tris[i]->getV2().position,
+						movedCorners[3 * j], movedCorners[3 * j + 1], movedCorners[3 * j + 2])) continue;
+					found = true;
+					if (pairs) pairs->push_back(std::make_pair(tris[i], otherTris[(size_t)otherNode.offset + j]));
+					if (firstOnly) return;
+				}
+			}
+		}
+	}
+
+protected:
+	//! defined by the interface; TriMeshAcceleratorBVHWide extends it
 	void buildInternal() {
-		SAFE_DELETE(m_Root);
+		m_Nodes.clear();
+		this->m_TriangleBlocks.clear();
+		m_Depth = 0;
+		m_BuildSAHCost = (FloatType)0;
+		std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		if (tris.empty()) return;
 
-		bool useParallelBuild = true;
-		if (useParallelBuild) {
-			buildParallel(TriMeshRayAccelerator<FloatType>::m_TrianglePointers);
+		//the pointer tree only lives during the build
+		std::unique_ptr<TriangleBVHNode<FloatType>> root(new TriangleBVHNode<FloatType>);
+		if (m_Options.strategy == TriMeshBVHBuildSAH) {
+			buildSAH(root.get(), tris);
+		} else if (m_Options.strategy == TriMeshBVHBuildLBVH) {
+			buildLBVH(root.get(), tris);
+		} else if (m_Options.strategy == TriMeshBVHBuildMidPoint) {
+			buildRecursive(root.get(), tris);
 		} else {
-			buildRecursive(TriMeshRayAccelerator<FloatType>::m_TrianglePointers);
+			buildParallel(root.get(), tris);
 		}
+		root->computeBoundingBox();
+		flatten(root.get());
+		reorderTriangles();
+		this->updateTriangleBlocks();
+		m_BuildSAHCost = getSAHCost();
 	}
 
-	void buildParallel(std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
+	//! called by refit() after the nodes were refit without a rebuild, and after load(); TriMeshAcceleratorBVHWide updates its nodes
+	virtual void refitInternal() {}
+
+	//! frees the nodes for derived accelerators that keep the tree in their own format; the queries of this class find an empty tree afterwards
+	void releaseNodes() {
+		TriangleBVHFlatNodeArray<FloatType>().swap(m_Nodes);
+	}
+
+private:
+
+	//! stores the triangles themselves in leaf order, so a leaf reads one contiguous block
+	void reorderTriangles() {
+		std::vector<typename TriMesh<FloatType>::Triangle>& triangles = TriMeshAccelerator<FloatType>::m_Triangles;
+		std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+
+		std::vector<typename TriMesh<FloatType>::Triangle> orderedTriangles;
+		orderedTriangles.reserve(tris.size());
+		for (const auto* tri : tris) {
+			orderedTriangles.push_back(*tri);
+		}
+		triangles.swap(orderedTriangles);
+		for (size_t i = 0; i < tris.size(); i++) {
+			tris[i] = &triangles[i];
+		}
+	}
+
+	//! stores the tree in depth-first order and puts the triangles in leaf order
+	void flatten(const TriangleBVHNode<FloatType>* root) {
+		struct StackEntry {
+			const TriangleBVHNode<FloatType>* node;
+			size_t parent;	//set for second children, whose index is patched into the parent
+			unsigned int depth;
+		};
+		const size_t noParent = std::numeric_limits<size_t>::max();
+
+		std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		std::vector<typename TriMesh<FloatType>::Triangle*> orderedTris;
+		orderedTris.reserve(tris.size());
+		m_Nodes.reserve(2 * tris.size());
+
+		std::vector<StackEntry> stack;
+		StackEntry rootEntry = { root, noParent, 1 };
+		stack.push_back(rootEntry);
+		while (!stack.empty()) {
+			const StackEntry entry = stack.back();
+			stack.pop_back();
+
+			const size_t nodeIndex = m_Nodes.size();
+			if (entry.parent != noParent) m_Nodes[entry.parent].offset = (typename Node::IndexType)nodeIndex;
+			m_Depth = std::max(m_Depth, entry.depth);
+
+			Node node;
+			node.boundingBox = entry.node->boundingBox;
+			if (entry.node->isLeaf()) {
+				node.offset = (typename Node::IndexType)orderedTris.size();
+				node.count = (typename Node::IndexType)entry.node->leafCount;
+				orderedTris.insert(orderedTris.end(), entry.node->leafTris, entry.node->leafTris + entry.node->leafCount);
+			}
+			else {
+				node.offset = 0;
+				node.count = 0;
+				StackEntry second = { entry.node->rChild, nodeIndex, entry.depth + 1 };
+				StackEntry first = { entry.node->lChild, noParent, entry.depth + 1 };
+				stack.push_back(second);
+				stack.push_back(first);
+			}
+			m_Nodes.push_back(node);
+		}
+
+		tris.swap(orderedTris);
+	}
+
+	//! recomputes the bounds bottom-up. The tree is cut into subtrees, each a contiguous range of the depth-first array that is
+	//! refit back to front as one task; the few nodes above them are refit afterwards
+	void refitNodes() {
+		struct Subtree {
+			size_t root;
+			size_t end;
+		};
+		std::vector<Subtree> subtrees;
+		Subtree all = { 0, m_Nodes.size() };
+		subtrees.push_back(all);
+		std::vector<size_t> topNodes;
+
+		const size_t taskCount = 4 * ((size_t)ThreadPool::getGlobal().getThreadCount() + 1);
+		while (m_Options.parallelSubtreeSize > 0 && subtrees.size() < taskCount) {
+			size_t largest = 0;
+			for (size_t i = 1; i < subtrees.size(); i++) {
+				if (subtrees[i].end - subtrees[i].root > subtrees[largest].end - subtrees[largest].root) largest = i;
+			}
+			const Subtree split = subtrees[largest];
+			if (split.end - split.root < m_Options.parallelSubtreeSize || m_Nodes[split.root].isLeaf()) break;
+
+			topNodes.push_back(split.root);
+			Subtree first = { split.root + 1, (size_t)m_Nodes[split.root].offset };
+			Subtree second = { (size_t)m_Nodes[split.root].offset, split.end };
+			subtrees[largest] = first;
+			subtrees.push_back(second);
+		}
+
+		parallelFor(0, subtrees.size(), 1, [&](size_t i) {
+			for (size_t node = subtrees[i].end; node-- > subtrees[i].root;) refitNode(node);
+		});
+		//parents were split before their children
+		for (size_t i = topNodes.size(); i-- > 0;) refitNode(topNodes[i]);
+	}
+
+	void refitNode(size_t nodeIndex) {
+		Node& node = m_Nodes[nodeIndex];
+		node.boundingBox.reset();
+		if (node.isLeaf()) {
+			for (size_t i = (size_t)node.offset; i < (size_t)(node.offset + node.count); i++) {
+				TriMeshRayAccelerator<FloatType>::m_TrianglePointers[i]->includeInBoundingBox(node.boundingBox);
+			}
+		}
+		else {
+			node.boundingBox.include(m_Nodes[nodeIndex + 1].boundingBox);
+			node.boundingBox.include(m_Nodes[(size_t)node.offset].boundingBox);
+		}
+	}
+
+	void buildParallel(TriangleBVHNode<FloatType>* root, std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
 		struct NodeEntry {
 			size_t begin;
 			size_t end;
@@ -320,24 +1530,25 @@ private:
 		};
 
 		std::vector<NodeEntry> currLevel(1);
-		m_Root = new TriangleBVHNode<FloatType>;
-		currLevel[0].node = m_Root;
+		currLevel[0].node = root;
 		currLevel[0].begin = 0;
 		currLevel[0].end = tris.size();
+		const size_t maxLeafSize = std::max(m_Options.maxLeafSize, (size_t)1);
+		if (tris.size() <= maxLeafSize) root->setLeaf(tris.begin(), tris.end());
 		
 		
 		unsigned int lastSortAxis = 0;
-		bool needFurtherSplitting = true;
+		std::atomic<bool> needFurtherSplitting(tris.size() > maxLeafSize);
 		while(needFurtherSplitting) {
 			needFurtherSplitting = false;
 
+			//the entries of a level cover disjoint triangle ranges and write disjoint slots of nextLevel
 			std::vector<NodeEntry> nextLevel(currLevel.size()*2);
-#pragma omp parallel for	
-			for (int i = 0; i < (int)std::min(currLevel.size(),tris.size()); i++) {
+			parallelFor(0, std::min(currLevel.size(), tris.size()), [&](size_t i) {
 				const size_t begin = currLevel[i].begin;
 				const size_t end = currLevel[i].end;
 
-				if (end - begin > 1) {
+				if (end - begin > maxLeafSize) {
 					if (lastSortAxis == 0)		std::stable_sort(tris.begin()+begin, tris.begin()+end, TriangleBVHNode<FloatType>::cmpX);
 					else if (lastSortAxis == 1)	std::stable_sort(tris.begin()+begin, tris.begin()+end, TriangleBVHNode<FloatType>::cmpY);
 					else						std::stable_sort(tris.begin()+begin, tris.begin()+end, TriangleBVHNode<FloatType>::cmpZ);
@@ -356,36 +1567,304 @@ private:
 					nextLevel[2*i+0].node = currLevel[i].node->lChild;
 					nextLevel[2*i+1].node = currLevel[i].node->rChild;
 					
-					if (nextLevel[2*i+0].end - nextLevel[2*i+0].begin < 2) lChild->leafTri = tris[nextLevel[2*i+0].begin];
+					if (nextLevel[2*i+0].end - nextLevel[2*i+0].begin <= maxLeafSize) lChild->setLeaf(tris.begin() + nextLevel[2*i+0].begin, tris.begin() + nextLevel[2*i+0].end);
 					else needFurtherSplitting = true;
-					if (nextLevel[2*i+1].end - nextLevel[2*i+1].begin < 2) rChild->leafTri = tris[nextLevel[2*i+1].begin];
+					if (nextLevel[2*i+1].end - nextLevel[2*i+1].begin <= maxLeafSize) rChild->setLeaf(tris.begin() + nextLevel[2*i+1].begin, tris.begin() + nextLevel[2*i+1].end);
 					else needFurtherSplitting = true;
 				} 
-			}
+			});
 
 			if (needFurtherSplitting) {
 				currLevel = nextLevel;
 				lastSortAxis = (lastSortAxis+1)%3;
 			}
 		}
+	}
 
-		m_Root->computeBoundingBox();
+	void buildRecursive(TriangleBVHNode<FloatType>* root, std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
+		//root->splitMedian(tris.begin(), tris.end(), 0);
+		root->splitMidPoint(tris.begin(), tris.end(), m_Options.maxLeafSize);
 	}
 
-	void buildRecursive(std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
-		assert(tris.size() > 2);
-		m_Root = new TriangleBVHNode<FloatType>;
-		//m_Root->splitMedian(tris.begin(), tris.end(), 0);
-		m_Root->splitMidPoint(tris.begin(), tris.end());
-		m_Root->computeBoundingBox();
+	void buildSAH(TriangleBVHNode<FloatType>* root, std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
+		root->splitSAH(tris.begin(), tris.end(), m_Options);
 	}
 
+	//! sorts the triangles along a Morton curve of their centers (parallel radix sort) and derives the hierarchy from the code
+	//! bits: every inner node of the radix tree is found independently from its position in the sorted order (Karras 2012),
+	//! so the hierarchy is emitted in linear time. Subtrees with at most maxLeafSize triangles become leaves.
+	void buildLBVH(TriangleBVHNode<FloatType>* root, std::vector<typename TriMesh<FloatType>::Triangle*>& tris) {
+		const size_t count = tris.size();
+		const bool wideCodes = m_Options.mortonCodeBits > 30;
+		const UINT32 cellCount = wideCodes ? (1u << 21) : (1u << 10);
 
-	//! private data
-	TriangleBVHNode<FloatType>* m_Root;
+		BoundingBox3<FloatType> centerBox;
+		for (const auto* tri : tris) centerBox.include(tri->getCenter());
+		vec3<FloatType> cellScale;
+		for (unsigned int a = 0; a < 3; a++) {
+			const FloatType extent = centerBox.getMax()[a] - centerBox.getMin()[a];
+			cellScale[a] = extent > (FloatType)0 ? (FloatType)cellCount / extent : (FloatType)0;
+		}
+
+		std::vector<std::pair<UINT64, UINT32>> codes(count);
+		parallelFor(0, count, [&](size_t i) {
+			const vec3<FloatType> center = tris[i]->getCenter();
+			UINT32 cell[3];
+			for (unsigned int a = 0; a < 3; a++) {
+				cell[a] = (UINT32)math::clamp((FloatType)((center[a] - centerBox.getMin()[a]) * cellScale[a]), (FloatType)0, (FloatType)(cellCount - 1));
+			}
+			const UINT64 code = wideCodes ? math::mortonCode63(cell[0], cell[1], cell[2]) : (UINT64)math::mortonCode30(cell[0], cell[1], cell[2]);
+			codes[i] = std::make_pair(code, (UINT32)i);
+		});
+		parallelRadixSort(codes, wideCodes ? 63 : 30);
+		{
+			std::vector<typename TriMesh<FloatType>::Triangle*> sorted(count);
+			for (size_t i = 0; i < count; i++) sorted[i] = tris[codes[i].second];
+			tris.swap(sorted);
+		}
+
+		const size_t maxLeafSize = std::max(m_Options.maxLeafSize, (size_t)1);
+		if (count <= maxLeafSize) {
+			root->setLeaf(tris.begin(), tris.end());
+			return;
+		}
+
+		//length of the common prefix of the keys at sorted positions i and j; equal codes are told apart by their positions
+		auto commonPrefix = [&](INT64 i, INT64 j) -> int {
+			if (j < 0 || j >= (INT64)count) return -1;
+			const UINT64 a = codes[(size_t)i].first, b = codes[(size_t)j].first;
+			if (a != b) return (int)math::countLeadingZeros(a ^ b);
+			return 64 + (int)math::countLeadingZeros((UINT64)i ^ (UINT64)j);
+		};
+
+		//inner node i covers the sorted range [first[i], last[i]] and splits it after split[i]; node 0 is the root
+		std::vector<size_t> first(count - 1), last(count - 1), split(count - 1);
+		parallelFor(0, count - 1, [&](size_t node) {
+			const INT64 i = (INT64)node;
+			const INT64 d = commonPrefix(i, i + 1) > commonPrefix(i, i - 1) ? 1 : -1;
+
+			//the other end of the range: exponential, then binary search for the farthest key sharing more than the neighbor outside
+			const int prefixOutside = commonPrefix(i, i - d);
+			INT64 lengthBound = 2;
+			while (commonPrefix(i, i + lengthBound * d) > prefixOutside) lengthBound *= 2;
+			INT64 length = 0;
+			for (INT64 t = lengthBound / 2; t >= 1; t /= 2) {
+				if (commonPrefix(i, i + (length + t) * d) > prefixOutside) length += t;
+			}
+			const INT64 j = i + length * d;
+
+			//the split: the last key that shares more than the whole range does
+			const int prefixNode = commonPrefix(i, j);
+			INT64 s = 0;
+			INT64 t = length;
+			do {
+				t = (t + 1) / 2;
+				if (commonPrefix(i, i + (s + t) * d) > prefixNode) s += t;
+			} while (t > 1);
+
+			first[node] = (size_t)std::min(i, j);
+			last[node] = (size_t)std::max(i, j);
+			split[node] = (size_t)(i + s * d + std::min(d, (INT64)0));
+		});
+
+		struct Pending {
+			TriangleBVHNode<FloatType>* node;
+			size_t inner;
+		};
+		std::vector<Pending> stack;
+		Pending rootEntry = { root, 0 };
+		stack.push_back(rootEntry);
+		while (!stack.empty()) {
+			const Pending current = stack.back();
+			stack.pop_back();
+
+			//the range [begin, end] of a child is an inner node of the radix tree, indexed by the end next to the split
+			const size_t ranges[2][3] = {
+				{ first[current.inner], split[current.inner], split[current.inner] },
+				{ split[current.inner] + 1, last[current.inner], split[current.inner] + 1 }
+			};
+			TriangleBVHNode<FloatType>* children[2];
+			for (unsigned int c = 0; c < 2; c++) {
+				children[c] = new TriangleBVHNode<FloatType>;
+				if (ranges[c][1] - ranges[c][0] + 1 <= maxLeafSize) {
+					children[c]->setLeaf(tris.begin() + ranges[c][0], tris.begin() + ranges[c][1] + 1);
+				}
+				else {
+					Pending child = { children[c], ranges[c][2] };
+					stack.push_back(child);
+				}
+			}
+			current.node->lChild = children[0];
+			current.node->rChild = children[1];
+		}
 
+		if (m_Options.treeletSize >= 3) {
+			root->computeBoundingBox();
+			optimizeTreelets(root);
+		}
+	}
+
+	//! treelet restructuring (Karras and Aila 2013): for every inner node, bottom-up, the treeletSize - 1 largest nodes below it
+	//! are opened into treeletSize subtrees, and the SAH-optimal binary tree over these subtrees is found by dynamic programming
+	//! over all subsets. The treelet is rebuilt with its own inner nodes if that is cheaper. Disjoint subtrees run in parallel.
+	void optimizeTreelets(TriangleBVHNode<FloatType>* root) {
+		//cut the top levels off; below them, every subtree is one task
+		std::vector<TriangleBVHNode<FloatType>*> topNodes, subtrees(1, root);
+		const size_t taskCount = 4 * ((size_t)ThreadPool::getGlobal().getThreadCount() + 1);
+		while (subtrees.size() < taskCount) {
+			std::vector<TriangleBVHNode<FloatType>*> next;
+			for (TriangleBVHNode<FloatType>* node : subtrees) {
+				if (node->isLeaf()) {
+					next.push_back(node);
+					continue;
+				}
+				topNodes.push_back(node);
+				next.push_back(node->lChild);
+				next.push_back(node->rChild);
+			}
+			if (next.size() == subtrees.size()) break;
+			subtrees.swap(next);
+		}
+
+		parallelFor(0, subtrees.size(), 1, [&](size_t i) {
+			std::vector<TriangleBVHNode<FloatType>*> postorder, stack(1, subtrees[i]);
+			while (!stack.empty()) {
+				TriangleBVHNode<FloatType>* node = stack.back();
+				stack.pop_back();
+				postorder.push_back(node);
+				if (!node->isLeaf()) {
+					stack.push_back(node->lChild);
+					stack.push_back(node->rChild);
+				}
+			}
+			//children come after their parent in the list, so walking it backwards is bottom-up
+			for (size_t n = postorder.size(); n-- > 0;) optimizeTreelet(postorder[n]);
+		});
+		//parents were collected before their children
+		for (size_t n = topNodes.size(); n-- > 0;) optimizeTreelet(topNodes[n]);
+	}
+
+	//! expects the costs of all nodes below node to be up to date
+	void optimizeTreelet(TriangleBVHNode<FloatType>* node) {
+		const FloatType traversalCost = (FloatType)m_Options.traversalCost;
+		if (node->isLeaf()) {
+			node->sahCost = (FloatType)m_Options.intersectionCost * node->leafCount * node->boundingBox.getSurfaceArea();
+			return;
+		}
+
+		//open the largest inner nodes until the treelet has enough subtrees
+		const unsigned int maxTreeletSize = 8;
+		const unsigned int treeletSize = std::min(m_Options.treeletSize, maxTreeletSize);
+		TriangleBVHNode<FloatType>* leaves[maxTreeletSize];
+		TriangleBVHNode<FloatType>* inner[maxTreeletSize];
+		unsigned int leafCount = 0, innerCount = 0;
+		leaves[leafCount++] = node->lChild;
+		leaves[leafCount++] = node->rChild;
+		while (leafCount < treeletSize) {
+			int largest = -1;
+			for (unsigned int i = 0; i < leafCount; i++) {
+				if (leaves[i]->isLeaf()) continue;
+				if (largest < 0 || leaves[i]->boundingBox.getSurfaceArea() > leaves[largest]->boundingBox.getSurfaceArea()) largest = (int)i;
+			}
+			if (largest < 0) break;
+			TriangleBVHNode<FloatType>* opened = leaves[largest];
+			inner[innerCount++] = opened;
+			leaves[largest] = opened->lChild;
+			leaves[leafCount++] = opened->rChild;
+		}
+
+		const FloatType currentCost = traversalCost * node->boundingBox.getSurfaceArea() + node->lChild->sahCost + node->rChild->sahCost;
+		if (leafCount < 3) {
+			node->sahCost = currentCost;
+			return;
+		}
+
+		//cheapest tree over every subset of the treelet's subtrees
+		const unsigned int subsetCount = 1u << leafCount;
+		BoundingBox3<FloatType> boxes[1u << maxTreeletSize];
+		FloatType costs[1u << maxTreeletSize];
+		unsigned int partitions[1u << maxTreeletSize];
+		for (unsigned int subset = 1; subset < subsetCount; subset++) {
+			const unsigned int lowest = subset & (~subset + 1);
+			if (subset == lowest) {
+				unsigned int i = 0;
+				while ((1u << i) != subset) i++;
+				boxes[subset] = leaves[i]->boundingBox;
+				costs[subset] = leaves[i]->sahCost;
+				continue;
+			}
+			boxes[subset] = boxes[subset & ~lowest];
+			boxes[subset].include(boxes[lowest]);
+
+			//every split is visited once: the part containing the lowest subtree is enumerated
+			FloatType best = std::numeric_limits<FloatType>::max();
+			unsigned int bestPart = 0;
+			const unsigned int rest = subset & ~lowest;
+			for (unsigned int part = (rest - 1) & rest;; part = (part - 1) & rest) {
+				const unsigned int left = part | lowest;
+				const FloatType cost = costs[left] + costs[subset & ~left];
+				if (cost < best) {
+					best = cost;
+					bestPart = left;
+				}
+				if (part == 0) break;
+			}
+			costs[subset] = traversalCost * boxes[subset].getSurfaceArea() + best;
+			partitions[subset] = bestPart;
+		}
+
+		const unsigned int all = subsetCount - 1;
+		if (costs[all] >= currentCost * (FloatType)0.999) {
+			node->sahCost = currentCost;
+			return;
+		}
+
+		//rebuild the treelet top-down, reusing the opened nodes as inner nodes
+		struct Pending {
+			TriangleBVHNode<FloatType>* node;
+			unsigned int subset;
+		};
+		Pending pending[maxTreeletSize];
+		unsigned int pendingCount = 0, nextInner = 0;
+		Pending rootEntry = { node, all };
+		pending[pendingCount++] = rootEntry;
+		while (pendingCount > 0) {
+			const Pending current = pending[--pendingCount];
+			current.node->boundingBox = boxes[current.subset];
+			current.node->sahCost = costs[current.subset];
+			const unsigned int parts[2] = { partitions[current.subset], current.subset & ~partitions[current.subset] };
+			TriangleBVHNode<FloatType>* children[2];
+			for (unsigned int c = 0; c < 2; c++) {
+				if ((parts[c] & (parts[c] - 1)) == 0) {
+					unsigned int i = 0;
+					while ((1u << i) != parts[c]) i++;
+					children[c] = leaves[i];
+				}
+				else {
+					children[c] = inner[nextInner++];
+					Pending child = { children[c], parts[c] };
+					pending[pendingCount++] = child;
+				}
+			}
+			current.node->lChild = children[0];
+			current.node->rChild = children[1];
+		}
+	}
+
+
+	//! private data
+	TriangleBVHFlatNodeArray<FloatType> m_Nodes;
+	unsigned int m_Depth;
+	FloatType m_BuildSAHCost;
+	TriMeshBVHBuildOptions m_Options;
 };
 
+template<class BinaryDataBuffer, class BinaryDataCompressor, class FloatType>
+inline BinaryDataStream<BinaryDataBuffer, BinaryDataCompressor>& operator<<(BinaryDataStream<BinaryDataBuffer, BinaryDataCompressor>& s, const TriMeshAcceleratorBVH<FloatType>& bvh) {
+	bvh.save(s);
+	return s;
+}
+
 typedef TriMeshAcceleratorBVH<float>	TriMeshAcceleratorBVHf;
 typedef TriMeshAcceleratorBVH<double>	TriMeshAcceleratorBVHd;
 
@@ -0,0 +1,299 @@
+#pragma once
+
+#ifndef _TRIMESH_ACCELERATOR_BVH_COMPRESSED_H_
+#define _TRIMESH_ACCELERATOR_BVH_COMPRESSED_H_
+
+namespace ml {
+
+//! inner node of a compressed BVH. The bounds of both children are stored as codes relative to the bounds of the node itself
+//! (QuantType is BYTE or USHORT, i.e., 8 or 16 bits); a leaf child is referenced by its triangles and has no node of its own
+template <class QuantType>
+struct TriangleBVHQuantizedNode {
+	//! minX, minY, minZ, maxX, maxY, maxZ of every child
+	QuantType bounds[2][6];
+	//! inner child: index of its node; leaf child: first triangle
+	UINT32 child[2];
+	//! leaf child: number of triangles; 0 for inner children
+	USHORT count[2];
+};
+
+//
+// BVH whose nodes are quantized for very large scenes, built from the binary tree of TriMeshAcceleratorBVH. Every inner node
+// stores the bounds of its two children with one code per plane on a uniform grid over its own bounds, which are decoded from
+// its parent during the traversal, so only the root box is stored in full precision. The codes are rounded outwards, so the
+// decoded boxes always contain the exact ones and rays find the same closest hits. With 8-bit codes a node takes 24 bytes per
+// pair of children instead of 2 * sizeof(TriangleBVHFlatNode).
+// The binary tree stays available for collision and closest-point queries and for refit() until releaseBinaryTree() is called.
+//
+template <class FloatType, class QuantType>
+class TriMeshAcceleratorBVHCompressed : public TriMeshAcceleratorBVH<FloatType>
+{
+public:
+	typedef TriangleBVHQuantizedNode<QuantType> QuantizedNode;
+
+	//the base constructors that build would run before this class exists, so building happens here
+	TriMeshAcceleratorBVHCompressed() {
+		m_RootIndex = m_RootCount = 0;
+	}
+	explicit TriMeshAcceleratorBVHCompressed(const TriMeshBVHBuildOptions& options) : TriMeshAcceleratorBVH<FloatType>(options) {
+		m_RootIndex = m_RootCount = 0;
+	}
+	TriMeshAcceleratorBVHCompressed(const TriMesh<FloatType>& triMesh, bool storeLocalCopy = false) {
+		m_RootIndex = m_RootCount = 0;
+		this->build(triMesh, storeLocalCopy);
+	}
+	TriMeshAcceleratorBVHCompressed(const TriMesh<FloatType>& triMesh, const TriMeshBVHBuildOptions& options, bool storeLocalCopy = false) : TriMeshAcceleratorBVH<FloatType>(options) {
+		m_RootIndex = m_RootCount = 0;
+		this->build(triMesh, storeLocalCopy);
+	}
+
+	//! frees the binary tree once the compressed nodes exist. Ray queries are unaffected; collision and closest-point queries,
+	//! refit() and save() of the base class find an empty tree until the next build
+	void releaseBinaryTree() {
+		this->releaseNodes();
+	}
+
+	const std::vector<QuantizedNode>& getQuantizedNodes() const {
+		return m_QuantizedNodes;
+	}
+	//! bytes of the compressed tree: the nodes and the root box
+	size_t getQuantizedSize() const {
+		return m_QuantizedNodes.size() * sizeof(QuantizedNode) + sizeof(m_RootBounds);
+	}
+	//! includes the binary tree the compressed nodes were made from
+	size_t getMemoryUsage() const {
+		return TriMeshAcceleratorBVH<FloatType>::getMemoryUsage() + getQuantizedSize();
+	}
+
+	void printInfo() const {
+		TriMeshAcceleratorBVH<FloatType>::printInfo();
+		const size_t triangleCount = std::max(TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size(), (size_t)1);
+		std::cout << "Info: compressed nodes " << m_QuantizedNodes.size() << " (" << 8 * sizeof(QuantType) << " bit), "
+			<< (double)getQuantizedSize() / triangleCount << " bytes per triangle" << std::endl;
+	}
+
+	//! decodes the bounds (minX, minY, minZ, maxX, maxY, maxZ) of a child from those of its parent. The codes 0 and max are the
+	//! parent's bounds themselves
+	static void decodeBounds(const FloatType* parent, const QuantType* codes, FloatType* bounds) {
+		for (unsigned int a = 0; a < 3; a++) {
+			const FloatType step = getStep(parent[a], parent[a + 3]);
+			bounds[a] = decode(parent[a], parent[a + 3], step, codes[a]);
+			bounds[a + 3] = decode(parent[a], parent[a + 3], step, codes[a + 3]);
+		}
+	}
+
+protected:
+	void buildInternal() {
+		TriMeshAcceleratorBVH<FloatType>::buildInternal();
+		compress();
+	}
+
+	//! the binary tree keeps its topology, so compressing it again yields the same nodes with the new bounds
+	void refitInternal() {
+		compress();
+	}
+
+	//! rays are traversed one by one; the packet traversal of the base class would use the binary tree
+	void intersectPacketInternal(const Ray<FloatType>* const* rays, typename TriMeshRayAccelerator<FloatType>::Intersection* const* results, unsigned int count, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		TriMeshRayAccelerator<FloatType>::intersectPacketInternal(rays, results, count, tmin, tmax, onlyFrontFaces);
+	}
+
+private:
+	//! a node or leaf to visit, with its decoded bounds
+	struct StackEntry {
+		UINT32 index;
+		UINT32 count;
+		FloatType bounds[6];
+		FloatType tNear;
+	};
+
+	static const UINT32 maxCode = std::numeric_limits<QuantType>::max();
+
+	static FloatType getStep(FloatType parentMin, FloatType parentMax) {
+		return (parentMax - parentMin) * ((FloatType)1 / (FloatType)maxCode);
+	}
+	static FloatType decode(FloatType parentMin, FloatType parentMax, FloatType step, UINT32 code) {
+		return code == maxCode ? parentMax : parentMin + (FloatType)code * step;
+	}
+
+	//! the largest code that decodes to at most the lower bound and the smallest that decodes to at least the upper bound;
+	//! the estimate is corrected with the decoder itself, so rounding can never move a decoded plane inwards
+	static void encodeBounds(const FloatType* parent, const BoundingBox3<FloatType>& box, QuantType* codes) {
+		const vec3<FloatType> boxMin = box.getMin(), boxMax = box.getMax();
+		for (unsigned int a = 0; a < 3; a++) {
+			const FloatType step = getStep(parent[a], parent[a + 3]);
+			UINT32 lower = 0, upper = maxCode;
+			if (step > (FloatType)0) {
+				lower = (UINT32)math::clamp(std::floor((boxMin[a] - parent[a]) / step), (FloatType)0, (FloatType)maxCode);
+				upper = (UINT32)math::clamp(std::ceil((boxMax[a] - parent[a]) / step), (FloatType)0, (FloatType)maxCode);
+				while (lower > 0 && decode(parent[a], parent[a + 3], step, lower) > boxMin[a]) lower--;
+				while (upper < maxCode && decode(parent[a], parent[a + 3], step, upper) < boxMax[a]) upper++;
+			}
+			codes[a] = (QuantType)lower;
+			codes[a + 3] = (QuantType)upper;
+		}
+	}
+
+	//! slab test of decoded bounds, as in intersectWideNodeScalar
+	static bool intersectBounds(const FloatType* bounds, const TriangleBVHWideRay<FloatType>& ray, FloatType tmin, FloatType tmax, FloatType& tNear) {
+		FloatType tEnter = tmin, tExit = tmax;
+		for (unsigned int a = 0; a < 3; a++) {
+			const FloatType t0 = (bounds[a + 3 * ray.sign[a]] - ray.origin[a]) * ray.invDir[a];
+			const FloatType t1 = (bounds[a + 3 * (1 - ray.sign[a])] - ray.origin[a]) * ray.invDir[a];
+			if (t0 > tEnter) tEnter = t0;
+			if (t1 < tExit) tExit = t1;
+		}
+		tNear = tEnter;
+		return tEnter <= tExit;
+	}
+
+	//! defined by the interface
+	const typename TriMesh<FloatType>::Triangle* intersectInternal(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		u = v = std::numeric_limits<FloatType>::max();
+		t = tmax;
+		if (m_RootCount == 0 && m_QuantizedNodes.empty()) return nullptr;
+		return traverse<false>(r, t, u, v, tmin, tmax, onlyFrontFaces);
+	}
+
+	//! defined by the interface
+	bool occludedInternal(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		if (m_RootCount == 0 && m_QuantizedNodes.empty()) return false;
+		FloatType t, u, v;
+		return traverse<true>(r, t, u, v, tmin, tmax, onlyFrontFaces) != nullptr;
+	}
+
+	//! closest hit, or with AnyHit the closest one in the first leaf with a hit within [tmin, tmax]; the nearer child is visited first and the
+	//! farther one is pushed with its decoded bounds, so the stack holds at most one entry per level
+	template <bool AnyHit>
+	const typename TriMesh<FloatType>::Triangle* traverse(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		const TriangleBVHWideRay<FloatType> ray(r);
+		StackEntry current;
+		current.index = m_RootIndex;
+		current.count = m_RootCount;
+		std::copy(m_RootBounds, m_RootBounds + 6, current.bounds);
+		if (!intersectBounds(current.bounds, ray, tmin, tmax, current.tNear)) return nullptr;
+
+		const unsigned int fixedStackSize = 64;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if (this->getTreeDepth() > fixedStackSize) {
+			largeStack.resize(this->getTreeDepth());
+			stack = largeStack.data();
+		}
+
+		const TriangleBlockRay<FloatType> blockRay(r);
+		const typename TriMesh<FloatType>::Triangle* hit = nullptr;
+		size_t stackSize = 0;
+		while (true) {
+			if (current.count > 0) {
+				if (this->intersectTriangles(blockRay, current.index, (size_t)current.index + current.count, t, u, v, tmin, tmax, onlyFrontFaces, hit) && AnyHit) return hit;
+			}
+			else {
+				const QuantizedNode& node = m_QuantizedNodes[current.index];
+				StackEntry children[2];
+				bool hitChild[2];
+				for (unsigned int c = 0; c < 2; c++) {
+					children[c].index = node.child[c];
+					children[c].count = node.count[c];
+					decodeBounds(current.bounds, node.bounds[c], children[c].bounds);
+					hitChild[c] = intersectBounds(children[c].bounds, ray, tmin, tmax, children[c].tNear);
+				}
+				if (hitChild[0] && hitChild[1]) {
+					const unsigned int nearer = children[1].tNear < children[0].tNear ? 1 : 0;
+					stack[stackSize++] = children[1 - nearer];
+					current = children[nearer];
+					continue;
+				}
+				if (hitChild[0] || hitChild[1]) {
+					current = children[hitChild[0] ? 0 : 1];
+					continue;
+				}
+			}
+
+			while (stackSize > 0 && stack[stackSize - 1].tNear > tmax) stackSize--;
+			if (stackSize == 0) break;
+			current = stack[--stackSize];
+		}
+		return hit;
+	}
+
+	//! quantizes the binary tree top-down, since every node is encoded relative to the decoded bounds of its parent. Inner nodes
+	//! keep their depth-first order
+	void compress() {
+		m_QuantizedNodes.clear();
+		m_RootIndex = m_RootCount = 0;
+		const auto& nodes = this->getNodes();
+		if (nodes.empty()) return;
+		if (TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size() > std::numeric_limits<UINT32>::max()) throw MLIB_EXCEPTION("too many triangles for 32-bit indices");
+
+		std::vector<UINT32> innerIndex(nodes.size());
+		UINT32 innerCount = 0;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			innerIndex[i] = innerCount;
+			if (!nodes[i].isLeaf()) innerCount++;
+		}
+		m_QuantizedNodes.resize(innerCount);
+
+		const vec3<FloatType> rootMin = nodes[0].boundingBox.getMin(), rootMax = nodes[0].boundingBox.getMax();
+		for (unsigned int a = 0; a < 3; a++) {
+			m_RootBounds[a] = rootMin[a];
+			m_RootBounds[a + 3] = rootMax[a];
+		}
+		setChild(nodes, innerIndex, 0, m_RootIndex, m_RootCount);
+		if (m_RootCount > 0) return;
+
+		struct Pending {
+			size_t node;
+			FloatType bounds[6];
+		};
+		std::vector<Pending> pending(1);
+		pending[0].node = 0;
+		std::copy(m_RootBounds, m_RootBounds + 6, pending[0].bounds);
+		while (!pending.empty()) {
+			const Pending current = pending.back();
+			pending.pop_back();
+
+			QuantizedNode& node = m_QuantizedNodes[innerIndex[current.node]];
+			const size_t children[2] = { current.node + 1, (size_t)nodes[current.node].offset };
+			for (unsigned int c = 0; c < 2; c++) {
+				encodeBounds(current.bounds, nodes[children[c]].boundingBox, node.bounds[c]);
+				UINT32 count;
+				setChild(nodes, innerIndex, children[c], node.child[c], count);
+				node.count[c] = (USHORT)count;
+				if (count > 0) continue;
+				Pending next;
+				next.node = children[c];
+				decodeBounds(current.bounds, node.bounds[c], next.bounds);
+				pending.push_back(next);
+			}
+		}
+	}
+
+	void setChild(const TriangleBVHFlatNodeArray<FloatType>& nodes, const std::vector<UINT32>& innerIndex, size_t nodeIndex, UINT32& child, UINT32& count) const {
+		const typename TriMeshAcceleratorBVH<FloatType>::Node& node = nodes[nodeIndex];
+		if (!node.isLeaf()) {
+			child = innerIndex[nodeIndex];
+			count = 0;
+			return;
+		}
+		if (node.count > std::numeric_limits<USHORT>::max()) throw MLIB_EXCEPTION("leaf of " + std::to_string(node.count) + " triangles exceeds the compressed node limit");
+		child = (UINT32)node.offset;
+		count = (UINT32)node.count;
+	}
+
+	std::vector<QuantizedNode> m_QuantizedNodes;
+	//! the root is referenced like a child: a leaf if m_RootCount > 0; its bounds are stored in full precision
+	FloatType m_RootBounds[6];
+	UINT32 m_RootIndex;
+	UINT32 m_RootCount;
+};
+
+typedef TriMeshAcceleratorBVHCompressed<float, BYTE>		TriMeshAcceleratorBVHCompressed8f;
+typedef TriMeshAcceleratorBVHCompressed<float, USHORT>		TriMeshAcceleratorBVHCompressed16f;
+typedef TriMeshAcceleratorBVHCompressed<double, BYTE>		TriMeshAcceleratorBVHCompressed8d;
+typedef TriMeshAcceleratorBVHCompressed<double, USHORT>		TriMeshAcceleratorBVHCompressed16d;
+
+} // namespace ml
+
+#endif
@@ -0,0 +1,374 @@
+#pragma once
+
+#ifndef _TRIMESH_ACCELERATOR_BVH_WIDE_H_
+#define _TRIMESH_ACCELERATOR_BVH_WIDE_H_
+
+namespace ml {
+
+//! node of a collapsed BVH with up to Width children. The child bounds are stored per component (structure of arrays),
+//! so one SIMD slab test covers all children. Unused slots have inverted bounds and are never hit.
+template <class FloatType, unsigned int Width>
+struct TriangleBVHWideNode {
+	//! minX, minY, minZ, maxX, maxY, maxZ of every child
+	FloatType bounds[6][Width];
+	//! inner child: index of its node; leaf child: first triangle
+	UINT32 child[Width];
+	//! leaf child: number of triangles; 0 for inner children and unused slots
+	UINT32 count[Width];
+};
+
+//! ray in the form the slab tests need; sign[a] is 1 if the direction is negative along axis a
+template <class FloatType>
+struct TriangleBVHWideRay {
+	explicit TriangleBVHWideRay(const Ray<FloatType>& r) {
+		for (unsigned int a = 0; a < 3; a++) {
+			origin[a] = r.getOrigin()[a];
+			invDir[a] = r.getInverseDirection()[a];
+			sign[a] = r.getSign()[a] ? 1 : 0;
+		}
+	}
+	FloatType origin[3];
+	FloatType invDir[3];
+	unsigned int sign[3];
+};
+
+//! slab test of a ray against all children of a node; returns a bit mask of the children hit and writes their entry distances.
+//! Components that produce NaN (ray origin on a slab plane of an axis the ray is parallel to) are ignored.
+template <class FloatType, unsigned int Width>
+inline unsigned int intersectWideNodeScalar(const TriangleBVHWideNode<FloatType, Width>& node, const TriangleBVHWideRay<FloatType>& ray, FloatType tmin, FloatType tmax, FloatType* tNear) {
+	unsigned int mask = 0;
+	for (unsigned int i = 0; i < Width; i++) {
+		FloatType tEnter = tmin, tExit = tmax;
+		for (unsigned int a = 0; a < 3; a++) {
+			const FloatType t0 = (node.bounds[a + 3 * ray.sign[a]][i] - ray.origin[a]) * ray.invDir[a];
+			const FloatType t1 = (node.bounds[a + 3 * (1 - ray.sign[a])][i] - ray.origin[a]) * ray.invDir[a];
+			if (t0 > tEnter) tEnter = t0;
+			if (t1 < tExit) tExit = t1;
+		}
+		tNear[i] = tEnter;
+		if (tEnter <= tExit) mask |= 1 << i;
+	}
+	return mask;
+}
+
+//! selects the box test of a node type; the SIMD versions exist for float nodes of width 4 (SSE) and 8 (AVX)
+template <class FloatType, unsigned int Width>
+struct TriangleBVHWideBoxTest {
+	static bool isSIMDSupported() {
+		return false;
+	}
+	static const char* getSIMDName() {
+		return "scalar";
+	}
+	static unsigned int intersect(const TriangleBVHWideNode<FloatType, Width>& node, const TriangleBVHWideRay<FloatType>& ray, FloatType tmin, FloatType tmax, FloatType* tNear) {
+		return intersectWideNodeScalar(node, ray, tmin, tmax, tNear);
+	}
+	static unsigned int intersectSIMD(const TriangleBVHWideNode<FloatType, Width>& node, const TriangleBVHWideRay<FloatType>& ray, FloatType tmin, FloatType tmax, FloatType* tNear) {
+		return intersectWideNodeScalar(node, ray, tmin, tmax, tNear);
+	}
+};
+
+#ifdef MLIB_SIMD_X86
+
+template <>
+struct TriangleBVHWideBoxTest<float, 4> {
+	static bool isSIMDSupported() {
+		return CPUFeatures::get().hasSSE2();
+	}
+	static const char* getSIMDName() {
+		return "SSE";
+	}
+	static unsigned int intersect(const TriangleBVHWideNode<float, 4>& node, const TriangleBVHWideRay<float>& ray, float tmin, float tmax, float* tNear) {
+		return intersectWideNodeScalar(node, ray, tmin, tmax, tNear);
+	}
+	static unsigned int intersectSIMD(const TriangleBVHWideNode<float, 4>& node, const TriangleBVHWideRay<float>& ray, float tmin, float tmax, float* tNear) {
+		//the NaN-prone slab distances go first: max/min return the second operand if either one is NaN
+		__m128 tEnter = _mm_set1_ps(tmin);
+		__m128 tExit = _mm_set1_ps(tmax);
+		for (unsigned int a = 0; a < 3; a++) {
+			const __m128 origin = _mm_set1_ps(ray.origin[a]);
+			const __m128 invDir = _mm_set1_ps(ray.invDir[a]);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[a + 3 * ray.sign[a]]), origin), invDir);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[a + 3 * (1 - ray.sign[a])]), origin), invDir);
+			tEnter = _mm_max_ps(t0, tEnter);
+			tExit = _mm_min_ps(t1, tExit);
+		}
+		_mm_storeu_ps(tNear, tEnter);
+		return (unsigned int)_mm_movemask_ps(_mm_cmple_ps(tEnter, tExit));
+	}
+};
+
+template <>
+struct TriangleBVHWideBoxTest<float, 8> {
+	static bool isSIMDSupported() {
+		return CPUFeatures::get().hasAVX();
+	}
+	static const char* getSIMDName() {
+		return "AVX";
+	}
+	static unsigned int intersect(const TriangleBVHWideNode<float, 8>& node, const TriangleBVHWideRay<float>& ray, float tmin, float tmax, float* tNear) {
+		return intersectWideNodeScalar(node, ray, tmin, tmax, tNear);
+	}
+	MLIB_TARGET_AVX static unsigned int intersectSIMD(const TriangleBVHWideNode<float, 8>& node, const TriangleBVHWideRay<float>& ray, float tmin, float tmax, float* tNear) {
+		__m256 tEnter = _mm256_set1_ps(tmin);
+		__m256 tExit = _mm256_set1_ps(tmax);
+		for (unsigned int a = 0; a < 3; a++) {
+			const __m256 origin = _mm256_set1_ps(ray.origin[a]);
+			const __m256 invDir = _mm256_set1_ps(ray.invDir[a]);
+			const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[a + 3 * ray.sign[a]]), origin), invDir);
+			const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[a + 3 * (1 - ray.sign[a])]), origin), invDir);
+			tEnter = _mm256_max_ps(t0, tEnter);
+			tExit = _mm256_min_ps(t1, tExit);
+		}
+		_mm256_storeu_ps(tNear, tEnter);
+		return (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+	}
+};
+
+#endif
+
+//
+// BVH with Width children per node, collapsed from the binary tree of TriMeshAcceleratorBVH (which stays available for
+// collision queries and statistics). Rays test all children of a node at once, with SSE for BVH4 and AVX for BVH8 if the
+// CPU supports it and a scalar loop otherwise, and visit the children that are hit from near to far.
+//
+template <class FloatType, unsigned int Width>
+class TriMeshAcceleratorBVHWide : public TriMeshAcceleratorBVH<FloatType>
+{
+public:
+	typedef TriangleBVHWideNode<FloatType, Width> WideNode;
+	typedef TriangleBVHWideBoxTest<FloatType, Width> BoxTest;
+
+	//the base constructors that build would run before this class exists, so building happens here
+	TriMeshAcceleratorBVHWide() {
+		m_WideDepth = 0;
+		m_UseSIMD = BoxTest::isSIMDSupported();
+	}
+	explicit TriMeshAcceleratorBVHWide(const TriMeshBVHBuildOptions& options) : TriMeshAcceleratorBVH<FloatType>(options) {
+		m_WideDepth = 0;
+		m_UseSIMD = BoxTest::isSIMDSupported();
+	}
+	TriMeshAcceleratorBVHWide(const TriMesh<FloatType>& triMesh, bool storeLocalCopy = false) {
+		m_WideDepth = 0;
+		m_UseSIMD = BoxTest::isSIMDSupported();
+		this->build(triMesh, storeLocalCopy);
+	}
+	TriMeshAcceleratorBVHWide(const TriMesh<FloatType>& triMesh, const TriMeshBVHBuildOptions& options, bool storeLocalCopy = false) : TriMeshAcceleratorBVH<FloatType>(options) {
+		m_WideDepth = 0;
+		m_UseSIMD = BoxTest::isSIMDSupported();
+		this->build(triMesh, storeLocalCopy);
+	}
+
+	//! the SIMD box test is used by default if the CPU supports it; disabling it selects the scalar fallback
+	void setSIMDEnabled(bool enabled) {
+		m_UseSIMD = enabled && BoxTest::isSIMDSupported();
+	}
+	bool isSIMDEnabled() const {
+		return m_UseSIMD;
+	}
+
+	const std::vector<WideNode, AlignedAllocator<WideNode, 32>>& getWideNodes() const {
+		return m_WideNodes;
+	}
+	//! includes the binary tree the wide nodes were made from
+	size_t getMemoryUsage() const {
+		return TriMeshAcceleratorBVH<FloatType>::getMemoryUsage() + m_WideNodes.size() * sizeof(WideNode);
+	}
+
+	void printInfo() const {
+		TriMeshAcceleratorBVH<FloatType>::printInfo();
+		std::cout << "Info: BVH" << Width << " nodes " << m_WideNodes.size() << ", depth " << m_WideDepth << ", box test " << (m_UseSIMD ? BoxTest::getSIMDName() : "scalar") << std::endl;
+	}
+
+protected:
+	void buildInternal() {
+		TriMeshAcceleratorBVH<FloatType>::buildInternal();
+		collapse();
+	}
+
+	//! the binary tree keeps its topology, so collapsing it again yields the same nodes with the new bounds
+	void refitInternal() {
+		collapse();
+	}
+
+	//! rays are traversed one by one; the packet traversal of the base class would use the binary tree
+	void intersectPacketInternal(const Ray<FloatType>* const* rays, typename TriMeshRayAccelerator<FloatType>::Intersection* const* results, unsigned int count, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		TriMeshRayAccelerator<FloatType>::intersectPacketInternal(rays, results, count, tmin, tmax, onlyFrontFaces);
+	}
+
+private:
+	//! a pending child of the node being filled: either a node of the binary tree or a leaf range
+	struct StackEntry {
+		UINT32 index;
+		UINT32 count;
+		FloatType tNear;
+	};
+
+	//! defined by the interface
+	const typename TriMesh<FloatType>::Triangle* intersectInternal(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		u = v = std::numeric_limits<FloatType>::max();
+		t = tmax;
+		if (m_WideNodes.empty()) return nullptr;
+		if (m_UseSIMD) return traverse<true, false>(r, t, u, v, tmin, tmax, onlyFrontFaces);
+		return traverse<false, false>(r, t, u, v, tmin, tmax, onlyFrontFaces);
+	}
+
+	//! defined by the interface
+	bool occludedInternal(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		if (m_WideNodes.empty()) return false;
+		FloatType t, u, v;
+		if (m_UseSIMD) return traverse<true, true>(r, t, u, v, tmin, tmax, onlyFrontFaces) != nullptr;
+		return traverse<false, true>(r, t, u, v, tmin, tmax, onlyFrontFaces) != nullptr;
+	}
+
+	//! closest hit, or with AnyHit the closest one in the first leaf with a hit within [tmin, tmax]
+	template <bool SIMD, bool AnyHit>
+	const typename TriMesh<FloatType>::Triangle* traverse(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		const TriangleBVHWideRay<FloatType> ray(r);
+
+		//every level leaves at most Width - 1 siblings behind
+		const unsigned int fixedStackSize = 64 * Width;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if ((m_WideDepth + 1) * Width > fixedStackSize) {
+			largeStack.resize((m_WideDepth + 1) * Width);
+			stack = largeStack.data();
+		}
+
+		const TriangleBlockRay<FloatType> blockRay(r);
+		const typename TriMesh<FloatType>::Triangle* hit = nullptr;
+		size_t stackSize = 0;
+		StackEntry root = { 0, 0, tmin };
+		stack[stackSize++] = root;
+
+		FloatType tNear[Width];
+		while (stackSize > 0) {
+			const StackEntry entry = stack[--stackSize];
+			if (entry.tNear > tmax) continue;	//a closer hit was found since the entry was pushed
+
+			if (entry.count > 0) {
+				if (this->intersectTriangles(blockRay, entry.index, (size_t)entry.index + entry.count, t, u, v, tmin, tmax, onlyFrontFaces, hit) && AnyHit) return hit;
+				continue;
+			}
+
+			const WideNode& node = m_WideNodes[entry.index];
+			unsigned int mask = SIMD ? BoxTest::intersectSIMD(node, ray, tmin, tmax, tNear) : BoxTest::intersect(node, ray, tmin, tmax, tNear);
+
+			//push the hit children far to near, so the nearest one is popped first
+			const size_t first = stackSize;
+			while (mask != 0) {
+				unsigned int i = 0;
+				while ((mask & (1u << i)) == 0) i++;
+				mask &= ~(1u << i);
+
+				StackEntry child = { node.child[i], node.count[i], tNear[i] };
+				size_t j = stackSize++;
+				while (j > first && stack[j - 1].tNear < child.tNear) {
+					stack[j] = stack[j - 1];
+					j--;
+				}
+				stack[j] = child;
+			}
+		}
+		return hit;
+	}
+
+	//! merges up to Width binary nodes into one node, always opening the largest inner child, breadth first
+	void collapse() {
+		m_WideNodes.clear();
+		m_WideDepth = 0;
+		const auto& nodes = this->getNodes();
+		if (nodes.empty()) return;
+		if (TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size() > std::numeric_limits<UINT32>::max()) throw MLIB_EXCEPTION("too many triangles for 32-bit indices");
+
+		struct Pending {
+			size_t binaryNode;
+			size_t wideNode;
+			unsigned int depth;
+		};
+		std::deque<Pending> pending;
+		m_WideNodes.reserve(nodes.size() / (Width / 2) + 1);
+		m_WideNodes.push_back(makeEmptyNode());
+		Pending root = { 0, 0, 1 };
+		pending.push_back(root);
+
+		while (!pending.empty()) {
+			const Pending current = pending.front();
+			pending.pop_front();
+			m_WideDepth = std::max(m_WideDepth, current.depth);
+
+			size_t children[Width];
+			unsigned int childCount = 0;
+			if (nodes[current.binaryNode].isLeaf()) {
+				children[childCount++] = current.binaryNode;	//only for a root that is a leaf
+			}
+			else {
+				children[childCount++] = current.binaryNode + 1;
+				children[childCount++] = (size_t)nodes[current.binaryNode].offset;
+			}
+			while (childCount < Width) {
+				int largest = -1;
+				for (unsigned int i = 0; i < childCount; i++) {
+					if (nodes[children[i]].isLeaf()) continue;
+					if (largest < 0 || nodes[children[i]].boundingBox.getSurfaceArea() > nodes[children[largest]].boundingBox.getSurfaceArea()) largest = (int)i;
+				}
+				if (largest < 0) break;
+				const size_t opened = children[largest];
+				children[largest] = opened + 1;
+				children[childCount++] = (size_t)nodes[opened].offset;
+			}
+
+			for (unsigned int i = 0; i < childCount; i++) {
+				const typename TriMeshAcceleratorBVH<FloatType>::Node& child = nodes[children[i]];
+				WideNode& wideNode = m_WideNodes[current.wideNode];
+				setChildBounds(wideNode, i, child.boundingBox);
+				if (child.isLeaf()) {
+					wideNode.child[i] = (UINT32)child.offset;
+					wideNode.count[i] = (UINT32)child.count;
+				}
+				else {
+					if (m_WideNodes.size() > std::numeric_limits<UINT32>::max()) throw MLIB_EXCEPTION("too many wide nodes for 32-bit indices");
+					wideNode.child[i] = (UINT32)m_WideNodes.size();
+					wideNode.count[i] = 0;
+					Pending next = { children[i], m_WideNodes.size(), current.depth + 1 };
+					pending.push_back(next);
+					m_WideNodes.push_back(makeEmptyNode());	//invalidates wideNode
+				}
+			}
+		}
+	}
+
+	static WideNode makeEmptyNode() {
+		WideNode node;
+		for (unsigned int i = 0; i < Width; i++) {
+			for (unsigned int a = 0; a < 3; a++) {
+				node.bounds[a][i] = std::numeric_limits<FloatType>::max();
+				node.bounds[a + 3][i] = -std::numeric_limits<FloatType>::max();
+			}
+			node.child[i] = 0;
+			node.count[i] = 0;
+		}
+		return node;
+	}
+
+	static void setChildBounds(WideNode& node, unsigned int slot, const BoundingBox3<FloatType>& box) {
+		for (unsigned int a = 0; a < 3; a++) {
+			node.bounds[a][slot] = box.getMin()[a];
+			node.bounds[a + 3][slot] = box.getMax()[a];
+		}
+	}
+
+	std::vector<WideNode, AlignedAllocator<WideNode, 32>> m_WideNodes;
+	unsigned int m_WideDepth;
+	bool m_UseSIMD;
+};
+
+typedef TriMeshAcceleratorBVHWide<float, 4>		TriMeshAcceleratorBVH4f;
+typedef TriMeshAcceleratorBVHWide<double, 4>	TriMeshAcceleratorBVH4d;
+typedef TriMeshAcceleratorBVHWide<float, 8>		TriMeshAcceleratorBVH8f;
+typedef TriMeshAcceleratorBVHWide<double, 8>	TriMeshAcceleratorBVH8d;
+
+} // namespace ml
+
+#endif
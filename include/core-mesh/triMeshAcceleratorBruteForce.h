@@ -18,6 +18,7 @@ public:
 	}
 
 
+
 private:
 
 	//! interface definition
@@ -52,6 +53,27 @@ private:
         return false;
     }
 
+	//! interface definition
+	bool collisionPairsInternal(const TriMeshAcceleratorBruteForce<FloatType>& accel, const Matrix4x4<FloatType>& transform, std::vector<typename TriMeshCollisionAccelerator<FloatType, TriMeshAcceleratorBruteForce<FloatType>>::TrianglePair>& pairs, bool firstOnly) const {
+		const std::vector<typename TriMesh<FloatType>::Triangle*>& otherTris = accel.TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		std::vector<vec3<FloatType>> movedCorners(3 * otherTris.size());
+		for (size_t j = 0; j < otherTris.size(); j++) {
+			movedCorners[3 * j] = transform.transformAffine(otherTris[j]->getV0().position);
+			movedCorners[3 * j + 1] = transform.transformAffine(otherTris[j]->getV1().position);
+			movedCorners[3 * j + 2] = transform.transformAffine(otherTris[j]->getV2().position);
+		}
+		for (const auto* triA : TriMeshRayAccelerator<FloatType>::m_TrianglePointers) {
+			for (size_t j = 0; j < otherTris.size(); j++) {
+				if (intersection::intersectTriangleTriangle(triA->getV0().position, triA->getV1().position, triA->getV2().position,
+					movedCorners[3 * j], movedCorners[3 * j + 1], movedCorners[3 * j + 2])) {
+					pairs.push_back(std::make_pair(triA, otherTris[j]));
+					if (firstOnly) return true;
+				}
+			}
+		}
+		return !pairs.empty();
+	}
+
     //! interface definition
     bool collisionTransformBBoxOnlyInternal(const TriMeshAcceleratorBruteForce<FloatType>& accel, const Matrix4x4<FloatType>& transform) const {
         //TODO: have Matthias do this
@@ -61,19 +83,35 @@ private:
 
 	//! interface definition
 	const typename TriMesh<FloatType>::Triangle* intersectInternal(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		const std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshRayAccelerator<FloatType>::m_TrianglePointers;
+		const TriangleBlockRay<FloatType> ray(r);
+		const typename TriMesh<FloatType>::Triangle* hit = nullptr;
+		FloatType hitT, hitU, hitV;
+		for (size_t i = 0; i < tris.size(); i++) {
+			const typename TriMesh<FloatType>::Triangle* tri = tris[i];
+			if (!intersectTriangleWatertight(tri->getV0().position, tri->getV1().position, tri->getV2().position, ray, tmin, tmax, onlyFrontFaces, hitT, hitU, hitV)) continue;
+			if (hit && hitT == tmax && hit < tri) continue;	//as in intersectTriangles
+			t = tmax = hitT;
+			u = hitU;
+			v = hitV;
+			hit = tri;
+		}
+		return hit;
+	}
 
-		typename TriMesh<FloatType>::Triangle* tri = nullptr;
-		for (size_t i = 0; i < TriMeshRayAccelerator<FloatType>::m_TrianglePointers.size(); i++) {
-			if (TriMeshRayAccelerator<FloatType>::m_TrianglePointers[i]->intersect(r, t, u, v, tmin, tmax, onlyFrontFaces)) {
-				tmax = t;
-				tri = TriMeshRayAccelerator<FloatType>::m_TrianglePointers[i];
-			}
+	//! defined by the interface
+	bool occludedInternal(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		const TriangleBlockRay<FloatType> ray(r);
+		FloatType t, u, v;
+		for (const auto* tri : TriMeshRayAccelerator<FloatType>::m_TrianglePointers) {
+			if (intersectTriangleWatertight(tri->getV0().position, tri->getV1().position, tri->getV2().position, ray, tmin, tmax, onlyFrontFaces, t, u, v)) return true;
 		}
-		return tri;
+		return false;
 	}
 
+	//! the ray queries run the scalar watertight test on the triangles' current corners instead of keeping blocks like the other
+	//! accelerators, so like the collision queries they see vertices changed in place or through updateVertices() without a refit
 	void buildInternal() {
-		//nothing to do here
 	}
 
 };
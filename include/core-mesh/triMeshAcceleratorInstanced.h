@@ -0,0 +1,255 @@
+#pragma once
+
+#ifndef _TRIMESH_ACCELERATOR_INSTANCED_H_
+#define _TRIMESH_ACCELERATOR_INSTANCED_H_
+
+namespace ml {
+
+//! two-level acceleration structure for scenes made of transformed copies of a few meshes. Every instance references a
+//! shared object accelerator (e.g., a TriMeshAcceleratorBVH of the mesh in its own coordinates) and an object-to-world
+//! transform; a top-level BVH over the world bounds of the instances finds the candidates, whose accelerators are then
+//! queried with the ray transformed into object space. Moving instances only touches the top level (refit() or build()).
+//! The object accelerators are not owned and must outlive this structure; their bounds are read when they are first added.
+template <class FloatType>
+class TriMeshAcceleratorInstanced
+{
+public:
+	typedef TriangleBVHFlatNode<FloatType> Node;
+
+	struct Intersection : public TriMeshRayAccelerator<FloatType>::Intersection
+	{
+		Intersection() : instance(std::numeric_limits<UINT>::max()) {}
+
+		//! t is the distance along the world-space ray; triangle, u, v and the surface attributes are in the object space of the instance
+		UINT instance;
+	};
+
+	TriMeshAcceleratorInstanced() {
+		m_Depth = 0;
+	}
+
+	//! adds an instance and returns its index; takes effect with the next build()
+	UINT addInstance(const TriMeshRayAccelerator<FloatType>* accelerator, const Matrix4x4<FloatType>& objectToWorld) {
+		auto bounds = m_ObjectBounds.find(accelerator);
+		if (bounds == m_ObjectBounds.end()) {
+			bounds = m_ObjectBounds.insert(std::make_pair(accelerator, accelerator->computeBoundingBox())).first;
+		}
+		Instance instance;
+		instance.accelerator = accelerator;
+		instance.objectBounds = bounds->second;
+		m_Instances.push_back(instance);
+		setTransform((UINT)m_Instances.size() - 1, objectToWorld);
+		return (UINT)m_Instances.size() - 1;
+	}
+
+	//! moves an instance; takes effect with the next refit() or build()
+	void setTransform(UINT instance, const Matrix4x4<FloatType>& objectToWorld) {
+		Instance& i = m_Instances[instance];
+		i.objectToWorld = objectToWorld;
+		i.worldToObject = objectToWorld.getInverse();
+		i.worldBounds = i.objectBounds * objectToWorld;
+	}
+
+	const Matrix4x4<FloatType>& getTransform(UINT instance) const {
+		return m_Instances[instance].objectToWorld;
+	}
+	const TriMeshRayAccelerator<FloatType>* getAccelerator(UINT instance) const {
+		return m_Instances[instance].accelerator;
+	}
+	size_t getInstanceCount() const {
+		return m_Instances.size();
+	}
+
+	void clear() {
+		m_Instances.clear();
+		m_ObjectBounds.clear();
+		m_Nodes.clear();
+		m_Order.clear();
+		m_Depth = 0;
+	}
+
+	//! builds the top-level tree over the current world bounds of the instances (object median split along the longest axis)
+	void build() {
+		m_Nodes.clear();
+		m_Depth = 0;
+		m_Order.resize(m_Instances.size());
+		for (size_t i = 0; i < m_Order.size(); i++) m_Order[i] = (UINT)i;
+		if (m_Instances.empty()) return;
+		m_Nodes.reserve(2 * m_Instances.size());
+		buildNode(0, m_Order.size(), 1);
+	}
+
+	//! updates the top-level bounds after setTransform() without changing the tree; cheaper than build(), but the tree
+	//! degrades if instances move far
+	void refit() {
+		for (size_t nodeIndex = m_Nodes.size(); nodeIndex-- > 0;) {
+			Node& node = m_Nodes[nodeIndex];
+			if (node.isLeaf()) {
+				node.boundingBox = m_Instances[m_Order[(size_t)node.offset]].worldBounds;
+			}
+			else {
+				node.boundingBox = m_Nodes[nodeIndex + 1].boundingBox;
+				node.boundingBox.include(m_Nodes[(size_t)node.offset].boundingBox);
+			}
+		}
+	}
+
+	const std::vector<Node, AlignedAllocator<Node, 32>>& getNodes() const {
+		return m_Nodes;
+	}
+	unsigned int getTreeDepth() const {
+		return m_Depth;
+	}
+
+	//! closest hit along a world-space ray within [tmin, tmax]
+	Intersection intersect(const Ray<FloatType>& r, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		Intersection result;
+		result.t = tmax;
+		result.u = result.v = std::numeric_limits<FloatType>::max();
+		traverse<false>(r, tmin, tmax, onlyFrontFaces, result);
+		return result;
+	}
+
+	bool intersect(const Ray<FloatType>& r, Intersection& i, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		i = intersect(r, tmin, tmax, onlyFrontFaces);
+		return i.isValid();
+	}
+
+	//! returns true if any instance is hit within [tmin, tmax]
+	bool occluded(const Ray<FloatType>& r, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		Intersection result;
+		return traverse<true>(r, tmin, tmax, onlyFrontFaces, result);
+	}
+
+private:
+	struct Instance {
+		const TriMeshRayAccelerator<FloatType>* accelerator;
+		Matrix4x4<FloatType> objectToWorld;
+		Matrix4x4<FloatType> worldToObject;
+		BoundingBox3<FloatType> objectBounds;
+		BoundingBox3<FloatType> worldBounds;
+	};
+
+	//! returns the index of the node built for the instances m_Order[begin, end)
+	size_t buildNode(size_t begin, size_t end, unsigned int depth) {
+		const size_t nodeIndex = m_Nodes.size();
+		m_Nodes.push_back(Node());
+		m_Depth = std::max(m_Depth, depth);
+
+		BoundingBox3<FloatType> bounds, centroids;
+		for (size_t i = begin; i < end; i++) {
+			bounds.include(m_Instances[m_Order[i]].worldBounds);
+			centroids.include(m_Instances[m_Order[i]].worldBounds.getCenter());
+		}
+		m_Nodes[nodeIndex].boundingBox = bounds;
+		if (end - begin == 1) {
+			m_Nodes[nodeIndex].offset = (typename Node::IndexType)begin;
+			m_Nodes[nodeIndex].count = 1;
+			return nodeIndex;
+		}
+
+		const vec3<FloatType> extent = centroids.getExtent();
+		const unsigned int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		const size_t mid = begin + (end - begin) / 2;
+		std::nth_element(m_Order.begin() + begin, m_Order.begin() + mid, m_Order.begin() + end, [&](UINT a, UINT b) {
+			return m_Instances[a].worldBounds.getCenter()[axis] < m_Instances[b].worldBounds.getCenter()[axis];
+		});
+
+		buildNode(begin, mid, depth + 1);
+		const size_t second = buildNode(mid, end, depth + 1);
+		m_Nodes[nodeIndex].offset = (typename Node::IndexType)second;
+		m_Nodes[nodeIndex].count = 0;
+		return nodeIndex;
+	}
+
+	//! intersects the ray with one instance in its object space; the scale of the transformed direction converts the distances
+	bool intersectInstance(UINT instance, const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces, bool anyHit, Intersection& result) const {
+		const Instance& i = m_Instances[instance];
+		const vec3<FloatType> direction = i.worldToObject.transformNormalAffine(r.getDirection());
+		const FloatType scale = direction.length();
+		if (scale <= (FloatType)0) return false;
+		const Ray<FloatType> objectRay(i.worldToObject * r.getOrigin(), direction);
+
+		if (anyHit) return i.accelerator->occluded(objectRay, tmin * scale, tmax * scale, onlyFrontFaces);
+
+		typename TriMeshRayAccelerator<FloatType>::Intersection hit;
+		if (!i.accelerator->intersect(objectRay, hit, tmin * scale, tmax * scale, onlyFrontFaces)) return false;
+		const FloatType t = hit.t / scale;
+		//equal distances go to the lower instance, so the result does not depend on the traversal order
+		if (t > result.t || (t == result.t && result.isValid() && result.instance < instance)) return false;
+		static_cast<typename TriMeshRayAccelerator<FloatType>::Intersection&>(result) = hit;
+		result.t = t;
+		result.instance = instance;
+		return true;
+	}
+
+	//! nearer child first; pending subtrees behind the closest hit are skipped. With AnyHit, returns at the first hit
+	template <bool AnyHit>
+	bool traverse(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces, Intersection& result) const {
+		FloatType tRoot;
+		if (m_Nodes.empty() || !m_Nodes[0].boundingBox.intersect(r, tmin, tmax, tRoot)) return false;
+
+		struct StackEntry {
+			size_t node;
+			FloatType tNear;
+		};
+		const unsigned int fixedStackSize = 64;
+		StackEntry fixedStack[fixedStackSize];
+		std::vector<StackEntry> largeStack;
+		StackEntry* stack = fixedStack;
+		if (m_Depth > fixedStackSize) {
+			largeStack.resize(m_Depth);
+			stack = largeStack.data();
+		}
+
+		size_t stackSize = 0;
+		size_t nodeIndex = 0;
+		while (true) {
+			const Node& node = m_Nodes[nodeIndex];
+			if (node.isLeaf()) {
+				for (size_t i = (size_t)node.offset; i < (size_t)(node.offset + node.count); i++) {
+					if (intersectInstance(m_Order[i], r, tmin, tmax, onlyFrontFaces, AnyHit, result)) {
+						if (AnyHit) return true;
+						tmax = result.t;
+					}
+				}
+			}
+			else {
+				FloatType tFirst, tSecond;
+				const bool hitFirst = m_Nodes[nodeIndex + 1].boundingBox.intersect(r, tmin, tmax, tFirst);
+				const bool hitSecond = m_Nodes[(size_t)node.offset].boundingBox.intersect(r, tmin, tmax, tSecond);
+				if (hitFirst && hitSecond) {
+					const bool secondIsNearer = tSecond < tFirst;
+					StackEntry farther = { secondIsNearer ? nodeIndex + 1 : (size_t)node.offset, secondIsNearer ? tFirst : tSecond };
+					stack[stackSize++] = farther;
+					nodeIndex = secondIsNearer ? (size_t)node.offset : nodeIndex + 1;
+					continue;
+				}
+				if (hitFirst || hitSecond) {
+					nodeIndex = hitFirst ? nodeIndex + 1 : (size_t)node.offset;
+					continue;
+				}
+			}
+
+			while (stackSize > 0 && stack[stackSize - 1].tNear > tmax) stackSize--;
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize].node;
+		}
+		return result.isValid();
+	}
+
+
+	std::vector<Instance> m_Instances;
+	std::map<const TriMeshRayAccelerator<FloatType>*, BoundingBox3<FloatType>> m_ObjectBounds;
+	//! top-level tree in depth-first order; leaves reference m_Order, which holds instance indices
+	std::vector<Node, AlignedAllocator<Node, 32>> m_Nodes;
+	std::vector<UINT> m_Order;
+	unsigned int m_Depth;
+};
+
+typedef TriMeshAcceleratorInstanced<float>	TriMeshAcceleratorInstancedf;
+typedef TriMeshAcceleratorInstanced<double>	TriMeshAcceleratorInstancedd;
+
+} // namespace ml
+
+#endif
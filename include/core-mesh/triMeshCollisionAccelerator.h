@@ -8,6 +8,9 @@ template<class FloatType, class ChildType>
 class TriMeshCollisionAccelerator : virtual public TriMeshAccelerator<FloatType>
 {
 public:
+	//! two intersecting triangles: the first of this accelerator, the second of the other one (in its own space)
+	typedef std::pair<const typename TriMesh<FloatType>::Triangle*, const typename TriMesh<FloatType>::Triangle*> TrianglePair;
+
 	bool collision(const ChildType &accel) const {
 		return collisionInternal(accel);
 	}
@@ -20,10 +23,23 @@ public:
         return collisionTransformBBoxOnlyInternal(accel, transform);
     }
 
+	//! replaces pairs by all pairs of intersecting triangles; with firstOnly, the search ends as soon as one is found and pairs holds
+	//! one of them. Returns true if there is any
+	bool collision(const ChildType& accel, std::vector<TrianglePair>& pairs, bool firstOnly = false) const {
+		return collision(accel, Matrix4x4<FloatType>::identity(), pairs, firstOnly);
+	}
+
+	//! as above, with accel moved by the affine transform, which maps the space of accel into the space of this accelerator
+	bool collision(const ChildType& accel, const Matrix4x4<FloatType>& transform, std::vector<TrianglePair>& pairs, bool firstOnly = false) const {
+		pairs.clear();
+		return collisionPairsInternal(accel, transform, pairs, firstOnly);
+	}
+
 private:
 	virtual bool collisionInternal(const ChildType& accel) const = 0;
     virtual bool collisionTransformInternal(const ChildType& accel, const Matrix4x4<FloatType>& transform) const = 0;
     virtual bool collisionTransformBBoxOnlyInternal(const ChildType& accel, const Matrix4x4<FloatType>& transform) const = 0;
+	virtual bool collisionPairsInternal(const ChildType& accel, const Matrix4x4<FloatType>& transform, std::vector<TrianglePair>& pairs, bool firstOnly) const = 0;
 };
 
 //typedef TriMeshCollisionAccelerator<float> TriMeshCollisionAcceleratorf;
@@ -67,6 +67,66 @@ public:
 		return i;
 	}
 
+	//! returns true if any triangle is hit within [tmin, tmax] (e.g., a shadow ray or a visibility test between two points);
+	//! the traversal stops at the first hit it finds instead of searching for the closest one
+	bool occluded(const Ray<FloatType>& r, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		return occludedInternal(r, tmin, tmax, onlyFrontFaces);
+	}
+
+	//! bytes held by the accelerator: its triangles, their blocks and the local vertex copy, plus the nodes of a derived tree
+	virtual size_t getMemoryUsage() const {
+		size_t bytes = this->m_Triangles.size() * sizeof(typename TriMesh<FloatType>::Triangle)
+			+ this->m_TrianglePointers.size() * sizeof(typename TriMesh<FloatType>::Triangle*)
+			+ m_TriangleBlocks.size() * sizeof(TriangleBlockType);
+		for (const auto& vertices : this->m_VerticesCopy) {
+			bytes += vertices.size() * sizeof(typename TriMesh<FloatType>::Vertex);
+		}
+		return bytes;
+	}
+
+	//! intersects a batch of rays; results[i] is identical to intersect(rays[i], tmin, tmax, onlyFrontFaces).
+	//! Windows of the batch are distributed over the global ThreadPool; within a window, rays of similar direction are traversed together in packets.
+	void intersect(const Ray<FloatType>* rays, size_t count, Intersection* results, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const {
+		if (count == 0) return;
+
+		//every task takes a window of consecutive rays, so the reordering stays in cache and coherent input keeps its locality
+		const size_t windowCount = (count + rayWindowSize - 1) / rayWindowSize;
+		parallelFor(0, windowCount, 1, [&](size_t window) {
+			const size_t windowBegin = window * rayWindowSize;
+			const unsigned int windowSize = (unsigned int)(std::min(count, windowBegin + rayWindowSize) - windowBegin);
+
+			//stable counting sort by direction octant and a 2x2x2 grid on the normalized |direction|
+			const unsigned int bucketCount = 64;
+			unsigned char keys[rayWindowSize];
+			unsigned int bucketStart[bucketCount + 1] = { 0 };
+			for (unsigned int i = 0; i < windowSize; i++) {
+				const Ray<FloatType>& r = rays[windowBegin + i];
+				const vec3<FloatType>& d = r.getDirection();
+				const FloatType length = std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+				unsigned int key = (unsigned int)(r.getSign().x | (r.getSign().y << 1) | (r.getSign().z << 2)) << 3;
+				for (unsigned int a = 0; a < 3; a++) {
+					if (std::abs(d[a]) * 2 > length) key |= 1u << a;
+				}
+				keys[i] = (unsigned char)key;
+				bucketStart[key + 1]++;
+			}
+			for (unsigned int b = 0; b < bucketCount; b++) bucketStart[b + 1] += bucketStart[b];
+			unsigned int order[rayWindowSize];
+			for (unsigned int i = 0; i < windowSize; i++) order[bucketStart[keys[i]]++] = i;
+
+			const Ray<FloatType>* packetRays[rayPacketSize];
+			Intersection* packetResults[rayPacketSize];
+			for (unsigned int begin = 0; begin < windowSize; begin += rayPacketSize) {
+				const unsigned int packetSize = std::min(windowSize - begin, (unsigned int)rayPacketSize);
+				for (unsigned int i = 0; i < packetSize; i++) {
+					packetRays[i] = &rays[windowBegin + order[begin + i]];
+					packetResults[i] = &results[windowBegin + order[begin + i]];
+				}
+				intersectPacketInternal(packetRays, packetResults, packetSize, tmin, tmax, onlyFrontFaces);
+			}
+		});
+	}
+
 
 	template<class Accelerator>
 	static Intersection getFirstIntersection(
@@ -156,10 +216,87 @@ public:
         return i.isValid();
     }
 
+protected:
+	static const unsigned int rayPacketSize = 8;
+	static const unsigned int rayWindowSize = 1024;
+
+	//! traverses up to rayPacketSize rays; the default intersects them one by one
+	virtual void intersectPacketInternal(const Ray<FloatType>* const* rays, Intersection* const* results, unsigned int count, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		for (unsigned int i = 0; i < count; i++) {
+			Intersection& result = *results[i];
+			result.triangle = intersectInternal(*rays[i], result.t, result.u, result.v, tmin, tmax, onlyFrontFaces);
+		}
+	}
+
+	static const unsigned int triangleBlockWidth = 8;
+	typedef TriangleBlock<FloatType, triangleBlockWidth> TriangleBlockType;
+
+	//! corners of the triangles in blocks for the ray queries: block b holds m_TrianglePointers[triangleBlockWidth * b + i] in slot i.
+	//! The accelerators fill them after building and after their triangles moved (refit)
+	std::vector<TriangleBlockType, AlignedAllocator<TriangleBlockType, 32>> m_TriangleBlocks;
+
+	void updateTriangleBlocks() {
+		const std::vector<typename TriMesh<FloatType>::Triangle*>& tris = TriMeshAccelerator<FloatType>::m_TrianglePointers;
+		m_TriangleBlocks.resize((tris.size() + triangleBlockWidth - 1) / triangleBlockWidth);
+		for (size_t i = 0; i < m_TriangleBlocks.size() * triangleBlockWidth; i++) {
+			TriangleBlockType& block = m_TriangleBlocks[i / triangleBlockWidth];
+			if (i < tris.size()) block.set(i % triangleBlockWidth, tris[i]->getV0().position, tris[i]->getV1().position, tris[i]->getV2().position);
+			else block.clear(i % triangleBlockWidth);
+		}
+	}
+
+	//! closest hit among the triangles [begin, end) of m_TrianglePointers, tested a block at a time. A triangle replaces hit if it is
+	//! closer, or equally close and stored earlier (the triangle pointers of an accelerator point into one array), so the result does
+	//! not depend on the order in which the accelerators visit the triangles. Returns true if hit changed
+	bool intersectTriangles(const TriangleBlockRay<FloatType>& ray, size_t begin, size_t end, FloatType& t, FloatType& u, FloatType& v, FloatType tmin, FloatType& tmax, bool onlyFrontFaces, const typename TriMesh<FloatType>::Triangle*& hit) const {
+		const typename TriMesh<FloatType>::Triangle* const* tris = TriMeshAccelerator<FloatType>::m_TrianglePointers.data();
+		bool changed = false;
+		FloatType blockT[triangleBlockWidth], blockU[triangleBlockWidth], blockV[triangleBlockWidth];
+		for (size_t b = begin / triangleBlockWidth; b * triangleBlockWidth < end; b++) {
+			const size_t first = b * triangleBlockWidth;
+			const unsigned int slotMask = getSlotMask(first, begin, end);
+			unsigned int mask = TriangleBlockTest<FloatType, triangleBlockWidth>::intersect(m_TriangleBlocks[b], slotMask, ray, tmin, tmax, onlyFrontFaces, blockT, blockU, blockV);
+			for (unsigned int i = 0; mask != 0; i++, mask >>= 1) {
+				if (!(mask & 1) || blockT[i] > tmax) continue;
+				const typename TriMesh<FloatType>::Triangle* tri = tris[first + i];
+				if (hit && blockT[i] == tmax && hit < tri) continue;
+				t = tmax = blockT[i];
+				u = blockU[i];
+				v = blockV[i];
+				hit = tri;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+
+	//! true if any of the triangles [begin, end) of m_TrianglePointers is hit within [tmin, tmax]
+	bool occludedTriangles(const TriangleBlockRay<FloatType>& ray, size_t begin, size_t end, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		FloatType blockT[triangleBlockWidth], blockU[triangleBlockWidth], blockV[triangleBlockWidth];
+		for (size_t b = begin / triangleBlockWidth; b * triangleBlockWidth < end; b++) {
+			const unsigned int slotMask = getSlotMask(b * triangleBlockWidth, begin, end);
+			if (TriangleBlockTest<FloatType, triangleBlockWidth>::intersect(m_TriangleBlocks[b], slotMask, ray, tmin, tmax, onlyFrontFaces, blockT, blockU, blockV) != 0) return true;
+		}
+		return false;
+	}
+
 private:
+	//! slots of the block starting at triangle first that lie in [begin, end)
+	static unsigned int getSlotMask(size_t first, size_t begin, size_t end) {
+		unsigned int mask = (1u << triangleBlockWidth) - 1;
+		if (begin > first) mask &= mask << (begin - first);
+		if (end < first + triangleBlockWidth) mask &= (1u << (end - first)) - 1;
+		return mask;
+	}
 
 	virtual const typename TriMesh<FloatType>::Triangle* intersectInternal(const Ray<FloatType>& r, FloatType& t, FloatType& u, FloatType& v, FloatType tmin = (FloatType)0, FloatType tmax = std::numeric_limits<FloatType>::max(), bool onlyFrontFaces = false) const = 0;
 
+	//! any-hit query; accelerators without an early-out traversal fall back to the closest hit
+	virtual bool occludedInternal(const Ray<FloatType>& r, FloatType tmin, FloatType tmax, bool onlyFrontFaces) const {
+		FloatType t, u, v;
+		return intersectInternal(r, t, u, v, tmin, tmax, onlyFrontFaces) != nullptr;
+	}
+
 };
 
 typedef TriMeshRayAccelerator<float> TriMeshRayAcceleratorf;
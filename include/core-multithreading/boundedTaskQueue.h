@@ -0,0 +1,134 @@
+#ifndef CORE_MULTITHREADING_BOUNDEDTASKQUEUE_H_
+#define CORE_MULTITHREADING_BOUNDEDTASKQUEUE_H_
+
+namespace ml
+{
+
+//
+// lock-free bounded multi-producer/multi-consumer FIFO with the interface of TaskList.
+// Every cell carries a sequence number that tells producers and consumers whether it is free or filled,
+// so insert and getNextTask each cost one compare-and-swap on the shared position and never take a lock.
+// Can be passed to ThreadPool::runTasks, is the backing store of the worker queues, and works as a standalone
+// producer/consumer channel. The capacity is rounded up to a power of two.
+//
+template <class T> class BoundedTaskQueue
+{
+public:
+	BoundedTaskQueue(size_t capacity = 1024)
+	{
+		size_t size = 2;
+		while(size < capacity) size *= 2;
+
+		m_mask = size - 1;
+		m_cells = std::unique_ptr<Cell[]>(new Cell[size]);
+		for(size_t i = 0; i < size; i++)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		m_insertPosition.store(0, std::memory_order_relaxed);
+		m_removePosition.store(0, std::memory_order_relaxed);
+	}
+
+	//! inserts the task; if the queue is full, waits until a consumer has made room
+	void insert(const T &task)
+	{
+		while(!tryInsert(task))
+			std::this_thread::yield();
+	}
+
+	//! returns false if the queue is full
+	bool tryInsert(const T &task)
+	{
+		size_t position = m_insertPosition.load(std::memory_order_relaxed);
+		while(true)
+		{
+			Cell &cell = m_cells[position & m_mask];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+			if(difference == 0)
+			{
+				if(m_insertPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.data = task;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_insertPosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool getNextTask(T &nextTask)
+	{
+		size_t position = m_removePosition.load(std::memory_order_relaxed);
+		while(true)
+		{
+			Cell &cell = m_cells[position & m_mask];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+			if(difference == 0)
+			{
+				if(m_removePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					nextTask = cell.data;
+					cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_removePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	//! a snapshot; other threads may change the count at any time
+	UINT64 tasksLeft() const
+	{
+		const size_t removePosition = m_removePosition.load(std::memory_order_acquire);
+		const size_t insertPosition = m_insertPosition.load(std::memory_order_acquire);
+		return insertPosition > removePosition ? (UINT64)(insertPosition - removePosition) : 0;
+	}
+
+	bool done() const
+	{
+		return tasksLeft() == 0;
+	}
+
+	size_t capacity() const
+	{
+		return m_mask + 1;
+	}
+
+private:
+	BoundedTaskQueue(const BoundedTaskQueue&);
+	BoundedTaskQueue& operator=(const BoundedTaskQueue&);
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	//the two positions are written by different sides, so they live on separate cache lines
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+	char m_pad0[64];
+	std::atomic<size_t> m_insertPosition;
+	char m_pad1[64];
+	std::atomic<size_t> m_removePosition;
+	char m_pad2[64];
+};
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_BOUNDEDTASKQUEUE_H_
@@ -0,0 +1,42 @@
+#ifndef CORE_MULTITHREADING_CPUTOPOLOGY_H_
+#define CORE_MULTITHREADING_CPUTOPOLOGY_H_
+
+namespace ml
+{
+
+//
+// NUMA nodes and the logical CPUs that belong to them, restricted to the CPUs this process may run on.
+// Read from /sys/devices/system/node on Linux and from the NUMA API on Windows;
+// if that information is unavailable there is a single node containing all hardware threads.
+//
+class CPUTopology
+{
+public:
+	//! detected on first use
+	static const CPUTopology& get();
+
+	UINT getNodeCount() const
+	{
+		return (UINT)m_nodeCPUs.size();
+	}
+	const std::vector<UINT>& getNodeCPUs(UINT node) const
+	{
+		return m_nodeCPUs[node];
+	}
+	UINT getCPUCount() const;
+
+	//! restricts the calling thread to the given logical CPUs; returns false if the OS refused or pinning is unsupported
+	static bool pinCurrentThread(const std::vector<UINT> &cpus);
+
+private:
+	CPUTopology();
+
+	//! parses lists such as "0-3,8,10-11"
+	static std::vector<UINT> parseCPUList(const std::string &list);
+
+	std::vector< std::vector<UINT> > m_nodeCPUs;
+};
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_CPUTOPOLOGY_H_
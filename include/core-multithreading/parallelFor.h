@@ -0,0 +1,181 @@
+#ifndef CORE_MULTITHREADING_PARALLELFOR_H_
+#define CORE_MULTITHREADING_PARALLELFOR_H_
+
+namespace ml
+{
+
+namespace parallel
+{
+	//! chunk size used when grainSize is 0: a few chunks per thread so that stealing can balance uneven work
+	inline size_t automaticGrainSize(const ThreadPool &pool, size_t elementCount)
+	{
+		const size_t targetChunks = 4 * ((size_t)pool.getThreadCount() + 1);
+		return std::max((size_t)1, (elementCount + targetChunks - 1) / targetChunks);
+	}
+}
+
+//
+// calls body(i) for every i in [begin, end). The range is cut into chunks of grainSize indices
+// (0 picks a size automatically) which are handed out to the workers of the pool through a shared counter;
+// the calling thread works on chunks as well. Nothing is allocated per chunk or per call.
+//
+template<class Body>
+void parallelFor(ThreadPool &pool, size_t begin, size_t end, size_t grainSize, const Body &body)
+{
+	if(end <= begin)
+		return;
+
+	const size_t elementCount = end - begin;
+	if(grainSize == 0)
+		grainSize = parallel::automaticGrainSize(pool, elementCount);
+	const size_t chunkCount = (elementCount + grainSize - 1) / grainSize;
+
+	if(chunkCount == 1 || pool.getThreadCount() == 0)
+	{
+		for(size_t i = begin; i < end; i++)
+			body(i);
+		return;
+	}
+
+	struct Context
+	{
+		static void runChunk(void *context, size_t chunkIndex)
+		{
+			const Context &c = *(const Context*)context;
+			const size_t chunkBegin = c.begin + chunkIndex * c.grainSize;
+			const size_t chunkEnd = std::min(chunkBegin + c.grainSize, c.end);
+			for(size_t i = chunkBegin; i < chunkEnd; i++)
+				(*c.body)(i);
+		}
+
+		const Body *body;
+		size_t begin, end, grainSize;
+	};
+
+	Context context;
+	context.body = &body;
+	context.begin = begin;
+	context.end = end;
+	context.grainSize = grainSize;
+	pool.runChunks(chunkCount, Context::runChunk, &context);
+}
+
+template<class Body>
+void parallelFor(size_t begin, size_t end, size_t grainSize, const Body &body)
+{
+	parallelFor(ThreadPool::getGlobal(), begin, end, grainSize, body);
+}
+
+template<class Body>
+void parallelFor(size_t begin, size_t end, const Body &body)
+{
+	parallelFor(ThreadPool::getGlobal(), begin, end, 0, body);
+}
+
+//
+// computes combine(...combine(combine(identity, map(begin)), map(begin + 1))..., map(end - 1)) in parallel.
+// Each chunk folds its indices into its own partial result; the partials are combined in chunk order,
+// so for a fixed grainSize the result does not depend on scheduling, even for non-associative floating-point sums.
+//
+template<class T, class Map, class Combine>
+T parallelReduce(ThreadPool &pool, size_t begin, size_t end, const T &identity, const Map &map, const Combine &combine, size_t grainSize = 0)
+{
+	if(end <= begin)
+		return identity;
+
+	const size_t elementCount = end - begin;
+	if(grainSize == 0)
+		grainSize = parallel::automaticGrainSize(pool, elementCount);
+	const size_t chunkCount = (elementCount + grainSize - 1) / grainSize;
+
+	//one cache line per partial: workers never write to the same line, and T = bool does not become a packed std::vector<bool>
+	struct alignas(64) Slot
+	{
+		T value;
+	};
+	std::vector<Slot, AlignedAllocator<Slot, 64>> partials(chunkCount, Slot{ identity });
+	parallelFor(pool, 0, chunkCount, 1, [&](size_t chunkIndex)
+	{
+		const size_t chunkBegin = begin + chunkIndex * grainSize;
+		const size_t chunkEnd = std::min(chunkBegin + grainSize, end);
+		T partial = identity;
+		for(size_t i = chunkBegin; i < chunkEnd; i++)
+			partial = combine(partial, map(i));
+		partials[chunkIndex].value = partial;
+	});
+
+	T result = identity;
+	for(const Slot &partial : partials)
+		result = combine(result, partial.value);
+	return result;
+}
+
+template<class T, class Map, class Combine>
+T parallelReduce(size_t begin, size_t end, const T &identity, const Map &map, const Combine &combine, size_t grainSize = 0)
+{
+	return parallelReduce(ThreadPool::getGlobal(), begin, end, identity, map, combine, grainSize);
+}
+
+//
+// calls body(threadIndex) once on every worker of the pool, on that worker's thread
+//
+template<class Body>
+void parallelForEachWorker(ThreadPool &pool, const Body &body)
+{
+	struct Context
+	{
+		static void runWorker(void *context, UINT threadIndex)
+		{
+			(*((const Context*)context)->body)(threadIndex);
+		}
+		const Body *body;
+	};
+
+	Context context;
+	context.body = &body;
+	pool.runOnEachWorker(Context::runWorker, &context);
+}
+
+//
+// static partition of [begin, end): worker w always processes the w-th of getThreadCount() contiguous blocks.
+// Unlike parallelFor there is no load balancing, but the same indices land on the same (pinned) worker in every call,
+// so memory initialized with parallelForStatic is local to the worker that later processes it (first touch).
+//
+template<class Body>
+void parallelForStatic(ThreadPool &pool, size_t begin, size_t end, const Body &body)
+{
+	if(end <= begin)
+		return;
+
+	const size_t elementCount = end - begin;
+	const size_t blockCount = std::max((size_t)1, (size_t)pool.getThreadCount());
+	parallelForEachWorker(pool, [&](UINT threadIndex)
+	{
+		const size_t blockBegin = begin + elementCount * threadIndex / blockCount;
+		const size_t blockEnd = begin + elementCount * (threadIndex + 1) / blockCount;
+		for(size_t i = blockBegin; i < blockEnd; i++)
+			body(i);
+	});
+}
+
+template<class T> class Grid3;
+
+//
+// first-touch initialization of a freshly allocated grid (Grid3(dimX, dimY, dimZ) leaves the memory of trivially
+// constructible types untouched): every worker writes the z-slices it will later get from parallelForStatic
+// over [0, getDimZ()), so on a pool with NUMA placement each slab lives on the node of the worker processing it.
+//
+template<class T>
+void firstTouchFill(ThreadPool &pool, Grid3<T> &grid, const T &value)
+{
+	const size_t sliceSize = grid.getDimX() * grid.getDimY();
+	T *data = grid.getData();
+	parallelForStatic(pool, 0, grid.getDimZ(), [&](size_t z)
+	{
+		std::fill(data + z * sliceSize, data + (z + 1) * sliceSize, value);
+	});
+}
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_PARALLELFOR_H_
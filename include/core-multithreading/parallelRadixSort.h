@@ -0,0 +1,82 @@
+#ifndef CORE_MULTITHREADING_PARALLELRADIXSORT_H_
+#define CORE_MULTITHREADING_PARALLELRADIXSORT_H_
+
+namespace ml
+{
+
+//
+// sorts (key, value) pairs by the lowest keyBits bits of their unsigned integer keys with a least-significant-digit radix
+// sort, 8 bits per pass. Passes cover whole bytes, so keyBits is rounded up to a multiple of 8 and the key bits between
+// keyBits and that multiple must be zero; bits beyond it are ignored. The sort is stable. In every pass the array is cut
+// into one chunk per task: the chunks count their digits in parallel, a prefix sum over (digit, chunk) gives every chunk
+// its output positions, and the chunks scatter in parallel. Passes in which all keys share the digit are skipped. Uses a
+// temporary array of the same size.
+//
+template<class Key, class Value>
+void parallelRadixSort(ThreadPool &pool, std::vector< std::pair<Key, Value> > &data, unsigned int keyBits = 8 * sizeof(Key))
+{
+	const size_t count = data.size();
+	if(count <= 1)
+		return;
+
+	const unsigned int digitBits = 8;
+	const size_t digitCount = (size_t)1 << digitBits;
+	const size_t minChunkSize = 4096;
+	const size_t chunkCount = std::max((size_t)1, std::min(4 * ((size_t)pool.getThreadCount() + 1), count / minChunkSize));
+	const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+	std::vector< std::pair<Key, Value> > buffer(count);
+	std::vector<size_t> offsets(chunkCount * digitCount);
+	std::vector< std::pair<Key, Value> > *source = &data, *target = &buffer;
+
+	for(unsigned int shift = 0; shift < keyBits; shift += digitBits)
+	{
+		std::fill(offsets.begin(), offsets.end(), (size_t)0);
+		parallelFor(pool, 0, chunkCount, 1, [&](size_t chunk) {
+			size_t *histogram = &offsets[chunk * digitCount];
+			const size_t end = std::min(count, (chunk + 1) * chunkSize);
+			for(size_t i = chunk * chunkSize; i < end; i++)
+				histogram[((*source)[i].first >> shift) & (digitCount - 1)]++;
+		});
+
+		//exclusive prefix sum, digit-major so that equal digits stay in chunk order
+		size_t sum = 0;
+		bool singleDigit = false;
+		for(size_t digit = 0; digit < digitCount; digit++)
+		{
+			size_t digitTotal = 0;
+			for(size_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				const size_t c = offsets[chunk * digitCount + digit];
+				offsets[chunk * digitCount + digit] = sum;
+				sum += c;
+				digitTotal += c;
+			}
+			if(digitTotal == count)
+				singleDigit = true;
+		}
+		if(singleDigit)
+			continue;
+
+		parallelFor(pool, 0, chunkCount, 1, [&](size_t chunk) {
+			size_t *position = &offsets[chunk * digitCount];
+			const size_t end = std::min(count, (chunk + 1) * chunkSize);
+			for(size_t i = chunk * chunkSize; i < end; i++)
+				(*target)[position[((*source)[i].first >> shift) & (digitCount - 1)]++] = (*source)[i];
+		});
+		std::swap(source, target);
+	}
+
+	if(source != &data)
+		data.swap(buffer);
+}
+
+template<class Key, class Value>
+void parallelRadixSort(std::vector< std::pair<Key, Value> > &data, unsigned int keyBits = 8 * sizeof(Key))
+{
+	parallelRadixSort(ThreadPool::getGlobal(), data, keyBits);
+}
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_PARALLELRADIXSORT_H_
@@ -0,0 +1,412 @@
+#ifndef CORE_MULTITHREADING_TASKFUTURE_H_
+#define CORE_MULTITHREADING_TASKFUTURE_H_
+
+namespace ml
+{
+
+//
+// recycles the memory of small future states per thread, so ThreadPool::submit does not hit the heap in steady state.
+// Larger states fall back to operator new; states whose result or callable is over-aligned (e.g. a TriangleBlock)
+// get a block aligned by hand, since operator new only guarantees the alignment of std::max_align_t.
+//
+class TaskFutureAllocator
+{
+public:
+	static const size_t blockSize = 128;
+	static const size_t maxCachedBlocks = 1024;
+
+	static void* allocate(size_t size, size_t alignment)
+	{
+		if(alignment > alignof(std::max_align_t))
+		{
+			char *memory = (char*)::operator new(size + alignment);
+			char *aligned = memory + alignment - ((size_t)memory & (alignment - 1));
+			((void**)aligned)[-1] = memory;
+			return aligned;
+		}
+		if(size > blockSize)
+			return ::operator new(size);
+
+		FreeList *list = getFreeList();
+		if(list == nullptr || list->head == nullptr)
+			return ::operator new(blockSize);
+
+		Block *block = list->head;
+		list->head = block->next;
+		list->count--;
+		return block;
+	}
+
+	static void deallocate(void *memory, size_t size, size_t alignment)
+	{
+		if(alignment > alignof(std::max_align_t))
+		{
+			::operator delete(((void**)memory)[-1]);
+			return;
+		}
+
+		FreeList *list = size > blockSize ? nullptr : getFreeList();
+		if(list == nullptr || list->count == maxCachedBlocks)
+		{
+			::operator delete(memory);
+			return;
+		}
+
+		Block *block = (Block*)memory;
+		block->next = list->head;
+		list->head = block;
+		list->count++;
+	}
+
+private:
+	struct Block
+	{
+		Block *next;
+	};
+	struct FreeList
+	{
+		FreeList()
+		{
+			head = nullptr;
+			count = 0;
+		}
+		~FreeList()
+		{
+			freeListDestroyed() = true;
+			while(head != nullptr)
+			{
+				Block *next = head->next;
+				::operator delete(head);
+				head = next;
+			}
+		}
+		Block *head;
+		size_t count;
+	};
+
+	//! nullptr once the thread's list has been destroyed: ThreadPool::shutdown runs leftover tasks from the destructor of the
+	//! global pool, after the main thread's thread_locals are gone, and futures held in static objects are released then too
+	static FreeList* getFreeList()
+	{
+		if(freeListDestroyed())
+			return nullptr;
+		static thread_local FreeList list;
+		return &list;
+	}
+	//! trivially destructible, so it can still be read after the list is destroyed
+	static bool& freeListDestroyed()
+	{
+		static thread_local bool destroyed = false;
+		return destroyed;
+	}
+};
+
+//
+// state shared by a TaskFuture and the queued task. It is referenced twice: once by the future and once by the queue entry.
+//
+class TaskFutureStateBase
+{
+public:
+	TaskFutureStateBase(ThreadPool *pool)
+	{
+		m_pool = pool;
+		m_referenceCount = 2;
+		m_group.pendingTasks = 1;
+	}
+	virtual ~TaskFutureStateBase() {}
+
+	bool ready() const
+	{
+		return m_group.done();
+	}
+	//! a worker of the pool runs other tasks while it waits
+	void wait()
+	{
+		if(!ready())
+			m_pool->waitForGroup(m_group);
+	}
+
+	ThreadPool* getPool() const
+	{
+		return m_pool;
+	}
+
+	void release()
+	{
+		if(--m_referenceCount == 0)
+			destroy();
+	}
+
+	struct Releaser
+	{
+		void operator()(TaskFutureStateBase *state) const
+		{
+			state->release();
+		}
+	};
+
+	//! queue entry function; the completion counter is cleared here instead of in ThreadPool::runTask
+	//! because the entry's reference may be the last one
+	static void run(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+	{
+		TaskFutureStateBase *state = (TaskFutureStateBase*)data;
+		state->execute();
+		state->m_group.pendingTasks = 0;
+		state->m_pool->notifyGroupDone();
+		state->release();
+	}
+
+protected:
+	virtual void execute() = 0;
+	//! destructs the state and returns its memory; only the most derived class knows its size and alignment
+	virtual void destroy() = 0;
+
+	std::exception_ptr m_exception;
+
+private:
+	ThreadPool *m_pool;
+	WorkerThreadTaskGroup m_group;
+	std::atomic<UINT> m_referenceCount;
+};
+
+template<class T>
+class TaskFutureState : public TaskFutureStateBase
+{
+public:
+	TaskFutureState(ThreadPool *pool) : TaskFutureStateBase(pool)
+	{
+		m_hasValue = false;
+	}
+	~TaskFutureState()
+	{
+		if(m_hasValue)
+			((T*)&m_value)->~T();
+	}
+
+	T takeResult()
+	{
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+		return std::move(*(T*)&m_value);
+	}
+
+protected:
+	template<class Function>
+	void store(Function &function)
+	{
+		try
+		{
+			new (&m_value) T(function());
+			m_hasValue = true;
+		}
+		catch(...)
+		{
+			m_exception = std::current_exception();
+		}
+	}
+
+private:
+	typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type m_value;
+	bool m_hasValue;
+};
+
+template<>
+class TaskFutureState<void> : public TaskFutureStateBase
+{
+public:
+	TaskFutureState(ThreadPool *pool) : TaskFutureStateBase(pool) {}
+
+	void takeResult()
+	{
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+	}
+
+protected:
+	template<class Function>
+	void store(Function &function)
+	{
+		try
+		{
+			function();
+		}
+		catch(...)
+		{
+			m_exception = std::current_exception();
+		}
+	}
+};
+
+//! the callable lives inside the shared state, so submitting it takes a single (usually recycled) allocation
+template<class T, class Function>
+class TaskFutureCallable : public TaskFutureState<T>
+{
+public:
+	template<class FunctionArgument>
+	TaskFutureCallable(ThreadPool *pool, FunctionArgument &&function)
+		: TaskFutureState<T>(pool), m_function(std::forward<FunctionArgument>(function)) {}
+
+protected:
+	void execute()
+	{
+		this->store(m_function);
+	}
+	void destroy()
+	{
+		this->~TaskFutureCallable();
+		TaskFutureAllocator::deallocate(this, sizeof(TaskFutureCallable), alignof(TaskFutureCallable));
+	}
+
+private:
+	Function m_function;
+};
+
+//
+// result of ThreadPool::submit. Move-only; get() may be called once. Destroying a future without calling get()
+// is allowed, the task still runs.
+//
+template<class T>
+class TaskFuture
+{
+public:
+	TaskFuture()
+	{
+		m_state = nullptr;
+	}
+	explicit TaskFuture(TaskFutureState<T> *state)
+	{
+		m_state = state;
+	}
+	TaskFuture(TaskFuture &&other)
+	{
+		m_state = other.m_state;
+		other.m_state = nullptr;
+	}
+	~TaskFuture()
+	{
+		reset();
+	}
+
+	TaskFuture& operator=(TaskFuture &&other)
+	{
+		if(this != &other)
+		{
+			reset();
+			m_state = other.m_state;
+			other.m_state = nullptr;
+		}
+		return *this;
+	}
+
+	bool valid() const
+	{
+		return m_state != nullptr;
+	}
+	bool ready() const
+	{
+		return m_state->ready();
+	}
+	void wait() const
+	{
+		m_state->wait();
+	}
+
+	//! waits for the task and returns its result, or rethrows the exception it threw; the future is empty afterwards
+	T get()
+	{
+		MLIB_ASSERT_STR(valid(), "get called on an empty future");
+		m_state->wait();
+		std::unique_ptr<TaskFutureState<T>, TaskFutureStateBase::Releaser> state(m_state);
+		m_state = nullptr;
+		return state->takeResult();
+	}
+
+	ThreadPool* getPool() const
+	{
+		return m_state->getPool();
+	}
+
+private:
+	TaskFuture(const TaskFuture&);
+	TaskFuture& operator=(const TaskFuture&);
+
+	void reset()
+	{
+		if(m_state != nullptr)
+		{
+			m_state->release();
+			m_state = nullptr;
+		}
+	}
+
+	TaskFutureState<T> *m_state;
+};
+
+template<class Function>
+TaskFuture<typename std::result_of<typename std::decay<Function>::type&()>::type> ThreadPool::submit(Function &&function)
+{
+	typedef typename std::decay<Function>::type FunctionType;
+	typedef typename std::result_of<FunctionType&()>::type ResultType;
+	typedef TaskFutureCallable<ResultType, FunctionType> State;
+
+	State *state = new (TaskFutureAllocator::allocate(sizeof(State), alignof(State))) State(this, std::forward<Function>(function));
+	TaskFutureStateBase *stateBase = state;
+	if(m_threads.size() == 0)
+	{
+		TaskFutureStateBase::run(stateBase, 0, nullptr);
+		return TaskFuture<ResultType>(state);
+	}
+
+	WorkerThreadQueueEntry entry;
+	entry.run = TaskFutureStateBase::run;
+	entry.data = stateBase;
+	entry.group = nullptr;
+	pushTasks(entry, 1);
+	return TaskFuture<ResultType>(state);
+}
+
+//! collects the results of a set of futures in order; the exception of the first failing future is rethrown
+template<class T>
+struct TaskFutureJoin
+{
+	typedef std::vector<T> Result;
+
+	Result operator()()
+	{
+		Result results;
+		results.reserve(futures.size());
+		for(auto &future : futures)
+			results.push_back(future.get());
+		return results;
+	}
+
+	std::vector< TaskFuture<T> > futures;
+};
+
+template<>
+struct TaskFutureJoin<void>
+{
+	typedef void Result;
+
+	void operator()()
+	{
+		for(auto &future : futures)
+			future.get();
+	}
+
+	std::vector< TaskFuture<void> > futures;
+};
+
+//! returns a future that becomes ready once all given futures are; it runs on the pool of the first future
+template<class T>
+TaskFuture<typename TaskFutureJoin<T>::Result> whenAll(std::vector< TaskFuture<T> > futures)
+{
+	ThreadPool &pool = futures.size() > 0 ? *futures[0].getPool() : ThreadPool::getGlobal();
+	TaskFutureJoin<T> join;
+	join.futures = std::move(futures);
+	return pool.submit(std::move(join));
+}
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_TASKFUTURE_H_
@@ -0,0 +1,108 @@
+#ifndef CORE_MULTITHREADING_TASKGRAPH_H_
+#define CORE_MULTITHREADING_TASKGRAPH_H_
+
+namespace ml
+{
+
+//
+// DAG of tasks executed on a ThreadPool. A task is released as soon as all of its predecessors have finished,
+// so pipeline stages overlap instead of being separated by global barriers. run() is the final join: it returns once
+// every node, including continuations added while the graph runs, has finished.
+// Start and end times of every node are recorded so the critical path of the last run can be inspected.
+//
+class TaskGraph
+{
+public:
+	typedef UINT NodeID;
+
+	TaskGraph();
+
+	NodeID addTask(const std::string &name, const std::function<void()> &task);
+	NodeID addTask(const std::string &name, const std::function<void()> &task, const std::vector<NodeID> &predecessors);
+
+	//! successor will not start before predecessor has finished; only valid while the graph is not running
+	void addDependency(NodeID predecessor, NodeID successor);
+
+	//! adds a task that runs after predecessor. Unlike addTask this may be called while the graph runs (typically from
+	//! inside a task, to spawn follow-up work); if predecessor has already finished the continuation is released immediately.
+	NodeID addContinuation(NodeID predecessor, const std::string &name, const std::function<void()> &task);
+
+	//! runs all nodes and waits for them; throws if the dependencies contain a cycle
+	void run(ThreadPool &pool);
+	void run()
+	{
+		run(ThreadPool::getGlobal());
+	}
+
+	void clear();
+
+	size_t getNodeCount() const
+	{
+		return m_nodes.size();
+	}
+	const std::string& getNodeName(NodeID node) const
+	{
+		return m_nodes[node]->name;
+	}
+
+	//! timings of the last run in milliseconds, relative to the start of run()
+	double getNodeStartMS(NodeID node) const
+	{
+		return m_nodes[node]->startMS;
+	}
+	double getNodeDurationMS(NodeID node) const
+	{
+		return m_nodes[node]->endMS - m_nodes[node]->startMS;
+	}
+	double getTotalTimeMS() const
+	{
+		return m_totalTimeMS;
+	}
+
+	//! chain of dependent nodes with the largest summed duration in the last run, in execution order
+	std::vector<NodeID> getCriticalPath() const;
+	double getCriticalPathMS() const;
+
+	//! one line per node with thread, start and duration; critical-path nodes are marked with '*'
+	void printTimings(std::ostream &s = std::cout) const;
+
+private:
+	struct Node
+	{
+		TaskGraph *graph;
+		NodeID id;
+		std::string name;
+		std::function<void()> task;
+
+		std::vector<Node*> successors;
+		UINT predecessorCount;
+		std::atomic<UINT> pendingPredecessors;
+		bool finished;		//guarded by TaskGraph::m_mutex while running
+
+		UINT threadIndex;
+		double startMS, endMS;
+	};
+
+	Node* createNode(const std::string &name, const std::function<void()> &task);
+	void checkNode(NodeID node) const;
+	//! nodes in an order that respects all dependencies; throws if there is a cycle
+	std::vector<Node*> topologicalOrder() const;
+
+	static void runNode(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage);
+	void executeNode(Node *node, UINT threadIndex);
+	void releaseNode(Node *node);
+
+	std::vector< std::unique_ptr<Node> > m_nodes;
+
+	mutable std::mutex m_mutex;
+	ThreadPool *m_pool;
+	bool m_running;
+	WorkerThreadTaskGroup m_group;
+	std::vector<Node*> m_inlineQueue;	//ready nodes when the pool has no worker threads
+	double m_startTime;
+	double m_totalTimeMS;
+};
+
+}  // namespace ml
+
+#endif  // CORE_MULTITHREADING_TASKGRAPH_H_
@@ -4,17 +4,120 @@
 namespace ml
 {
 
+template<class T> class TaskFuture;
+
+//
+// where the workers of a ThreadPool run. Workers are split into contiguous groups, one per NUMA node (see CPUTopology),
+// and steal from workers of their own group first.
+//
+enum ThreadPlacement
+{
+	ThreadPlacementOS,			//no pinning, all workers in one group
+	ThreadPlacementCores,		//every worker pinned to one logical CPU of its node
+	ThreadPlacementNUMANodes,	//every worker pinned to the CPU set of its node; the OS may still move it within the node
+};
+
+//
+// pool of persistent worker threads. Workers are created once in init and sleep on a condition
+// variable between batches; each worker owns a queue and steals from the others when it runs dry.
+// A worker that waits for a batch (e.g. a nested runTasks or parallelFor) executes queued tasks while it waits.
+//
 class ThreadPool
 {
 public:
-	~ThreadPool() {}
+	ThreadPool();
+	~ThreadPool();
+
+    void init(UINT threadCount, ThreadPlacement placement = ThreadPlacementOS);
+    void init(UINT threadCount, const std::vector<ThreadLocalStorage*> &threadLocalStorage, ThreadPlacement placement = ThreadPlacementOS);
 
-    void init(UINT threadCount);
-    void init(UINT threadCount, const std::vector<ThreadLocalStorage*> &threadLocalStorage);
+	//! runs and deletes all tasks in the list; returns as soon as the last task has finished
     void runTasks(TaskList<WorkerThreadTask*> &tasks, bool useConsole = true);
+	void runTasks(BoundedTaskQueue<WorkerThreadTask*> &tasks, bool useConsole = true);
+
+	//! calls chunkFunction(context, chunkIndex) for all chunks in [0, chunkCount); the calling thread processes chunks as well.
+	//! This is the primitive behind parallelFor and parallelReduce; nothing is allocated per chunk.
+	void runChunks(size_t chunkCount, void (*chunkFunction)(void *context, size_t chunkIndex), void *context);
+
+	//! calls workerFunction(context, threadIndex) exactly once on every worker thread and waits for all calls.
+	//! This is the primitive behind parallelForStatic and first-touch initialization.
+	void runOnEachWorker(void (*workerFunction)(void *context, UINT threadIndex), void *context);
+
+	//! queues function() and returns immediately; the future yields its result. The callable is moved into the future's
+	//! shared state, so move-only lambdas work, and small states are recycled instead of allocated (see taskFuture.h)
+	template<class Function>
+	TaskFuture<typename std::result_of<typename std::decay<Function>::type&()>::type> submit(Function &&function);
+
+	UINT getThreadCount() const
+	{
+		return (UINT)m_threads.size();
+	}
+	ThreadPlacement getPlacement() const
+	{
+		return m_placement;
+	}
+	//! NUMA node the worker was assigned to (always 0 for ThreadPlacementOS)
+	UINT getWorkerNode(UINT threadIndex) const
+	{
+		return m_workerNodes[threadIndex];
+	}
+
+	//! pool used by parallelFor and parallelReduce unless another pool is given; one worker per hardware thread
+	static ThreadPool& getGlobal();
+
+	//! per-worker counters (tasks, busy/idle/queue-wait time, steals, task-duration histogram); off by default,
+	//! since every task then costs two extra clock reads
+	void setStatisticsEnabled(bool enabled)
+	{
+		m_statisticsEnabled = enabled;
+	}
+	bool getStatisticsEnabled() const
+	{
+		return m_statisticsEnabled;
+	}
+	std::vector<WorkerThreadStatistics> getStatistics() const;
+	void resetStatistics();
+	std::string getStatisticsJSON() const;
+	void saveStatisticsJSON(const std::string &filename) const;
 
 private:
-    std::vector<WorkerThread> m_threads;
+	friend class WorkerThread;
+	friend class TaskGraph;
+	friend class TaskFutureStateBase;
+
+	//! blocks until a task is available for the given worker; returns false once the pool terminates
+	bool acquireTask(UINT threadIndex, WorkerThreadQueueEntry &entry);
+	//! takes a task from the worker's own queue or steals one from another worker; does not block
+	bool findTask(UINT threadIndex, WorkerThreadQueueEntry &entry);
+	void runTask(const WorkerThreadQueueEntry &entry, UINT threadIndex, ThreadLocalStorage *threadLocalStorage);
+
+	//! queues entries on behalf of the calling thread: a worker of this pool pushes to its own queue, other threads deal round-robin
+	void pushTasks(const WorkerThreadQueueEntry &entry, UINT64 count);
+	template<class Queue> void pushTasks(Queue &tasks, WorkerThreadTaskGroup &group);
+	template<class Queue> void runTaskQueue(Queue &tasks, bool useConsole);
+
+	//! returns once all entries of the group have run
+	void waitForGroup(WorkerThreadTaskGroup &group, bool useConsole = false);
+	//! wakes threads blocked in waitForGroup after a group counter has been set to zero outside of runTask
+	void notifyGroupDone();
+
+	WorkerThread* getCurrentWorker() const;
+	void shutdown();
+
+    std::vector< std::unique_ptr<WorkerThread> > m_threads;
+	std::atomic<UINT> m_nextThread;
+
+	ThreadPlacement m_placement;
+	std::vector<UINT> m_workerNodes;
+	std::vector< std::vector<UINT> > m_stealOrder;		//per worker: workers of the same node first, then all others
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_tasksCompleted;
+
+	std::atomic<bool> m_statisticsEnabled;
+	std::atomic<UINT64> m_queuedTasks;		//entries sitting in a worker queue (private entries are counted by their worker)
+	bool m_terminate;
 };
 
 }  // namespace ml
@@ -23,37 +23,180 @@ public:
     virtual void run(UINT threadIndex, ThreadLocalStorage *threadLocalStorage) = 0;
 };
 
+//
+// completion counter shared by all entries of one batch
+//
+struct WorkerThreadTaskGroup
+{
+	WorkerThreadTaskGroup()
+	{
+		pendingTasks = 0;
+	}
+	bool done() const
+	{
+		return pendingTasks == 0;
+	}
+
+	std::atomic<UINT64> pendingTasks;
+};
+
+//
+// element of a worker queue: a function pointer and its argument, so the pool can queue WorkerThreadTasks
+// as well as its own jobs (e.g. parallelFor chunks) without allocating per entry
+//
+struct WorkerThreadQueueEntry
+{
+	void (*run)(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage);
+	void *data;
+	WorkerThreadTaskGroup *group;
+	UINT64 queueTime;		//steady clock in nanoseconds when the entry was queued; 0 if statistics were off
+};
+
+//
+// counters of one worker, collected while ThreadPool statistics are enabled; times are in milliseconds.
+// Busy time only counts outermost tasks, so tasks run while waiting inside another task are not counted twice.
+//
+struct WorkerThreadStatistics
+{
+	static const UINT histogramBucketCount = 24;
+
+	//! upper bound of a histogram bucket in microseconds; bucket i holds tasks that took [2^(i-1), 2^i) us, the last one is open-ended
+	static UINT64 getHistogramBucketLimit(UINT bucket)
+	{
+		return (UINT64)1 << bucket;
+	}
+
+	UINT64 tasksExecuted;
+	UINT64 steals;
+	double busyMS;
+	double idleMS;
+	double queueWaitMS;
+	std::array<UINT64, histogramBucketCount> durationHistogram;
+};
+
+class ThreadPool;
+
+//
+// persistent worker owned by a ThreadPool; each worker has its own lock-free task queue.
+// Entries that do not fit into the queue go to a mutex-guarded overflow list, which is only touched when it is non-empty.
+//
 class WorkerThread
 {
 public:
 	WorkerThread()
 	{
-		m_thread = nullptr;
+		m_threadIndex = 0;
+		m_storage = nullptr;
+		m_pool = nullptr;
+		m_overflowCount = 0;
+		m_privateCount = 0;
+		m_taskDepth = 0;
+		resetStatistics();
 	}
 	~WorkerThread()
 	{
-		//SAFE_DELETE(m_thread);
+		join();
+	}
+
+	//! cpus: logical CPUs the thread pins itself to before it runs any task; empty leaves placement to the OS
+    void init(UINT threadIndex, ThreadLocalStorage *storage, ThreadPool *pool, const std::vector<UINT> &cpus = std::vector<UINT>());
+
+	//! launches the OS thread; it parks on the pool until tasks arrive
+	void start();
+	//! waits for the OS thread to exit (the pool must have been told to terminate)
+	void join();
+
+	void pushTask(const WorkerThreadQueueEntry &entry);
+	//! takes the oldest entry; used by the owner as well as by workers stealing from this queue
+	bool popTask(WorkerThreadQueueEntry &entry);
+
+	//! entries that only this worker may run (e.g. first-touch initialization of its slab); never stolen
+	void pushPrivateTask(const WorkerThreadQueueEntry &entry);
+	bool popPrivateTask(WorkerThreadQueueEntry &entry);
+	size_t getPrivateTaskCount() const
+	{
+		return m_privateCount;
 	}
 
-    void init(UINT threadIndex, ThreadLocalStorage *storage);
-    void processTasks(TaskList<WorkerThreadTask*> &tasks);
+	UINT getThreadIndex() const
+	{
+		return m_threadIndex;
+	}
+	ThreadLocalStorage* getStorage() const
+	{
+		return m_storage;
+	}
+	ThreadPool* getPool() const
+	{
+		return m_pool;
+	}
+	const std::vector<UINT>& getCPUs() const
+	{
+		return m_cpus;
+	}
+
+	//! the worker running on the calling thread, or nullptr if called from a thread outside any pool
+	static WorkerThread* getCurrent()
+	{
+		return s_currentWorker;
+	}
 
-    bool done()
-    {
-        return m_done;
-    }
+	WorkerThreadStatistics getStatistics() const;
+	void resetStatistics();
+
+	//! steady clock in nanoseconds
+	static UINT64 getTimeNS()
+	{
+		return (UINT64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
 
 private:
+	friend class ThreadPool;
+
+	//! written by the worker itself with relaxed atomics, so other threads can take snapshots at any time
+	struct Counters
+	{
+		std::atomic<UINT64> tasksExecuted;
+		std::atomic<UINT64> steals;
+		std::atomic<UINT64> busyNS;
+		std::atomic<UINT64> idleNS;
+		std::atomic<UINT64> queueWaitNS;
+		std::atomic<UINT64> durationHistogram[WorkerThreadStatistics::histogramBucketCount];
+	};
+
+	void recordTask(UINT64 queueTime, UINT64 startTime, UINT64 endTime, bool outermost);
+	void recordIdle(UINT64 idleNS)
+	{
+		m_counters.idleNS.fetch_add(idleNS, std::memory_order_relaxed);
+	}
+	void recordSteal()
+	{
+		m_counters.steals.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	static void workerThreadEntry( WorkerThread *context );
 	void enterThreadTaskLoop();
 
-    bool m_done;
-    std::thread *m_thread;
+    std::thread m_thread;
 
 	UINT m_threadIndex;
     ThreadLocalStorage *m_storage;
+	ThreadPool *m_pool;
+	std::vector<UINT> m_cpus;
+
+	BoundedTaskQueue<WorkerThreadQueueEntry> m_queue;
+	std::mutex m_overflowMutex;
+	std::deque<WorkerThreadQueueEntry> m_overflow;
+	std::atomic<size_t> m_overflowCount;
+
+	std::mutex m_privateMutex;
+	std::deque<WorkerThreadQueueEntry> m_privateQueue;
+	std::atomic<size_t> m_privateCount;
+
+	Counters m_counters;
+	UINT m_taskDepth;		//tasks currently running on this thread, including nested ones; only touched by the worker
 
-    TaskList<WorkerThreadTask*> *m_tasks;
+	static thread_local WorkerThread *s_currentWorker;
 };
 
 }  // namespace ml
@@ -0,0 +1,65 @@
+#ifndef CORE_UTIL_ALIGNEDALLOCATOR_H_
+#define CORE_UTIL_ALIGNEDALLOCATOR_H_
+
+namespace ml {
+
+	//! STL allocator whose blocks start at a multiple of Alignment bytes (a power of two), e.g. for cache-line or SIMD aligned
+	//! arrays: std::vector<T, AlignedAllocator<T, 32>>. The offset to the underlying allocation is stored just before the block.
+	template <class T, size_t Alignment>
+	class AlignedAllocator {
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		template <class U>
+		struct rebind {
+			typedef AlignedAllocator<U, Alignment> other;
+		};
+
+		AlignedAllocator() {}
+		template <class U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t count) {
+			static_assert((Alignment & (Alignment - 1)) == 0 && Alignment >= sizeof(void*), "alignment must be a power of two of at least pointer size");
+			if (count > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+
+			char* memory = (char*)::operator new(count * sizeof(T) + Alignment);
+			char* aligned = memory + Alignment - ((size_t)memory & (Alignment - 1));
+			((void**)aligned)[-1] = memory;
+			return (T*)aligned;
+		}
+
+		void deallocate(T* block, size_t /*count*/) {
+			if (block) ::operator delete(((void**)block)[-1]);
+		}
+
+		template <class U, class... Args>
+		void construct(U* p, Args&&... args) {
+			new ((void*)p) U(std::forward<Args>(args)...);
+		}
+		template <class U>
+		void destroy(U* p) {
+			p->~U();
+		}
+
+		size_t max_size() const {
+			return std::numeric_limits<size_t>::max() / sizeof(T);
+		}
+
+		bool operator==(const AlignedAllocator&) const {
+			return true;
+		}
+		bool operator!=(const AlignedAllocator&) const {
+			return false;
+		}
+	};
+
+}  // namespace ml
+
+#endif  // CORE_UTIL_ALIGNEDALLOCATOR_H_
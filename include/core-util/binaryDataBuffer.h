@@ -225,9 +225,8 @@ public:
 		//dummy just needed for file stream
 		return;
 	}
+	//! nothing to close; called when a BinaryDataStreamVector is destroyed
 	void close() {
-		MLIB_ASSERT(false);
-		//dummy just needed for file stream
 		return;
 	}
 
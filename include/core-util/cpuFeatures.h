@@ -0,0 +1,78 @@
+#ifndef CORE_UTIL_CPUFEATURES_H_
+#define CORE_UTIL_CPUFEATURES_H_
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MLIB_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//functions using instructions beyond the compiler's baseline are marked with these; MSVC accepts the intrinsics without them
+#if defined(MLIB_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MLIB_TARGET_AVX __attribute__((target("avx")))
+#define MLIB_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define MLIB_TARGET_AVX
+#define MLIB_TARGET_AVX2
+#endif
+
+namespace ml {
+
+	//! instruction set extensions of the CPU the process runs on, for selecting SIMD code paths at runtime.
+	//! AVX is only reported if the operating system also saves the YMM registers.
+	class CPUFeatures {
+	public:
+		static const CPUFeatures& get() {
+			static CPUFeatures features;
+			return features;
+		}
+
+		bool hasSSE2() const {
+			return m_SSE2;
+		}
+		bool hasSSE41() const {
+			return m_SSE41;
+		}
+		bool hasAVX() const {
+			return m_AVX;
+		}
+		bool hasAVX2() const {
+			return m_AVX2;
+		}
+
+	private:
+		CPUFeatures() {
+			m_SSE2 = m_SSE41 = m_AVX = m_AVX2 = false;
+#if defined(MLIB_SIMD_X86) && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+			__cpuid(info, 1);
+			m_SSE2 = (info[3] & (1 << 26)) != 0;
+			m_SSE41 = (info[2] & (1 << 19)) != 0;
+			const bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+			m_AVX = osSavesYMM && (info[2] & (1 << 28)) != 0;
+			if (maxLeaf >= 7) {
+				__cpuidex(info, 7, 0);
+				m_AVX2 = m_AVX && (info[1] & (1 << 5)) != 0;
+			}
+#elif defined(MLIB_SIMD_X86)
+			__builtin_cpu_init();
+			m_SSE2 = __builtin_cpu_supports("sse2") != 0;
+			m_SSE41 = __builtin_cpu_supports("sse4.1") != 0;
+			m_AVX = __builtin_cpu_supports("avx") != 0;
+			m_AVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+
+		bool m_SSE2;
+		bool m_SSE41;
+		bool m_AVX;
+		bool m_AVX2;
+	};
+
+}  // namespace ml
+
+#endif  // CORE_UTIL_CPUFEATURES_H_
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef CORE_UTIL_MEMORYMAPPEDFILE_H_
+#define CORE_UTIL_MEMORYMAPPEDFILE_H_
+
+namespace ml {
+
+//! maps a whole file into memory for reading. The mapping is private and copy-on-write: pages are loaded on first access
+//! and shared with every other process mapping the same file until they are written to; writes never reach the file.
+class MemoryMappedFile {
+public:
+	MemoryMappedFile() {
+		m_data = nullptr;
+		m_size = 0;
+#ifdef _WIN32
+		m_file = nullptr;
+		m_mapping = nullptr;
+#endif
+	}
+	explicit MemoryMappedFile(const std::string& filename) : MemoryMappedFile() {
+		open(filename);
+	}
+	~MemoryMappedFile() {
+		close();
+	}
+
+	//! throws if the file cannot be opened or mapped; an empty file maps to size 0 and no data
+	void open(const std::string& filename);
+	void close();
+
+	bool isOpen() const {
+		return m_data != nullptr;
+	}
+	BYTE* getData() {
+		return m_data;
+	}
+	const BYTE* getData() const {
+		return m_data;
+	}
+	size_t getSize() const {
+		return m_size;
+	}
+
+private:
+	MemoryMappedFile(const MemoryMappedFile&);
+	MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+	BYTE* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+};
+
+} // namespace ml
+
+#endif // CORE_UTIL_MEMORYMAPPEDFILE_H_
@@ -6,6 +6,9 @@
 #include <vector>
 #include <sstream>
 #include <iomanip>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace ml
 {
@@ -176,6 +179,49 @@ namespace math
 		return r;
 	}
 
+	//! number of leading zero bits; 64 for 0
+	inline unsigned int countLeadingZeros(UINT64 x) {
+		if (x == 0) return 64;
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return 63 - (unsigned int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+		return (unsigned int)__builtin_clzll(x);
+#else
+		unsigned int n = 0;
+		while ((x & ((UINT64)1 << 63)) == 0) { x <<= 1; n++; }
+		return n;
+#endif
+	}
+
+	//! interleaves the lowest 10 bits of x, y and z into a 30-bit Morton code (z-order curve index), x in the lowest bit
+	inline UINT32 mortonCode30(UINT32 x, UINT32 y, UINT32 z) {
+		auto spread = [](UINT32 v) {
+			v &= 0x3ff;
+			v = (v | (v << 16)) & 0x030000ff;
+			v = (v | (v << 8)) & 0x0300f00f;
+			v = (v | (v << 4)) & 0x030c30c3;
+			v = (v | (v << 2)) & 0x09249249;
+			return v;
+		};
+		return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+	}
+
+	//! interleaves the lowest 21 bits of x, y and z into a 63-bit Morton code, x in the lowest bit
+	inline UINT64 mortonCode63(UINT32 x, UINT32 y, UINT32 z) {
+		auto spread = [](UINT64 v) {
+			v &= 0x1fffff;
+			v = (v | (v << 32)) & 0x001f00000000ffffull;
+			v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+			v = (v | (v << 8)) & 0x100f00f00f00f00full;
+			v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+			v = (v | (v << 2)) & 0x1249249249249249ull;
+			return v;
+		};
+		return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+	}
+
 	//! returns -1 if negative, 0 if 0, +1 if positive
 	template <typename T>
 	inline int sign(T val) {
@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <dirent.h>
+#include <sched.h>
 #endif
 
 //
@@ -32,6 +33,7 @@
 #include "../src/core-util/windowsUtil.cpp"
 #include "../src/core-util/directory.cpp"
 #include "../src/core-util/timer.cpp"
+#include "../src/core-util/memoryMappedFile.cpp"
 #include "../src/core-util/pipe.cpp"
 #include "../src/core-util/UIConnection.cpp"
 #include "../src/core-util/eventMap.cpp"
@@ -39,8 +41,10 @@
 //
 // core-multithreading source files
 //
+#include "../src/core-multithreading/cpuTopology.cpp"
 #include "../src/core-multithreading/threadPool.cpp"
 #include "../src/core-multithreading/workerThread.cpp"
+#include "../src/core-multithreading/taskGraph.cpp"
 
 //
 // core-graphics source files
@@ -17,10 +17,26 @@
 #include "core-util/stringUtil.h"
 #include "core-util/windowsUtil.h"
 #include "core-util/flagSet.h"
+#include "core-util/alignedAllocator.h"
+#include "core-util/cpuFeatures.h"
 #include "core-util/binaryDataCompressor.h"
 #include "core-util/binaryDataBuffer.h"
 #include "core-util/binaryDataSerialize.h"
 #include "core-util/binaryDataStream.h"
+#include "core-util/memoryMappedFile.h"
+
+//
+// core-multithreading headers (these are required by kMeansClustering)
+//
+#include "core-multithreading/taskList.h"
+#include "core-multithreading/boundedTaskQueue.h"
+#include "core-multithreading/cpuTopology.h"
+#include "core-multithreading/workerThread.h"
+#include "core-multithreading/threadPool.h"
+#include "core-multithreading/taskFuture.h"
+#include "core-multithreading/parallelFor.h"
+#include "core-multithreading/parallelRadixSort.h"
+#include "core-multithreading/taskGraph.h"
 
 //
 // core-math headers
@@ -154,13 +170,6 @@ namespace ml
 #include "core-util/sparseGrid3.h"
 #include "core-base/binaryGrid3.h"
 
-//
-// core-multithreading headers
-//
-#include "core-multithreading/taskList.h"
-#include "core-multithreading/workerThread.h"
-#include "core-multithreading/threadPool.h"
-
 //
 // core-graphics headers
 //
@@ -174,12 +183,15 @@ namespace ml
 #include "core-graphics/plane.h"
 #include "core-graphics/triangle.h"
 #include "core-graphics/intersection.h"
+#include "core-graphics/triangleBlock.h"
 #include "core-graphics/polygon.h"
 #include "core-graphics/boundingBox2.h"
 #include "core-graphics/boundingBox3.h"
 #include "core-graphics/orientedBoundingBox2.h"
 #include "core-graphics/orientedBoundingBox3.h"
 #include "core-graphics/dist.h"
+#include "core-graphics/sphere.h"
+#include "core-graphics/frustum.h"
 #include "core-base/distanceField3.h"
 #include "core-util/uniformAccelerator.h"
 #include "core-base/baseImage.h"
@@ -193,6 +205,7 @@ namespace ml
 #include "core-mesh/material.h"
 #include "core-mesh/meshData.h"
 #include "core-mesh/plyHeader.h"
+#include "core-mesh/plySchema.h"
 #include "core-mesh/meshIO.h"
 #include "core-mesh/pointCloud.h"
 #include "core-mesh/pointCloudIO.h"
@@ -205,6 +218,9 @@ namespace ml
 #include "core-mesh/triMeshCollisionAccelerator.h"
 #include "core-mesh/triMeshAcceleratorBruteForce.h"
 #include "core-mesh/triMeshAcceleratorBVH.h"
+#include "core-mesh/triMeshAcceleratorBVHWide.h"
+#include "core-mesh/triMeshAcceleratorBVHCompressed.h"
+#include "core-mesh/triMeshAcceleratorInstanced.h"
 
 #include "core-mesh/meshUtil.h"
 #include "core-mesh/meshShapes.h"
@@ -0,0 +1,113 @@
+
+namespace ml
+{
+
+const CPUTopology& CPUTopology::get()
+{
+	static CPUTopology topology;
+	return topology;
+}
+
+UINT CPUTopology::getCPUCount() const
+{
+	UINT result = 0;
+	for(const auto &cpus : m_nodeCPUs)
+		result += (UINT)cpus.size();
+	return result;
+}
+
+std::vector<UINT> CPUTopology::parseCPUList(const std::string &list)
+{
+	std::vector<UINT> result;
+	std::stringstream stream(list);
+	std::string range;
+	while(std::getline(stream, range, ','))
+	{
+		if(range.find_first_of("0123456789") == std::string::npos)
+			continue;
+
+		const size_t dash = range.find('-');
+		const UINT first = (UINT)std::stoul(range.substr(0, dash));
+		const UINT last = dash == std::string::npos ? first : (UINT)std::stoul(range.substr(dash + 1));
+		for(UINT cpu = first; cpu <= last; cpu++)
+			result.push_back(cpu);
+	}
+	return result;
+}
+
+CPUTopology::CPUTopology()
+{
+#ifdef LINUX
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	const bool haveAllowed = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+	for(UINT node = 0; ; node++)
+	{
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if(!file.is_open())
+			break;
+
+		std::string list;
+		std::getline(file, list);
+		std::vector<UINT> cpus;
+		for(UINT cpu : parseCPUList(list))
+		{
+			if(!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+				cpus.push_back(cpu);
+		}
+		if(cpus.size() > 0)
+			m_nodeCPUs.push_back(cpus);
+	}
+#endif
+
+#ifdef _WIN32
+	ULONG highestNode = 0;
+	if(GetNumaHighestNodeNumber(&highestNode))
+	{
+		for(ULONG node = 0; node <= highestNode; node++)
+		{
+			ULONGLONG mask = 0;
+			if(!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+				continue;
+
+			std::vector<UINT> cpus;
+			for(UINT cpu = 0; cpu < 64; cpu++)
+				if(mask & (1ULL << cpu)) cpus.push_back(cpu);
+			if(cpus.size() > 0)
+				m_nodeCPUs.push_back(cpus);
+		}
+	}
+#endif
+
+	if(m_nodeCPUs.size() == 0)
+	{
+		std::vector<UINT> cpus(std::max(1u, std::thread::hardware_concurrency()));
+		for(UINT cpu = 0; cpu < cpus.size(); cpu++)
+			cpus[cpu] = cpu;
+		m_nodeCPUs.push_back(cpus);
+	}
+}
+
+bool CPUTopology::pinCurrentThread(const std::vector<UINT> &cpus)
+{
+	if(cpus.size() == 0)
+		return false;
+
+#ifdef LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for(UINT cpu : cpus)
+		if(cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+	DWORD_PTR mask = 0;
+	for(UINT cpu : cpus)
+		if(cpu < sizeof(DWORD_PTR) * 8) mask |= ((DWORD_PTR)1 << cpu);
+	return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+	return false;
+#endif
+}
+
+}  // namespace ml
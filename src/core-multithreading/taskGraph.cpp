@@ -0,0 +1,282 @@
+
+namespace ml
+{
+
+TaskGraph::TaskGraph()
+{
+	m_pool = nullptr;
+	m_running = false;
+	m_startTime = 0.0;
+	m_totalTimeMS = 0.0;
+}
+
+TaskGraph::Node* TaskGraph::createNode(const std::string &name, const std::function<void()> &task)
+{
+	Node *node = new Node;
+	node->graph = this;
+	node->id = (NodeID)m_nodes.size();
+	node->name = name;
+	node->task = task;
+	node->predecessorCount = 0;
+	node->pendingPredecessors = 0;
+	node->finished = false;
+	node->threadIndex = 0;
+	node->startMS = node->endMS = 0.0;
+	m_nodes.push_back(std::unique_ptr<Node>(node));
+	return node;
+}
+
+void TaskGraph::checkNode(NodeID node) const
+{
+	if(node >= m_nodes.size()) throw MLIB_EXCEPTION("invalid task graph node " + std::to_string(node));
+}
+
+TaskGraph::NodeID TaskGraph::addTask(const std::string &name, const std::function<void()> &task)
+{
+	return addTask(name, task, std::vector<NodeID>());
+}
+
+TaskGraph::NodeID TaskGraph::addTask(const std::string &name, const std::function<void()> &task, const std::vector<NodeID> &predecessors)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_running) throw MLIB_EXCEPTION("only continuations can be added to a running task graph");
+	for(NodeID predecessor : predecessors)
+		checkNode(predecessor);
+
+	Node *node = createNode(name, task);
+	for(NodeID predecessor : predecessors)
+	{
+		m_nodes[predecessor]->successors.push_back(node);
+		node->predecessorCount++;
+	}
+	return node->id;
+}
+
+void TaskGraph::addDependency(NodeID predecessor, NodeID successor)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_running) throw MLIB_EXCEPTION("dependencies cannot be added to a running task graph");
+	checkNode(predecessor);
+	checkNode(successor);
+
+	m_nodes[predecessor]->successors.push_back(m_nodes[successor].get());
+	m_nodes[successor]->predecessorCount++;
+}
+
+TaskGraph::NodeID TaskGraph::addContinuation(NodeID predecessor, const std::string &name, const std::function<void()> &task)
+{
+	Node *node;
+	bool release = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		checkNode(predecessor);
+
+		node = createNode(name, task);
+		Node *predecessorNode = m_nodes[predecessor].get();
+		predecessorNode->successors.push_back(node);
+		node->predecessorCount = 1;
+
+		if(m_running)
+		{
+			release = predecessorNode->finished;
+			node->pendingPredecessors = release ? 0 : 1;
+		}
+	}
+	if(release)
+		releaseNode(node);
+	return node->id;
+}
+
+void TaskGraph::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_running) throw MLIB_EXCEPTION("cannot clear a running task graph");
+	m_nodes.clear();
+	m_totalTimeMS = 0.0;
+}
+
+std::vector<TaskGraph::Node*> TaskGraph::topologicalOrder() const
+{
+	std::vector<UINT> pending(m_nodes.size());
+	std::vector<Node*> order;
+	order.reserve(m_nodes.size());
+	for(const auto &node : m_nodes)
+	{
+		pending[node->id] = node->predecessorCount;
+		if(node->predecessorCount == 0)
+			order.push_back(node.get());
+	}
+
+	for(size_t orderIndex = 0; orderIndex < order.size(); orderIndex++)
+	{
+		for(Node *successor : order[orderIndex]->successors)
+		{
+			if(--pending[successor->id] == 0)
+				order.push_back(successor);
+		}
+	}
+
+	if(order.size() != m_nodes.size()) throw MLIB_EXCEPTION("task graph contains a cycle");
+	return order;
+}
+
+void TaskGraph::run(ThreadPool &pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_running) throw MLIB_EXCEPTION("task graph is already running");
+		topologicalOrder();
+
+		for(const auto &node : m_nodes)
+		{
+			node->pendingPredecessors = node->predecessorCount;
+			node->finished = false;
+			node->threadIndex = 0;
+			node->startMS = node->endMS = 0.0;
+		}
+		m_pool = &pool;
+		m_running = true;
+	}
+
+	m_startTime = Timer::getTime();
+
+	std::vector<Node*> roots;
+	for(const auto &node : m_nodes)
+		if(node->predecessorCount == 0) roots.push_back(node.get());
+	for(Node *root : roots)
+		releaseNode(root);
+
+	if(pool.getThreadCount() == 0)
+	{
+		while(!m_inlineQueue.empty())
+		{
+			Node *node = m_inlineQueue.back();
+			m_inlineQueue.pop_back();
+			executeNode(node, 0);
+		}
+	}
+	else
+	{
+		pool.waitForGroup(m_group);
+	}
+
+	m_totalTimeMS = (Timer::getTime() - m_startTime) * 1000.0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_running = false;
+	m_pool = nullptr;
+}
+
+void TaskGraph::runNode(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+{
+	Node *node = (Node*)data;
+	node->graph->executeNode(node, threadIndex);
+}
+
+void TaskGraph::executeNode(Node *node, UINT threadIndex)
+{
+	node->threadIndex = threadIndex;
+	node->startMS = (Timer::getTime() - m_startTime) * 1000.0;
+	node->task();
+	node->endMS = (Timer::getTime() - m_startTime) * 1000.0;
+
+	std::vector<Node*> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		node->finished = true;
+		for(Node *successor : node->successors)
+		{
+			if(--successor->pendingPredecessors == 0)
+				ready.push_back(successor);
+		}
+	}
+
+	for(Node *successor : ready)
+		releaseNode(successor);
+}
+
+void TaskGraph::releaseNode(Node *node)
+{
+	if(m_pool->getThreadCount() == 0)
+	{
+		m_inlineQueue.push_back(node);
+		return;
+	}
+
+	m_group.pendingTasks++;
+
+	WorkerThreadQueueEntry entry;
+	entry.run = runNode;
+	entry.data = node;
+	entry.group = &m_group;
+	m_pool->pushTasks(entry, 1);
+}
+
+std::vector<TaskGraph::NodeID> TaskGraph::getCriticalPath() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_nodes.size() == 0)
+		return std::vector<NodeID>();
+
+	const std::vector<Node*> order = topologicalOrder();
+
+	//longest chain of summed durations ending at each node
+	std::vector<double> pathMS(m_nodes.size());
+	std::vector<int> previous(m_nodes.size(), -1);
+	for(const auto &node : m_nodes)
+		pathMS[node->id] = node->endMS - node->startMS;
+
+	for(Node *node : order)
+	{
+		for(Node *successor : node->successors)
+		{
+			const double candidateMS = pathMS[node->id] + successor->endMS - successor->startMS;
+			if(previous[successor->id] == -1 || candidateMS > pathMS[successor->id])
+			{
+				pathMS[successor->id] = candidateMS;
+				previous[successor->id] = (int)node->id;
+			}
+		}
+	}
+
+	NodeID last = 0;
+	for(NodeID node = 1; node < m_nodes.size(); node++)
+		if(pathMS[node] > pathMS[last]) last = node;
+
+	std::vector<NodeID> path;
+	for(int node = (int)last; node != -1; node = previous[node])
+		path.push_back((NodeID)node);
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+double TaskGraph::getCriticalPathMS() const
+{
+	double result = 0.0;
+	for(NodeID node : getCriticalPath())
+		result += getNodeDurationMS(node);
+	return result;
+}
+
+void TaskGraph::printTimings(std::ostream &s) const
+{
+	const std::vector<NodeID> criticalPath = getCriticalPath();
+	const std::set<NodeID> critical(criticalPath.begin(), criticalPath.end());
+	const std::ios::fmtflags flags = s.flags();
+	const std::streamsize precision = s.precision();
+
+	double workMS = 0.0;
+	for(const auto &node : m_nodes)
+	{
+		workMS += getNodeDurationMS(node->id);
+		s << (critical.count(node->id) ? "* " : "  ") << std::left << std::setw(24) << node->name << std::right
+		  << " thread " << std::setw(3) << node->threadIndex
+		  << "  start " << std::fixed << std::setprecision(3) << std::setw(10) << node->startMS << " ms"
+		  << "  duration " << std::setw(10) << getNodeDurationMS(node->id) << " ms" << std::endl;
+	}
+	s << "total " << m_totalTimeMS << " ms, work " << workMS << " ms, critical path " << getCriticalPathMS() << " ms" << std::endl;
+	s.flags(flags);
+	s.precision(precision);
+}
+
+}  // namespace ml
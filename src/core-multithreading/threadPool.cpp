@@ -2,52 +2,448 @@
 namespace ml
 {
 
-void ThreadPool::init(UINT threadCount)
+static void runAndDeleteWorkerThreadTask(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
 {
-	m_threads.resize(threadCount);
-	for(UINT threadIndex = 0; threadIndex < threadCount; threadIndex++)
-		m_threads[threadIndex].init(threadIndex, nullptr);
+	WorkerThreadTask *task = (WorkerThreadTask*)data;
+	task->run(threadIndex, threadLocalStorage);
+	delete task;
+}
+
+ThreadPool::ThreadPool()
+{
+	m_nextThread = 0;
+	m_placement = ThreadPlacementOS;
+	m_statisticsEnabled = false;
+	m_queuedTasks = 0;
+	m_terminate = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+	shutdown();
+}
+
+void ThreadPool::init(UINT threadCount, ThreadPlacement placement)
+{
+	init(threadCount, std::vector<ThreadLocalStorage*>(threadCount, nullptr), placement);
 }
 
-void ThreadPool::init(UINT threadCount, const std::vector<ThreadLocalStorage*> &threadLocalStorage)
+void ThreadPool::init(UINT threadCount, const std::vector<ThreadLocalStorage*> &threadLocalStorage, ThreadPlacement placement)
 {
+	shutdown();
+
+	m_terminate = false;
+	m_placement = placement;
+
+	//consecutive workers form one group per node
+	const CPUTopology &topology = CPUTopology::get();
+	const UINT nodeCount = (placement == ThreadPlacementOS) ? 1 : topology.getNodeCount();
+	std::vector<UINT> nodeWorkerCount(nodeCount, 0);
+	m_workerNodes.resize(threadCount);
+
 	m_threads.resize(threadCount);
 	for(UINT threadIndex = 0; threadIndex < threadCount; threadIndex++)
-		m_threads[threadIndex].init(threadIndex, threadLocalStorage[threadIndex]);
+	{
+		const UINT node = (UINT)((UINT64)threadIndex * nodeCount / threadCount);
+		m_workerNodes[threadIndex] = node;
+
+		std::vector<UINT> cpus;
+		if(placement == ThreadPlacementCores)
+		{
+			const std::vector<UINT> &nodeCPUs = topology.getNodeCPUs(node);
+			cpus.push_back(nodeCPUs[nodeWorkerCount[node] % nodeCPUs.size()]);
+		}
+		else if(placement == ThreadPlacementNUMANodes)
+		{
+			cpus = topology.getNodeCPUs(node);
+		}
+		nodeWorkerCount[node]++;
+
+		m_threads[threadIndex] = std::unique_ptr<WorkerThread>(new WorkerThread);
+		m_threads[threadIndex]->init(threadIndex, threadLocalStorage[threadIndex], this, cpus);
+	}
+
+	m_stealOrder.resize(threadCount);
+	for(UINT threadIndex = 0; threadIndex < threadCount; threadIndex++)
+	{
+		std::vector<UINT> &order = m_stealOrder[threadIndex];
+		order.clear();
+		for(UINT pass = 0; pass < 2; pass++)
+		{
+			for(UINT offset = 1; offset < threadCount; offset++)
+			{
+				const UINT victim = (threadIndex + offset) % threadCount;
+				if((m_workerNodes[victim] == m_workerNodes[threadIndex]) == (pass == 0))
+					order.push_back(victim);
+			}
+		}
+	}
+	for(UINT threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		m_threads[threadIndex]->start();
+}
+
+ThreadPool& ThreadPool::getGlobal()
+{
+	struct GlobalPool
+	{
+		GlobalPool()
+		{
+			pool.init(std::max(1u, std::thread::hardware_concurrency()));
+		}
+		ThreadPool pool;
+	};
+	static GlobalPool global;
+	return global.pool;
+}
+
+void ThreadPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_terminate = true;
+	}
+	m_workAvailable.notify_all();
+
+	for(auto &thread : m_threads)
+		thread->join();
+
+	//only submit() returns before its entries have run; run what is left so that no future stays unfulfilled
+	bool ranTask = true;
+	while(ranTask)
+	{
+		ranTask = false;
+		for(auto &thread : m_threads)
+		{
+			WorkerThreadQueueEntry entry;
+			while(thread->popPrivateTask(entry) || thread->popTask(entry))
+			{
+				runTask(entry, 0, nullptr);
+				ranTask = true;
+			}
+		}
+	}
+	m_threads.clear();
+	m_queuedTasks = 0;
+}
+
+std::vector<WorkerThreadStatistics> ThreadPool::getStatistics() const
+{
+	std::vector<WorkerThreadStatistics> result;
+	for(const auto &thread : m_threads)
+		result.push_back(thread->getStatistics());
+	return result;
+}
+
+void ThreadPool::resetStatistics()
+{
+	for(auto &thread : m_threads)
+		thread->resetStatistics();
+}
+
+std::string ThreadPool::getStatisticsJSON() const
+{
+	const char *placementNames[] = { "os", "cores", "numaNodes" };
+
+	std::stringstream s;
+	s << "{" << std::endl;
+	s << "  \"threadCount\": " << m_threads.size() << "," << std::endl;
+	s << "  \"placement\": \"" << placementNames[m_placement] << "\"," << std::endl;
+	s << "  \"histogramBucketLimitsUS\": [";
+	for(UINT bucket = 0; bucket < WorkerThreadStatistics::histogramBucketCount; bucket++)
+		s << (bucket > 0 ? ", " : "") << WorkerThreadStatistics::getHistogramBucketLimit(bucket);
+	s << "]," << std::endl;
+
+	s << "  \"workers\": [" << std::endl;
+	const std::vector<WorkerThreadStatistics> statistics = getStatistics();
+	for(UINT threadIndex = 0; threadIndex < statistics.size(); threadIndex++)
+	{
+		const WorkerThreadStatistics &w = statistics[threadIndex];
+		s << "    { \"index\": " << threadIndex << ", \"node\": " << m_workerNodes[threadIndex]
+		  << ", \"tasksExecuted\": " << w.tasksExecuted << ", \"steals\": " << w.steals
+		  << ", \"busyMS\": " << w.busyMS << ", \"idleMS\": " << w.idleMS << ", \"queueWaitMS\": " << w.queueWaitMS
+		  << ", \"durationHistogram\": [";
+		for(UINT bucket = 0; bucket < WorkerThreadStatistics::histogramBucketCount; bucket++)
+			s << (bucket > 0 ? ", " : "") << w.durationHistogram[bucket];
+		s << "] }" << (threadIndex + 1 < statistics.size() ? "," : "") << std::endl;
+	}
+	s << "  ]" << std::endl;
+	s << "}" << std::endl;
+	return s.str();
+}
+
+void ThreadPool::saveStatisticsJSON(const std::string &filename) const
+{
+	std::ofstream file(filename);
+	if(!file.is_open()) throw MLIB_EXCEPTION("could not open file " + filename);
+	file << getStatisticsJSON();
+}
+
+WorkerThread* ThreadPool::getCurrentWorker() const
+{
+	WorkerThread *worker = WorkerThread::getCurrent();
+	if(worker != nullptr && worker->getPool() == this)
+		return worker;
+	return nullptr;
 }
 
 void ThreadPool::runTasks(TaskList<WorkerThreadTask*> &tasks, bool useConsole)
+{
+	runTaskQueue(tasks, useConsole);
+}
+
+void ThreadPool::runTasks(BoundedTaskQueue<WorkerThreadTask*> &tasks, bool useConsole)
+{
+	runTaskQueue(tasks, useConsole);
+}
+
+template<class Queue>
+void ThreadPool::runTaskQueue(Queue &tasks, bool useConsole)
 {
 	if(useConsole) std::cout << "running "  << tasks.tasksLeft() << " tasks" << std::endl;
 
-	for(UINT threadIndex = 0; threadIndex < m_threads.size(); threadIndex++)
-		m_threads[threadIndex].processTasks(tasks);
+	if(m_threads.size() == 0)
+	{
+		WorkerThreadTask *task;
+		while(tasks.getNextTask(task))
+			runAndDeleteWorkerThreadTask(task, 0, nullptr);
+	}
+	else
+	{
+		WorkerThreadTaskGroup group;
+		pushTasks(tasks, group);
+		waitForGroup(group, useConsole);
+	}
+
+	if(useConsole) std::cout << "all tasks completed" << std::endl;
+}
+
+void ThreadPool::runChunks(size_t chunkCount, void (*chunkFunction)(void *context, size_t chunkIndex), void *context)
+{
+	struct ChunkJob
+	{
+		static void run(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+		{
+			((ChunkJob*)data)->processChunks();
+		}
+		void processChunks()
+		{
+			size_t chunkIndex;
+			while((chunkIndex = nextChunk++) < chunkCount)
+				chunkFunction(context, chunkIndex);
+		}
+
+		void (*chunkFunction)(void *context, size_t chunkIndex);
+		void *context;
+		size_t chunkCount;
+		std::atomic<size_t> nextChunk;
+	};
 
-	UINT consoleDelay = 0;
+	ChunkJob job;
+	job.chunkFunction = chunkFunction;
+	job.context = context;
+	job.chunkCount = chunkCount;
+	job.nextChunk = 0;
 
-	bool allThreadsCompleted = false;
-	while(!allThreadsCompleted)
+	//every helper entry drains chunks until none are left, so one entry per worker is enough
+	WorkerThreadTaskGroup group;
+	const UINT64 helperCount = std::min((UINT64)m_threads.size(), (UINT64)(chunkCount > 0 ? chunkCount - 1 : 0));
+	if(helperCount > 0)
 	{
-		UINT activeThreadCount = 0;
-		for(UINT threadIndex = 0; threadIndex < m_threads.size(); threadIndex++)
-			if(!m_threads[threadIndex].done())
-				activeThreadCount++;
+		WorkerThreadQueueEntry entry;
+		entry.run = ChunkJob::run;
+		entry.data = &job;
+		entry.group = &group;
+		group.pendingTasks = helperCount;
+		pushTasks(entry, helperCount);
+	}
 
-		if(activeThreadCount == 0)
-			allThreadsCompleted = true;
+	job.processChunks();
+	waitForGroup(group);
+}
 
-		if(consoleDelay == 0)
+void ThreadPool::runOnEachWorker(void (*workerFunction)(void *context, UINT threadIndex), void *context)
+{
+	struct WorkerJob
+	{
+		static void run(void *data, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
 		{
-			if(useConsole) std::cout << "tasks left: " << tasks.tasksLeft() + activeThreadCount << std::endl;
-			consoleDelay = 40;
+			const WorkerJob &job = *(const WorkerJob*)data;
+			job.workerFunction(job.context, threadIndex);
 		}
-		else
+
+		void (*workerFunction)(void *context, UINT threadIndex);
+		void *context;
+	};
+
+	if(m_threads.size() == 0)
+	{
+		workerFunction(context, 0);
+		return;
+	}
+
+	WorkerJob job;
+	job.workerFunction = workerFunction;
+	job.context = context;
+
+	WorkerThreadTaskGroup group;
+	group.pendingTasks = m_threads.size();
+
+	WorkerThreadQueueEntry entry;
+	entry.run = WorkerJob::run;
+	entry.data = &job;
+	entry.group = &group;
+	{
+		//under the lock, so that a worker cannot miss its private entry between checking for work and going to sleep
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for(auto &thread : m_threads)
+			thread->pushPrivateTask(entry);
+	}
+	m_workAvailable.notify_all();
+	m_tasksCompleted.notify_all();
+
+	waitForGroup(group);
+}
+
+void ThreadPool::pushTasks(const WorkerThreadQueueEntry &entry, UINT64 count)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queuedTasks += count;
+	}
+
+	WorkerThread *worker = getCurrentWorker();
+	for(UINT64 i = 0; i < count; i++)
+	{
+		if(worker != nullptr)	worker->pushTask(entry);
+		else					m_threads[m_nextThread++ % m_threads.size()]->pushTask(entry);
+	}
+
+	m_workAvailable.notify_all();
+	m_tasksCompleted.notify_all();	//wakes workers that are waiting for a group, so they can help
+}
+
+template<class Queue>
+void ThreadPool::pushTasks(Queue &tasks, WorkerThreadTaskGroup &group)
+{
+	//deal the tasks round-robin; workers that finish early steal from the others.
+	//Tasks are counted one by one since other threads may still be inserting into a BoundedTaskQueue.
+	WorkerThread *worker = getCurrentWorker();
+	WorkerThreadQueueEntry entry;
+	entry.run = runAndDeleteWorkerThreadTask;
+	entry.group = &group;
+	WorkerThreadTask *task;
+	while(tasks.getNextTask(task))
+	{
+		entry.data = task;
+		group.pendingTasks++;
+		m_queuedTasks++;
+		if(worker != nullptr)	worker->pushTask(entry);
+		else					m_threads[m_nextThread++ % m_threads.size()]->pushTask(entry);
+	}
+
+	//taking the lock orders the notify after any worker's check of m_queuedTasks
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_workAvailable.notify_all();
+	m_tasksCompleted.notify_all();
+}
+
+void ThreadPool::waitForGroup(WorkerThreadTaskGroup &group, bool useConsole)
+{
+	WorkerThread *worker = getCurrentWorker();
+	while(!group.done())
+	{
+		//a worker must not block while its own queue may hold entries of the group, so it helps out
+		WorkerThreadQueueEntry entry;
+		if(worker != nullptr && findTask(worker->getThreadIndex(), entry))
 		{
-			consoleDelay--;
+			runTask(entry, worker->getThreadIndex(), worker->getStorage());
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(group.done())
+			break;
+		if(worker != nullptr && (m_queuedTasks > 0 || worker->getPrivateTaskCount() > 0))
+			continue;
+		if(m_tasksCompleted.wait_for(lock, std::chrono::seconds(1)) == std::cv_status::timeout)
+		{
+			if(useConsole) std::cout << "tasks left: " << group.pendingTasks << std::endl;
 		}
-		std::this_thread::sleep_for( std::chrono::milliseconds(25) );
 	}
-	if(useConsole) std::cout << "all tasks completed" << std::endl;
+}
+
+bool ThreadPool::findTask(UINT threadIndex, WorkerThreadQueueEntry &entry)
+{
+	if(m_threads[threadIndex]->popPrivateTask(entry))
+		return true;
+	if(m_threads[threadIndex]->popTask(entry))
+	{
+		m_queuedTasks--;
+		return true;
+	}
+	for(UINT victim : m_stealOrder[threadIndex])
+	{
+		if(m_threads[victim]->popTask(entry))
+		{
+			m_queuedTasks--;
+			if(m_statisticsEnabled)
+				m_threads[threadIndex]->recordSteal();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::acquireTask(UINT threadIndex, WorkerThreadQueueEntry &entry)
+{
+	while(true)
+	{
+		if(findTask(threadIndex, entry))
+			return true;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const UINT64 idleStart = m_statisticsEnabled ? WorkerThread::getTimeNS() : 0;
+		while(m_queuedTasks == 0 && m_threads[threadIndex]->getPrivateTaskCount() == 0 && !m_terminate)
+			m_workAvailable.wait(lock);
+		if(idleStart != 0)
+			m_threads[threadIndex]->recordIdle(WorkerThread::getTimeNS() - idleStart);
+		if(m_terminate)
+			return false;
+	}
+}
+
+void ThreadPool::runTask(const WorkerThreadQueueEntry &entry, UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+{
+	WorkerThreadTaskGroup *group = entry.group;
+
+	WorkerThread *worker = m_statisticsEnabled ? getCurrentWorker() : nullptr;
+	if(worker == nullptr)
+	{
+		entry.run(entry.data, threadIndex, threadLocalStorage);
+	}
+	else
+	{
+		const UINT64 startTime = WorkerThread::getTimeNS();
+		worker->m_taskDepth++;
+		entry.run(entry.data, threadIndex, threadLocalStorage);
+		worker->m_taskDepth--;
+		worker->recordTask(entry.queueTime, startTime, WorkerThread::getTimeNS(), worker->m_taskDepth == 0);
+	}
+
+	//the group may be destroyed by its waiter as soon as the counter hits zero
+	if(group != nullptr && --group->pendingTasks == 0)
+		notifyGroupDone();
+}
+
+void ThreadPool::notifyGroupDone()
+{
+	//taking the lock orders this notify after the waiter's check of the group
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_tasksCompleted.notify_all();
 }
 
 }  // namespace ml
@@ -2,33 +2,139 @@
 namespace ml
 {
 
-void WorkerThread::init(UINT threadIndex, ThreadLocalStorage *storage)
+thread_local WorkerThread *WorkerThread::s_currentWorker = nullptr;
+
+void WorkerThread::init(UINT threadIndex, ThreadLocalStorage *storage, ThreadPool *pool, const std::vector<UINT> &cpus)
 {
 	m_threadIndex = threadIndex;
 	m_storage = storage;
+	m_pool = pool;
+	m_cpus = cpus;
+}
+
+void WorkerThread::start()
+{
+	m_thread = std::thread(workerThreadEntry, this);
+}
+
+void WorkerThread::join()
+{
+	if(m_thread.joinable())
+		m_thread.join();
 }
 
-void WorkerThread::processTasks(TaskList<WorkerThreadTask*> &tasks)
+void WorkerThread::pushTask(const WorkerThreadQueueEntry &entry)
 {
-	m_done = false;
-	m_tasks = &tasks;
-	m_thread = new std::thread(workerThreadEntry, this);
+	WorkerThreadQueueEntry queuedEntry = entry;
+	queuedEntry.queueTime = m_pool->getStatisticsEnabled() ? getTimeNS() : 0;
+	if(m_queue.tryInsert(queuedEntry))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_overflowMutex);
+	m_overflow.push_back(queuedEntry);
+	m_overflowCount++;
+}
+
+bool WorkerThread::popTask(WorkerThreadQueueEntry &entry)
+{
+	if(m_queue.getNextTask(entry))
+		return true;
+	if(m_overflowCount == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_overflowMutex);
+	if(m_overflow.empty())
+		return false;
+
+	entry = m_overflow.front();
+	m_overflow.pop_front();
+	m_overflowCount--;
+	return true;
+}
+
+void WorkerThread::pushPrivateTask(const WorkerThreadQueueEntry &entry)
+{
+	WorkerThreadQueueEntry queuedEntry = entry;
+	queuedEntry.queueTime = m_pool->getStatisticsEnabled() ? getTimeNS() : 0;
+
+	std::lock_guard<std::mutex> lock(m_privateMutex);
+	m_privateQueue.push_back(queuedEntry);
+	m_privateCount++;
+}
+
+bool WorkerThread::popPrivateTask(WorkerThreadQueueEntry &entry)
+{
+	if(m_privateCount == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_privateMutex);
+	if(m_privateQueue.empty())
+		return false;
+
+	entry = m_privateQueue.front();
+	m_privateQueue.pop_front();
+	m_privateCount--;
+	return true;
+}
+
+void WorkerThread::recordTask(UINT64 queueTime, UINT64 startTime, UINT64 endTime, bool outermost)
+{
+	const UINT64 durationNS = endTime - startTime;
+	m_counters.tasksExecuted.fetch_add(1, std::memory_order_relaxed);
+	if(outermost)
+		m_counters.busyNS.fetch_add(durationNS, std::memory_order_relaxed);
+	if(queueTime != 0 && startTime > queueTime)
+		m_counters.queueWaitNS.fetch_add(startTime - queueTime, std::memory_order_relaxed);
+
+	UINT bucket = 0;
+	UINT64 durationUS = durationNS / 1000;
+	while(durationUS > 0 && bucket + 1 < WorkerThreadStatistics::histogramBucketCount)
+	{
+		durationUS >>= 1;
+		bucket++;
+	}
+	m_counters.durationHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+WorkerThreadStatistics WorkerThread::getStatistics() const
+{
+	WorkerThreadStatistics result;
+	result.tasksExecuted = m_counters.tasksExecuted.load(std::memory_order_relaxed);
+	result.steals = m_counters.steals.load(std::memory_order_relaxed);
+	result.busyMS = m_counters.busyNS.load(std::memory_order_relaxed) / 1e6;
+	result.idleMS = m_counters.idleNS.load(std::memory_order_relaxed) / 1e6;
+	result.queueWaitMS = m_counters.queueWaitNS.load(std::memory_order_relaxed) / 1e6;
+	for(UINT bucket = 0; bucket < WorkerThreadStatistics::histogramBucketCount; bucket++)
+		result.durationHistogram[bucket] = m_counters.durationHistogram[bucket].load(std::memory_order_relaxed);
+	return result;
+}
+
+void WorkerThread::resetStatistics()
+{
+	m_counters.tasksExecuted = 0;
+	m_counters.steals = 0;
+	m_counters.busyNS = 0;
+	m_counters.idleNS = 0;
+	m_counters.queueWaitNS = 0;
+	for(auto &bucket : m_counters.durationHistogram)
+		bucket = 0;
 }
 
 void WorkerThread::workerThreadEntry( WorkerThread *context )
 {
+	if(context->m_cpus.size() > 0 && !CPUTopology::pinCurrentThread(context->m_cpus))
+		MLIB_WARNING("could not pin worker thread " + std::to_string(context->m_threadIndex));
+
+	s_currentWorker = context;
 	context->enterThreadTaskLoop();
+	s_currentWorker = nullptr;
 }
 
 void WorkerThread::enterThreadTaskLoop()
 {
-	WorkerThreadTask* curTask;
-	while(m_tasks->getNextTask(curTask))
-	{
-		curTask->run(m_threadIndex, m_storage);
-		delete curTask;
-	}
-	m_done = true;
+	WorkerThreadQueueEntry curTask;
+	while(m_pool->acquireTask(m_threadIndex, curTask))
+		m_pool->runTask(curTask, m_threadIndex, m_storage);
 }
 
 }  // namespace ml
@@ -0,0 +1,86 @@
+
+#ifdef LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ml {
+
+#ifdef _WIN32
+
+void MemoryMappedFile::open(const std::string& filename) {
+	close();
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw MLIB_EXCEPTION("could not open file " + filename);
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw MLIB_EXCEPTION("could not get the size of file " + filename);
+	}
+	if (size.QuadPart == 0) {
+		CloseHandle(file);
+		return;
+	}
+	m_file = file;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		throw MLIB_EXCEPTION("could not map file " + filename);
+	}
+	m_mapping = mapping;
+	m_data = (BYTE*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (m_data == nullptr) {
+		close();
+		throw MLIB_EXCEPTION("could not map file " + filename);
+	}
+	m_size = (size_t)size.QuadPart;
+}
+
+void MemoryMappedFile::close() {
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file) CloseHandle(m_file);
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_file = nullptr;
+}
+
+#endif //_WIN32
+
+#ifdef LINUX
+
+void MemoryMappedFile::open(const std::string& filename) {
+	close();
+	const int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0) throw MLIB_EXCEPTION("could not open file " + filename);
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		::close(file);
+		throw MLIB_EXCEPTION("could not get the size of file " + filename);
+	}
+	if (info.st_size == 0) {
+		::close(file);
+		return;
+	}
+
+	//the mapping stays valid after the descriptor is closed
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED) throw MLIB_EXCEPTION("could not map file " + filename);
+	m_data = (BYTE*)data;
+	m_size = (size_t)info.st_size;
+}
+
+void MemoryMappedFile::close() {
+	if (m_data) munmap(m_data, m_size);
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif //LINUX
+
+} // namespace ml
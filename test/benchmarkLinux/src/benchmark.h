@@ -0,0 +1,25 @@
+
+//
+// base class for the micro-benchmarks; run() prints one line per measurement
+//
+class Benchmark
+{
+public:
+	virtual ~Benchmark() {}
+
+	virtual void run() = 0;
+	virtual std::string getName() = 0;
+};
+
+//! runs f() repeatCount times and returns the best wall time in milliseconds
+template<class Function>
+double benchmarkBestOf(UINT repeatCount, const Function &f)
+{
+	double best = std::numeric_limits<double>::max();
+	for (UINT repeat = 0; repeat < repeatCount; repeat++) {
+		Timer t;
+		f();
+		best = std::min(best, t.getElapsedTimeMS());
+	}
+	return best;
+}
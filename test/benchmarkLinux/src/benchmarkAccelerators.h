@@ -0,0 +1,301 @@
+
+//
+// build quality and query speed of the triangle accelerators: the BVH built by the median, midpoint, SAH (serial and on the
+// global pool) and LBVH strategies against brute force, on procedural meshes and on the mesh files given on the command line.
+// For every mesh and accelerator it reports the build time, the memory, the SAH cost, depth and leaf statistics, the
+// single-threaded Mrays/s for primary, random and incoherent rays, and collision queries/s. Each row is appended to a CSV file
+// together with a label (e.g. the commit), so runs of different revisions can be compared; empty fields do not apply.
+//
+class BenchmarkAccelerators : public Benchmark
+{
+public:
+	BenchmarkAccelerators(const std::vector<std::string> &meshFiles = std::vector<std::string>(), const std::string &csvFile = "accelerators.csv", const std::string &label = "")
+		: m_meshFiles(meshFiles), m_csvFile(csvFile), m_label(label) {}
+
+	void run()
+	{
+		std::vector<std::pair<std::string, TriMeshf>> meshes;
+		meshes.push_back(std::make_pair("sphere coarse", Shapesf::sphere(1.0f, vec3f(0.0f, 0.0f, 0.0f), 32, 32)));
+		meshes.push_back(std::make_pair("sphere", Shapesf::sphere(1.0f, vec3f(0.0f, 0.0f, 0.0f), 100, 100)));
+		meshes.push_back(std::make_pair("torus", Shapesf::torus(vec3f(0.0f, 0.0f, 0.0f), 2.0f, 0.4f, 400, 200)));
+		meshes.push_back(std::make_pair("clutter", makeClutter()));
+		for (const std::string &filename : m_meshFiles) {
+			meshes.push_back(std::make_pair(util::fileNameFromPath(filename), TriMeshf(MeshIOf::loadFromFile(filename))));
+		}
+
+		const bool writeHeader = !util::fileExists(m_csvFile) || util::getFileSize(m_csvFile) == 0;
+		std::ofstream csv(m_csvFile, std::ios::app);
+		if (!csv.is_open()) throw MLIB_EXCEPTION("could not open " + m_csvFile);
+		if (writeHeader) {
+			csv << "date,label,threads,mesh,triangles,accelerator,build_ms,memory_bytes,sah_cost,depth,leaves,avg_leaf_size,max_leaf_size,"
+				"primary_mrays,random_mrays,incoherent_mrays,collision_queries_per_s" << std::endl;
+		}
+		m_date = currentDate();
+
+		std::cout << ThreadPool::getGlobal().getThreadCount() << " threads, writing " << m_csvFile << std::endl;
+		for (const auto &mesh : meshes) {
+			measureMesh(mesh.first, mesh.second, csv);
+		}
+	}
+
+	std::string getName()
+	{
+		return "accelerators";
+	}
+
+private:
+	//! one line of the CSV file; NaN marks a value that does not apply to the accelerator or was skipped
+	struct Row
+	{
+		Row() {
+			buildMS = sahCost = averageLeafSize = primaryMRays = randomMRays = incoherentMRays = collisionsPerSecond = std::numeric_limits<double>::quiet_NaN();
+			memoryBytes = depth = leafCount = maxLeafSize = 0;
+		}
+		std::string accelerator;
+		double buildMS;
+		size_t memoryBytes;
+		double sahCost;
+		size_t depth, leafCount, maxLeafSize;
+		double averageLeafSize;
+		double primaryMRays, randomMRays, incoherentMRays;
+		double collisionsPerSecond;
+	};
+
+	struct Queries
+	{
+		std::vector<Rayf> primary, random, incoherent;
+		std::vector<mat4f> transforms;
+	};
+
+	//! brute force only traces an evenly spread subset of the rays, and tests collisions only on small meshes
+	static const size_t bruteForceRayCount = 1000;
+	static const size_t bruteForceCollisionTriangles = 4096;
+
+	void measureMesh(const std::string &meshName, const TriMeshf &mesh, std::ofstream &csv)
+	{
+		TriMeshBVHBuildOptions options;
+		options.maxLeafSize = 4;
+		options.parallelSubtreeSize = 0;
+		TriMeshBVHBuildOptions midPoint = options;
+		midPoint.strategy = TriMeshBVHBuildMidPoint;
+		TriMeshBVHBuildOptions sah = options;
+		sah.strategy = TriMeshBVHBuildSAH;
+		TriMeshBVHBuildOptions sahParallel = sah;
+		sahParallel.parallelSubtreeSize = TriMeshBVHBuildOptions().parallelSubtreeSize;
+		TriMeshBVHBuildOptions lbvh = options;
+		lbvh.strategy = TriMeshBVHBuildLBVH;
+
+		const Queries queries = makeQueries(mesh, sah);
+		std::cout << "-- " << meshName << ": " << mesh.getIndices().size() << " triangles, " << queries.primary.size() << " primary, "
+			<< queries.random.size() << " random, " << queries.incoherent.size() << " incoherent rays, " << queries.transforms.size() << " collision queries" << std::endl;
+
+		std::vector<Row> rows;
+		rows.push_back(measureBVH("BVH median", options, mesh, queries));
+		rows.push_back(measureBVH("BVH midpoint", midPoint, mesh, queries));
+		rows.push_back(measureBVH("BVH SAH", sah, mesh, queries));
+		rows.push_back(measureBVH("BVH SAH parallel", sahParallel, mesh, queries));
+		rows.push_back(measureBVH("BVH LBVH", lbvh, mesh, queries));
+		rows.push_back(measureBruteForce(mesh, queries));
+
+		for (const Row &row : rows) {
+			std::cout << std::left << std::setw(18) << row.accelerator << std::right << std::fixed << std::setprecision(3)
+				<< " build " << std::setw(9) << row.buildMS << " ms  " << std::setw(8) << row.memoryBytes / (1024.0 * 1024.0) << " MB"
+				<< "  SAH " << std::setw(8) << row.sahCost << "  depth " << std::setw(3) << row.depth
+				<< "  Mrays/s primary " << std::setw(7) << row.primaryMRays << " random " << std::setw(7) << row.randomMRays << " incoherent " << std::setw(7) << row.incoherentMRays
+				<< "  collisions/s " << std::setprecision(0) << row.collisionsPerSecond << std::endl;
+			std::cout.unsetf(std::ios::fixed);
+
+			csv << m_date << "," << csvText(m_label) << "," << ThreadPool::getGlobal().getThreadCount() << "," << csvText(meshName) << "," << mesh.getIndices().size() << "," << csvText(row.accelerator) << ","
+				<< csvValue(row.buildMS) << "," << row.memoryBytes << "," << csvValue(row.sahCost) << ","
+				<< (row.leafCount > 0 ? std::to_string(row.depth) : "") << "," << (row.leafCount > 0 ? std::to_string(row.leafCount) : "") << ","
+				<< csvValue(row.averageLeafSize) << "," << (row.leafCount > 0 ? std::to_string(row.maxLeafSize) : "") << ","
+				<< csvValue(row.primaryMRays) << "," << csvValue(row.randomMRays) << "," << csvValue(row.incoherentMRays) << "," << csvValue(row.collisionsPerSecond) << std::endl;
+		}
+	}
+
+	static Row measureBVH(const std::string &name, const TriMeshBVHBuildOptions &options, const TriMeshf &mesh, const Queries &queries)
+	{
+		Row row;
+		row.accelerator = name;
+		TriMeshAcceleratorBVHf bvh(options);
+		row.buildMS = benchmarkBestOf(3, [&]() { bvh.build(mesh); });
+		row.memoryBytes = bvh.getMemoryUsage();
+		row.sahCost = bvh.getSAHCost();
+		row.depth = bvh.getTreeDepth();
+		for (const TriMeshAcceleratorBVHf::Node &node : bvh.getNodes()) {
+			if (!node.isLeaf()) continue;
+			row.leafCount++;
+			row.maxLeafSize = std::max(row.maxLeafSize, (size_t)node.count);
+		}
+		row.averageLeafSize = (double)bvh.triangleCount() / std::max(row.leafCount, (size_t)1);
+
+		row.primaryMRays = measureRays(bvh, queries.primary);
+		row.randomMRays = measureRays(bvh, queries.random);
+		row.incoherentMRays = measureRays(bvh, queries.incoherent);
+		row.collisionsPerSecond = measureCollisions(bvh, queries.transforms);
+		return row;
+	}
+
+	static Row measureBruteForce(const TriMeshf &mesh, const Queries &queries)
+	{
+		Row row;
+		row.accelerator = "brute force";
+		TriMeshAcceleratorBruteForcef bruteForce;
+		row.buildMS = benchmarkBestOf(3, [&]() { bruteForce.build(mesh); });
+		row.memoryBytes = bruteForce.getMemoryUsage();
+
+		row.primaryMRays = measureRays(bruteForce, spread(queries.primary, bruteForceRayCount));
+		row.randomMRays = measureRays(bruteForce, spread(queries.random, bruteForceRayCount));
+		row.incoherentMRays = measureRays(bruteForce, spread(queries.incoherent, bruteForceRayCount));
+		if (bruteForce.triangleCount() <= bruteForceCollisionTriangles) {
+			row.collisionsPerSecond = measureCollisions(bruteForce, queries.transforms);
+		}
+		return row;
+	}
+
+	//! closest hits of single rays on one thread, so the numbers do not depend on the machine's core count
+	static double measureRays(const TriMeshRayAcceleratorf &accelerator, const std::vector<Rayf> &rays)
+	{
+		if (rays.empty()) return std::numeric_limits<double>::quiet_NaN();
+		size_t hitCount = 0;
+		const double ms = benchmarkBestOf(3, [&]() {
+			hitCount = 0;
+			for (const Rayf &ray : rays) {
+				if (accelerator.intersect(ray).isValid()) hitCount++;
+			}
+		});
+		return rays.size() / 1e6 / (ms / 1000.0);
+	}
+
+	//! tests the mesh against a moved copy of itself
+	template<class Accelerator>
+	static double measureCollisions(const Accelerator &accelerator, const std::vector<mat4f> &transforms)
+	{
+		size_t collisionCount = 0;
+		const double ms = benchmarkBestOf(3, [&]() {
+			collisionCount = 0;
+			for (const mat4f &transform : transforms) {
+				if (accelerator.collision(accelerator, transform)) collisionCount++;
+			}
+		});
+		return transforms.size() / (ms / 1000.0);
+	}
+
+	//! primary rays of a 320x240 camera looking at the mesh from outside its bounds; random rays between two points of the
+	//! bounds; incoherent rays leave the primary hits in cosine-distributed directions, in shuffled order (diffuse bounces)
+	static Queries makeQueries(const TriMeshf &mesh, const TriMeshBVHBuildOptions &options)
+	{
+		Queries queries;
+		const BoundingBox3f bounds = mesh.computeBoundingBox();
+		const vec3f center = bounds.getCenter();
+		const float radius = std::max(0.5f * bounds.getExtent().length(), 1e-6f);
+
+		const UINT width = 320, height = 240;
+		const vec3f look = vec3f(-0.3f, 1.0f, -0.4f).getNormalized();
+		const vec3f right = (look ^ vec3f(0.0f, 0.0f, 1.0f)).getNormalized();
+		const vec3f up = right ^ look;
+		const vec3f eye = center - look * (2.5f * radius);
+		for (UINT y = 0; y < height; y++) {
+			for (UINT x = 0; x < width; x++) {
+				const float sx = 0.5f * ((x + 0.5f) / width * 2.0f - 1.0f);
+				const float sy = 0.5f * (1.0f - (y + 0.5f) / height * 2.0f) * height / width;
+				queries.primary.push_back(Rayf(eye, (look + right * sx + up * sy).getNormalized()));
+			}
+		}
+
+		RNG rng(1234);
+		const auto randomPoint = [&]() {
+			return vec3f(rng.uniform(bounds.getMinX(), bounds.getMaxX()), rng.uniform(bounds.getMinY(), bounds.getMaxY()), rng.uniform(bounds.getMinZ(), bounds.getMaxZ()));
+		};
+		for (size_t i = 0; i < queries.primary.size(); i++) {
+			const vec3f origin = randomPoint();
+			vec3f dir = randomPoint() - origin;
+			if (dir.length() < 1e-6f * radius) dir = vec3f(0.0f, 0.0f, 1.0f);
+			queries.random.push_back(Rayf(origin, dir.getNormalized()));
+		}
+
+		TriMeshAcceleratorBVHf bvh(options);
+		bvh.build(mesh);
+		for (const Rayf &ray : queries.primary) {
+			const TriMeshRayAcceleratorf::Intersection hit = bvh.intersect(ray);
+			if (!hit.isValid()) continue;
+			vec3f normal = (hit.triangle->getV1().position - hit.triangle->getV0().position) ^ (hit.triangle->getV2().position - hit.triangle->getV0().position);
+			if (normal.length() == 0.0f) continue;
+			normal.normalize();
+			if ((normal | ray.getDirection()) > 0.0f) normal = -normal;
+
+			const vec3f tangent = ((std::abs(normal.x) > 0.5f ? vec3f(0.0f, 1.0f, 0.0f) : vec3f(1.0f, 0.0f, 0.0f)) ^ normal).getNormalized();
+			const vec3f local = Sample<float>::squareToCosineHemisphere(vec2f(rng.uniform(0.0f, 1.0f), rng.uniform(0.0f, 1.0f)));
+			const vec3f dir = tangent * local.x + (normal ^ tangent) * local.y + normal * local.z;
+			queries.incoherent.push_back(Rayf(hit.getSurfacePosition() + normal * (1e-4f * radius), dir.getNormalized()));
+		}
+		for (size_t i = queries.incoherent.size(); i > 1; i--) {
+			std::swap(queries.incoherent[i - 1], queries.incoherent[rng.uniform(0u, (unsigned int)i)]);
+		}
+
+		for (UINT i = 0; i < 64; i++) {
+			const vec3f axis = vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)) + vec3f(0.0f, 0.0f, 1e-3f);
+			const vec3f offset = (randomPoint() - center) * 0.5f;
+			queries.transforms.push_back(mat4f::translation(center + offset) * mat4f::rotation(axis.getNormalized(), rng.uniform(0.0f, 180.0f)) * mat4f::translation(-center));
+		}
+		return queries;
+	}
+
+	//! spheres and cylinders of very different sizes and tessellations, scattered over a grid; unlike the single shapes it has
+	//! empty space and clusters of small triangles next to large ones
+	static TriMeshf makeClutter()
+	{
+		RNG rng(42);
+		std::vector<TriMeshf> parts;
+		for (UINT y = 0; y < 6; y++) {
+			for (UINT x = 0; x < 6; x++) {
+				const vec3f position(x * 3.0f + rng.uniform(-0.5f, 0.5f), y * 3.0f + rng.uniform(-0.5f, 0.5f), rng.uniform(0.0f, 2.0f));
+				const float size = rng.uniform(0.2f, 1.4f);
+				const UINT detail = (UINT)rng.uniform(8, 80);
+				if ((x + y) % 2 == 0) parts.push_back(Shapesf::sphere(size, position, detail, detail));
+				else parts.push_back(Shapesf::cylinder(position, position + vec3f(0.0f, 0.0f, 3.0f * size), 0.5f * size, detail / 4 + 1, detail));
+			}
+		}
+		return Shapesf::unifyMeshes(parts);
+	}
+
+	static std::vector<Rayf> spread(const std::vector<Rayf> &rays, size_t count)
+	{
+		if (rays.size() <= count) return rays;
+		std::vector<Rayf> result;
+		for (size_t i = 0; i < count; i++) result.push_back(rays[i * rays.size() / count]);
+		return result;
+	}
+
+	static std::string csvValue(double value)
+	{
+		if (value != value) return "";
+		std::ostringstream s;
+		s << std::setprecision(6) << value;
+		return s.str();
+	}
+
+	//! quoted, with quotes doubled, so that names may contain commas and quotes
+	static std::string csvText(const std::string &text)
+	{
+		std::string quoted = "\"";
+		for (char c : text) {
+			if (c == '"') quoted += '"';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	static std::string currentDate()
+	{
+		const std::time_t now = std::time(nullptr);
+		char buffer[32];
+		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+		return buffer;
+	}
+
+	std::vector<std::string> m_meshFiles;
+	std::string m_csvFile;
+	std::string m_label;
+	std::string m_date;
+};
@@ -0,0 +1,65 @@
+
+//
+// STREAM-style bandwidth (copy, scale, add, triad) over Grid3<float> volumes, processed in z-slices with parallelForStatic.
+// Compares grids initialized by the calling thread on an unpinned pool with first-touch initialized grids on a NUMA-placed pool.
+//
+class BenchmarkGridBandwidth : public Benchmark
+{
+public:
+	void run()
+	{
+		const size_t dim = 256;
+		const UINT threadCount = std::max(1u, std::thread::hardware_concurrency());
+		std::cout << "grid " << dim << "^3 floats, " << threadCount << " threads, " << CPUTopology::get().getNodeCount() << " NUMA nodes" << std::endl;
+
+		{
+			ThreadPool pool;
+			pool.init(threadCount, ThreadPlacementOS);
+			Grid3<float> a(dim, dim, dim, 1.0f), b(dim, dim, dim, 2.0f), c(dim, dim, dim, 0.0f);
+			measure("OS placement, serial init", pool, a, b, c);
+		}
+		{
+			ThreadPool pool;
+			pool.init(threadCount, ThreadPlacementNUMANodes);
+			Grid3<float> a(dim, dim, dim), b(dim, dim, dim), c(dim, dim, dim);
+			firstTouchFill(pool, a, 1.0f);
+			firstTouchFill(pool, b, 2.0f);
+			firstTouchFill(pool, c, 0.0f);
+			measure("NUMA placement, first touch", pool, a, b, c);
+		}
+	}
+
+	std::string getName()
+	{
+		return "gridBandwidth";
+	}
+
+private:
+	static void measure(const std::string &name, ThreadPool &pool, Grid3<float> &a, Grid3<float> &b, Grid3<float> &c)
+	{
+		const size_t sliceSize = a.getDimX() * a.getDimY();
+		const double gridBytes = (double)a.getNumElements() * sizeof(float);
+		float *pa = a.getData(), *pb = b.getData(), *pc = c.getData();
+		const float s = 3.0f;
+
+		const double copyTime = benchmarkBestOf(5, [&]() {
+			parallelForStatic(pool, 0, a.getDimZ(), [&](size_t z) { for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; i++) pc[i] = pa[i]; });
+		});
+		const double scaleTime = benchmarkBestOf(5, [&]() {
+			parallelForStatic(pool, 0, a.getDimZ(), [&](size_t z) { for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; i++) pb[i] = s * pc[i]; });
+		});
+		const double addTime = benchmarkBestOf(5, [&]() {
+			parallelForStatic(pool, 0, a.getDimZ(), [&](size_t z) { for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; i++) pc[i] = pa[i] + pb[i]; });
+		});
+		const double triadTime = benchmarkBestOf(5, [&]() {
+			parallelForStatic(pool, 0, a.getDimZ(), [&](size_t z) { for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; i++) pa[i] = pb[i] + s * pc[i]; });
+		});
+
+		//GB/s = bytes / ms / 1e6
+		std::cout << name << ": "
+			<< "copy " << 2.0 * gridBytes / copyTime / 1e6 << " GB/s, "
+			<< "scale " << 2.0 * gridBytes / scaleTime / 1e6 << " GB/s, "
+			<< "add " << 3.0 * gridBytes / addTime / 1e6 << " GB/s, "
+			<< "triad " << 3.0 * gridBytes / triadTime / 1e6 << " GB/s" << std::endl;
+	}
+};
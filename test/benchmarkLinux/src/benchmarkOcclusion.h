@@ -0,0 +1,86 @@
+
+//
+// shadow rays: the primary hits of a camera are connected to a point light. Compares occluded() with answering the same
+// segment query by a closest hit, and reports the primary closest-hit rate for reference.
+//
+class BenchmarkOcclusion : public Benchmark
+{
+public:
+	void run()
+	{
+		std::vector<TriMeshf> scene;
+		scene.push_back(Shapesf::box(BoundingBox3f(vec3f(-10.0f, -10.0f, -2.0f), vec3f(10.0f, 10.0f, 6.0f))));
+		scene.push_back(Shapesf::sphere(1.0f, vec3f(2.0f, 1.0f, 1.0f), 200, 200));
+		scene.push_back(Shapesf::torus(vec3f(-3.0f, -2.0f, 0.5f), 2.0f, 0.4f, 300, 100));
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf &mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshBVHBuildOptions sahOptions;
+		sahOptions.strategy = TriMeshBVHBuildSAH;
+		sahOptions.maxLeafSize = 4;
+
+		TriMeshAcceleratorBVHf median;
+		median.build(meshes);
+		TriMeshAcceleratorBVHf sah(sahOptions);
+		sah.build(meshes);
+		TriMeshAcceleratorBVH4f bvh4(sahOptions);
+		bvh4.build(meshes);
+		TriMeshAcceleratorBVH8f bvh8(sahOptions);
+		bvh8.build(meshes);
+
+		//shadow segments end slightly before the light and start slightly after the surface
+		const std::vector<Rayf> cameraRays = BenchmarkRayBatch::makeCameraRays(640, 480);
+		const vec3f light(1.0f, -4.0f, 5.5f);
+		std::vector<Rayf> shadowRays;
+		std::vector<float> shadowLengths;
+		for (const Rayf &ray : cameraRays) {
+			const TriMeshRayAcceleratorf::Intersection hit = sah.intersect(ray);
+			if (!hit.isValid()) continue;
+			const vec3f p = ray.getOrigin() + ray.getDirection() * hit.t;
+			const float distance = (light - p).length();
+			shadowRays.push_back(Rayf(p, (light - p) / distance));
+			shadowLengths.push_back(distance * 0.999f);
+		}
+
+		std::cout << sah.triangleCount() << " triangles, " << cameraRays.size() << " primary rays, " << shadowRays.size() << " shadow rays" << std::endl;
+		measure("BVH median", median, cameraRays, shadowRays, shadowLengths);
+		measure("BVH SAH", sah, cameraRays, shadowRays, shadowLengths);
+		measure("BVH4 SAH", bvh4, cameraRays, shadowRays, shadowLengths);
+		measure("BVH8 SAH", bvh8, cameraRays, shadowRays, shadowLengths);
+	}
+
+	std::string getName()
+	{
+		return "occlusion";
+	}
+
+private:
+	static void measure(const std::string &name, const TriMeshRayAcceleratorf &accelerator, const std::vector<Rayf> &cameraRays, const std::vector<Rayf> &shadowRays, const std::vector<float> &shadowLengths)
+	{
+		const float epsilon = 1e-4f;
+		size_t closestCount = 0, occludedCount = 0;
+		const double primaryMS = benchmarkBestOf(3, [&]() {
+			for (const Rayf &ray : cameraRays) accelerator.intersect(ray);
+		});
+		const double closestMS = benchmarkBestOf(3, [&]() {
+			closestCount = 0;
+			for (size_t i = 0; i < shadowRays.size(); i++) {
+				if (accelerator.intersect(shadowRays[i], epsilon, shadowLengths[i]).isValid()) closestCount++;
+			}
+		});
+		const double occludedMS = benchmarkBestOf(3, [&]() {
+			occludedCount = 0;
+			for (size_t i = 0; i < shadowRays.size(); i++) {
+				if (accelerator.occluded(shadowRays[i], epsilon, shadowLengths[i])) occludedCount++;
+			}
+		});
+		if (closestCount != occludedCount) std::cout << "occluded() disagrees with the closest hit" << std::endl;
+
+		std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+			<< " primary " << std::setw(8) << cameraRays.size() / 1e3 / primaryMS << " Mrays/s"
+			<< "  shadow closest hit " << std::setw(8) << shadowRays.size() / 1e3 / closestMS << " Mrays/s"
+			<< "  shadow occluded " << std::setw(8) << shadowRays.size() / 1e3 / occludedMS << " Mrays/s"
+			<< "  (" << occludedCount << " in shadow)" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+};
@@ -0,0 +1,148 @@
+
+//
+// binary PLY loading throughput in MB/s: MeshIO and PointCloudIO, which decode with a compiled PlyVertexSchema/PlyFaceSchema,
+// against the loader they replaced, which compared the property names of every vertex. The file is a synthetic scan of a
+// height field (float position and normal, uchar color) triangulated as a grid, like the output of a depth sensor. Reading
+// the positions in place through a PlyVertexView of the mapped file is measured as well.
+//
+class BenchmarkPlyLoading : public Benchmark
+{
+public:
+	BenchmarkPlyLoading(size_t vertexCount = 10000000) : m_vertexCount(vertexCount) {}
+
+	void run()
+	{
+		const std::string filename = "benchmarkPlyLoading.ply";
+		const UINT width = (UINT)std::sqrt((double)m_vertexCount);
+		writeScan(filename, width, width);
+		const double vertexMB = (double)width * width * (6 * sizeof(float) + 3) / (1024.0 * 1024.0);
+		const double fileMB = util::getFileSize(filename) / (1024.0 * 1024.0);
+		std::cout << width * width << " vertices, " << 2 * (width - 1) * (width - 1) << " triangles, " << fileMB << " MB" << std::endl;
+
+		MeshDataf reference, mesh;
+		PointCloudf pc;
+		const double referencePointsMS = benchmarkBestOf(3, [&]() { loadReference(filename, reference, false); });
+		const double pointsMS = benchmarkBestOf(3, [&]() { pc = PointCloudIOf::loadFromFile(filename); });
+		if (pc.m_points != reference.m_Vertices || pc.m_normals != reference.m_Normals) std::cout << "PointCloudIO disagrees with the reference loader" << std::endl;
+		const double referenceMeshMS = benchmarkBestOf(3, [&]() { loadReference(filename, reference, true); });
+		const double meshMS = benchmarkBestOf(3, [&]() { MeshIOf::loadFromPLY(filename, mesh); });
+		if (mesh.m_Vertices != reference.m_Vertices || mesh.m_FaceIndicesVertices.size() != reference.m_FaceIndicesVertices.size()) std::cout << "MeshIO disagrees with the reference loader" << std::endl;
+
+		double zSum = 0.0;
+		const double viewMS = benchmarkBestOf(3, [&]() {
+			PlyMappedFile file(filename);
+			PlyVertexView<float> view;
+			if (!file.getVertexView(view)) return;
+			zSum = 0.0;
+			for (size_t i = 0; i < view.size(); i++) zSum += view[i].z;
+		});
+
+		print("vertices, name compare", vertexMB, referencePointsMS);
+		print("vertices, PointCloudIO", vertexMB, pointsMS);
+		print("vertices, mapped view", vertexMB, viewMS);
+		print("mesh, name compare", fileMB, referenceMeshMS);
+		print("mesh, MeshIO", fileMB, meshMS);
+		util::deleteFile(filename);
+	}
+
+	std::string getName()
+	{
+		return "plyLoading";
+	}
+
+private:
+	static void print(const std::string &name, double MB, double ms)
+	{
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(9) << ms << " ms " << std::setw(9) << MB / (ms / 1000.0) << " MB/s" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	static void writeScan(const std::string &filename, UINT width, UINT height)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		file << "ply\nformat binary_little_endian 1.0\n";
+		file << "element vertex " << width * height << "\n";
+		file << "property float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n";
+		file << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+		file << "element face " << 2 * (width - 1) * (height - 1) << "\n";
+		file << "property list uchar int vertex_indices\nend_header\n";
+
+		std::vector<char> row;
+		for (UINT y = 0; y < height; y++) {
+			row.clear();
+			for (UINT x = 0; x < width; x++) {
+				const float values[6] = { (float)x, (float)y, std::sin(0.01f * x) * std::cos(0.01f * y), 0.0f, 0.0f, 1.0f };
+				row.insert(row.end(), (const char*)values, (const char*)(values + 6));
+				row.push_back((char)(x % 256));
+				row.push_back((char)(y % 256));
+				row.push_back((char)128);
+			}
+			file.write(row.data(), row.size());
+		}
+		for (UINT y = 0; y + 1 < height; y++) {
+			row.clear();
+			for (UINT x = 0; x + 1 < width; x++) {
+				const int i = (int)(y * width + x);
+				const int triangles[2][3] = { { i, i + 1, i + (int)width }, { i + 1, i + (int)width + 1, i + (int)width } };
+				for (const auto &triangle : triangles) {
+					row.push_back((char)3);
+					row.insert(row.end(), (const char*)triangle, (const char*)(triangle + 3));
+				}
+			}
+			file.write(row.data(), row.size());
+		}
+	}
+
+	//! the binary path of MeshIO::loadFromPLY before the header was compiled: reads the whole body, compares the name of
+	//! every property of every vertex, assumes float positions and normals and triangles with uchar counts and int indices
+	static void loadReference(const std::string &filename, MeshDataf &mesh, bool loadFaces)
+	{
+		mesh.clear();
+		std::ifstream file(filename, std::ios::binary);
+		PlyHeader header(file);
+		mesh.m_Vertices.resize(header.m_numVertices);
+		if (header.m_bHasNormals) mesh.m_Normals.resize(header.m_numVertices);
+		if (header.m_bHasColors) mesh.m_Colors.resize(header.m_numVertices);
+
+		unsigned int size = 0;
+		for (unsigned int i = 0; i < header.m_properties["vertex"].size(); i++) {
+			size += header.m_properties["vertex"][i].byteSize;
+		}
+		char* data = new char[size*header.m_numVertices];
+		file.read(data, size*header.m_numVertices);
+		for (unsigned int i = 0; i < header.m_numVertices; i++) {
+			unsigned int byteOffset = 0;
+			const std::vector<PlyHeader::PlyPropertyHeader>& vertexProperties = header.m_properties["vertex"];
+			for (unsigned int j = 0; j < vertexProperties.size(); j++) {
+				const std::string &name = vertexProperties[j].name;
+				if (name == "x") mesh.m_Vertices[i].x = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "y") mesh.m_Vertices[i].y = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "z") mesh.m_Vertices[i].z = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "nx") mesh.m_Normals[i].x = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "ny") mesh.m_Normals[i].y = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "nz") mesh.m_Normals[i].z = ((float*)&data[i*size + byteOffset])[0];
+				else if (name == "red") mesh.m_Colors[i].x = ((unsigned char*)&data[i*size + byteOffset])[0] / 255.0f;
+				else if (name == "green") mesh.m_Colors[i].y = ((unsigned char*)&data[i*size + byteOffset])[0] / 255.0f;
+				else if (name == "blue") mesh.m_Colors[i].z = ((unsigned char*)&data[i*size + byteOffset])[0] / 255.0f;
+				else if (name == "alpha") mesh.m_Colors[i].w = ((unsigned char*)&data[i*size + byteOffset])[0] / 255.0f;
+				byteOffset += vertexProperties[j].byteSize;
+			}
+		}
+		delete[] data;
+		if (!loadFaces) return;
+
+		mesh.m_FaceIndicesVertices.resize(header.m_numFaces, 3);
+		size = 1 + 3 * 4;
+		data = new char[size*header.m_numFaces];
+		file.read(data, size*header.m_numFaces);
+		for (unsigned int i = 0; i < header.m_numFaces; i++) {
+			mesh.m_FaceIndicesVertices[i][0] = ((int*)&data[i*size + 1])[0];
+			mesh.m_FaceIndicesVertices[i][1] = ((int*)&data[i*size + 1])[1];
+			mesh.m_FaceIndicesVertices[i][2] = ((int*)&data[i*size + 1])[2];
+		}
+		delete[] data;
+	}
+
+	size_t m_vertexCount;
+};
@@ -0,0 +1,100 @@
+
+//
+// closest-hit throughput of the ray accelerators in Mrays/s: single rays on one thread, single rays spread over the global
+// pool with parallelFor, and the batched intersect(rays, count, results), for coherent camera rays and random rays.
+//
+class BenchmarkRayBatch : public Benchmark
+{
+public:
+	void run()
+	{
+		std::vector<TriMeshf> scene;
+		scene.push_back(Shapesf::box(BoundingBox3f(vec3f(-10.0f, -10.0f, -2.0f), vec3f(10.0f, 10.0f, 6.0f))));
+		scene.push_back(Shapesf::sphere(1.0f, vec3f(2.0f, 1.0f, 1.0f), 200, 200));
+		scene.push_back(Shapesf::torus(vec3f(-3.0f, -2.0f, 0.5f), 2.0f, 0.4f, 300, 100));
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf &mesh : scene) meshes.push_back(&mesh);
+
+		const std::vector<Rayf> cameraRays = makeCameraRays(640, 480);
+		const std::vector<Rayf> randomRays = makeRandomRays(cameraRays.size());
+
+		TriMeshBVHBuildOptions sahOptions;
+		sahOptions.strategy = TriMeshBVHBuildSAH;
+		sahOptions.maxLeafSize = 4;
+
+		TriMeshAcceleratorBVHf median;
+		median.build(meshes);
+		TriMeshAcceleratorBVHf sah(sahOptions);
+		sah.build(meshes);
+		TriMeshAcceleratorBVH4f bvh4(sahOptions);
+		bvh4.build(meshes);
+		TriMeshAcceleratorBVH8f bvh8(sahOptions);
+		bvh8.build(meshes);
+		TriMeshAcceleratorBruteForcef bruteForce;
+		bruteForce.build(meshes);
+
+		std::cout << sah.triangleCount() << " triangles, " << cameraRays.size() << " rays, " << ThreadPool::getGlobal().getThreadCount() << " threads" << std::endl;
+		for (int coherent = 1; coherent >= 0; coherent--) {
+			const std::vector<Rayf> &rays = coherent ? cameraRays : randomRays;
+			const std::string raysName = coherent ? "camera" : "random";
+			measure("BVH median, " + raysName, median, rays);
+			measure("BVH SAH, " + raysName, sah, rays);
+			measure("BVH4 SAH, " + raysName, bvh4, rays);
+			measure("BVH8 SAH, " + raysName, bvh8, rays);
+			measure("brute force, " + raysName, bruteForce, std::vector<Rayf>(rays.begin(), rays.begin() + 2000));
+		}
+	}
+
+	std::string getName()
+	{
+		return "rayBatch";
+	}
+
+	static std::vector<Rayf> makeCameraRays(UINT width, UINT height)
+	{
+		std::vector<Rayf> rays(width * height);
+		const vec3f eye(0.0f, -8.0f, 2.0f);
+		for (UINT y = 0; y < height; y++) {
+			for (UINT x = 0; x < width; x++) {
+				const vec3f dir((x + 0.5f) / width - 0.5f, 0.75f, 0.5f - (y + 0.5f) / height);
+				rays[y * width + x] = Rayf(eye, dir.getNormalized());
+			}
+		}
+		return rays;
+	}
+
+	static std::vector<Rayf> makeRandomRays(size_t count)
+	{
+		RNG rng(1234);
+		std::vector<Rayf> rays(count);
+		for (size_t i = 0; i < count; i++) {
+			const vec3f origin(rng.uniform(-8.0f, 8.0f), rng.uniform(-8.0f, 8.0f), rng.uniform(-1.0f, 5.0f));
+			vec3f dir(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+			if (dir.length() < 1e-3f) dir = vec3f(0.0f, 0.0f, 1.0f);
+			rays[i] = Rayf(origin, dir.getNormalized());
+		}
+		return rays;
+	}
+
+private:
+	static void measure(const std::string &name, const TriMeshRayAcceleratorf &accelerator, const std::vector<Rayf> &rays)
+	{
+		std::vector<TriMeshRayAcceleratorf::Intersection> results(rays.size());
+		const double singleMS = benchmarkBestOf(3, [&]() {
+			for (size_t i = 0; i < rays.size(); i++) results[i] = accelerator.intersect(rays[i]);
+		});
+		const double parallelMS = benchmarkBestOf(3, [&]() {
+			parallelFor(0, rays.size(), [&](size_t i) { results[i] = accelerator.intersect(rays[i]); });
+		});
+		const double batchMS = benchmarkBestOf(3, [&]() {
+			accelerator.intersect(rays.data(), rays.size(), results.data());
+		});
+
+		const double megaRays = rays.size() / 1e6;
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+			<< " single " << std::setw(8) << megaRays / (singleMS / 1000.0) << " Mrays/s"
+			<< "  parallel " << std::setw(8) << megaRays / (parallelMS / 1000.0) << " Mrays/s"
+			<< "  batched " << std::setw(8) << megaRays / (batchMS / 1000.0) << " Mrays/s" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+};
@@ -0,0 +1,56 @@
+
+//
+// contention on TaskList versus BoundedTaskQueue: every thread alternates insert and getNextTask on one shared queue
+//
+class BenchmarkTaskQueue : public Benchmark
+{
+public:
+	void run()
+	{
+		const UINT operationsPerThread = 200000;
+		for (UINT threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u }) {
+			TaskList<UINT> taskList;
+			BoundedTaskQueue<UINT> boundedQueue(4096);
+
+			const double taskListTime = measure(taskList, threadCount, operationsPerThread);
+			const double boundedQueueTime = measure(boundedQueue, threadCount, operationsPerThread);
+
+			const double operations = 2.0 * threadCount * operationsPerThread;
+			std::cout << threadCount << " threads: "
+				<< "TaskList " << operations / taskListTime / 1000.0 << " Mops/s, "
+				<< "BoundedTaskQueue " << operations / boundedQueueTime / 1000.0 << " Mops/s" << std::endl;
+		}
+	}
+
+	std::string getName()
+	{
+		return "taskQueue";
+	}
+
+private:
+	//! returns the wall time in milliseconds
+	template<class Queue>
+	static double measure(Queue &queue, UINT threadCount, UINT operationsPerThread)
+	{
+		std::atomic<UINT> ready(0);
+		std::atomic<bool> go(false);
+		std::vector<std::thread> threads;
+		for (UINT threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+			threads.push_back(std::thread([&, threadIndex]() {
+				ready++;
+				while (!go) std::this_thread::yield();
+				UINT task;
+				for (UINT i = 0; i < operationsPerThread; i++) {
+					queue.insert(threadIndex);
+					queue.getNextTask(task);
+				}
+			}));
+		}
+		while (ready < threadCount) std::this_thread::yield();
+
+		Timer t;
+		go = true;
+		for (auto &thread : threads) thread.join();
+		return t.getElapsedTimeMS();
+	}
+};
@@ -0,0 +1,92 @@
+
+class BenchmarkThreadPoolTask : public WorkerThreadTask
+{
+public:
+	BenchmarkThreadPoolTask(float *data, size_t begin, size_t end) : m_data(data), m_begin(begin), m_end(end) {}
+
+	void run(UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+	{
+		for (size_t i = m_begin; i < m_end; i++) m_data[i] = std::sqrt(m_data[i] + 1.0f);
+	}
+
+private:
+	float *m_data;
+	size_t m_begin, m_end;
+};
+
+//
+// compares one heap-allocated WorkerThreadTask per work item (the runTasks pattern) with parallelFor
+// on the same persistent pool, for tiny and large per-item costs
+//
+class BenchmarkThreadPool : public Benchmark
+{
+public:
+	void run()
+	{
+		ThreadPool &pool = ThreadPool::getGlobal();
+		std::cout << "threads: " << pool.getThreadCount() << std::endl;
+
+		for (size_t itemSize : { (size_t)1, (size_t)64, (size_t)4096 }) {
+			const size_t itemCount = 16384;
+			std::vector<float> data(itemCount * itemSize, 1.0f);
+			float *dataPtr = data.data();
+
+			const double taskTime = benchmarkBestOf(5, [&]() {
+				TaskList<WorkerThreadTask*> tasks;
+				for (size_t item = 0; item < itemCount; item++) {
+					tasks.insert(new BenchmarkThreadPoolTask(dataPtr, item * itemSize, (item + 1) * itemSize));
+				}
+				pool.runTasks(tasks, false);
+			});
+
+			const double grainOneTime = benchmarkBestOf(5, [&]() {
+				parallelFor(pool, 0, itemCount, 1, [&](size_t item) {
+					for (size_t i = item * itemSize; i < (item + 1) * itemSize; i++) dataPtr[i] = std::sqrt(dataPtr[i] + 1.0f);
+				});
+			});
+
+			const double autoGrainTime = benchmarkBestOf(5, [&]() {
+				parallelFor(pool, 0, itemCount, 0, [&](size_t item) {
+					for (size_t i = item * itemSize; i < (item + 1) * itemSize; i++) dataPtr[i] = std::sqrt(dataPtr[i] + 1.0f);
+				});
+			});
+
+			std::cout << itemCount << " items x " << itemSize << " floats: "
+				<< "runTasks " << taskTime << " ms, "
+				<< "parallelFor(grain 1) " << grainOneTime << " ms, "
+				<< "parallelFor(auto grain) " << autoGrainTime << " ms" << std::endl;
+		}
+
+		const size_t sumCount = 1 << 24;
+		double sum = 0.0;
+		const double reduceTime = benchmarkBestOf(5, [&]() {
+			sum = parallelReduce(pool, 0, sumCount, 0.0, [](size_t i) { return 1.0 / (double)(i + 1); }, [](double a, double b) { return a + b; });
+		});
+		std::cout << "parallelReduce over " << sumCount << " elements: " << reduceTime << " ms (sum " << sum << ")" << std::endl;
+
+		const size_t submitCount = 100000;
+		const double submitTime = benchmarkBestOf(5, [&]() {
+			std::vector< TaskFuture<size_t> > futures;
+			futures.reserve(submitCount);
+			for (size_t i = 0; i < submitCount; i++) futures.push_back(pool.submit([i]() { return i; }));
+			for (auto &f : futures) f.get();
+		});
+		std::cout << "submit + get of " << submitCount << " tasks: " << submitTime << " ms" << std::endl;
+
+		//per-worker counters of one fine-grained and one coarse loop, to tell imbalance from scheduling overhead
+		std::vector<float> data(1 << 22, 1.0f);
+		float *dataPtr = data.data();
+		pool.resetStatistics();
+		pool.setStatisticsEnabled(true);
+		parallelFor(pool, 0, data.size(), 1, [&](size_t i) { dataPtr[i] = std::sqrt(dataPtr[i] + 1.0f); });
+		parallelFor(pool, 0, data.size(), 0, [&](size_t i) { dataPtr[i] = std::sqrt(dataPtr[i] + 1.0f); });
+		pool.setStatisticsEnabled(false);
+		pool.saveStatisticsJSON("threadPoolStatistics.json");
+		std::cout << "worker statistics written to threadPoolStatistics.json" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "threadPool";
+	}
+};
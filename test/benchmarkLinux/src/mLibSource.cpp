@@ -0,0 +1,3 @@
+#include "mLibCore.h"
+
+#include "mLibCore.cpp"
@@ -0,0 +1,57 @@
+
+#include "mLibCore.h"
+
+using namespace ml;
+
+#include "benchmark.h"
+#include "benchmarkThreadPool.h"
+#include "benchmarkTaskQueue.h"
+#include "benchmarkGridBandwidth.h"
+#include "benchmarkRayBatch.h"
+#include "benchmarkOcclusion.h"
+#include "benchmarkAccelerators.h"
+#include "benchmarkPlyLoading.h"
+
+//
+// usage: mLibBenchmark [name ...] [--mesh file ...] [--csv file] [--label text]; runs all benchmarks if no name is given.
+// --mesh adds a mesh file to the accelerators benchmark, which appends its results to --csv (accelerators.csv by default)
+// labeled with --label, e.g. the commit
+//
+int main(int argc, char** argv)
+{
+	std::vector<std::string> names, meshFiles;
+	std::string csvFile = "accelerators.csv", label;
+	for (int arg = 1; arg < argc; arg++) {
+		const std::string s = argv[arg];
+		if ((s == "--mesh" || s == "--csv" || s == "--label") && arg + 1 < argc) {
+			const std::string value = argv[++arg];
+			if (s == "--mesh") meshFiles.push_back(value);
+			else if (s == "--csv") csvFile = value;
+			else label = value;
+		}
+		else names.push_back(s);
+	}
+
+	std::vector<Benchmark*> benchmarks;
+	benchmarks.push_back(new BenchmarkThreadPool);
+	benchmarks.push_back(new BenchmarkTaskQueue);
+	benchmarks.push_back(new BenchmarkGridBandwidth);
+	benchmarks.push_back(new BenchmarkRayBatch);
+	benchmarks.push_back(new BenchmarkOcclusion);
+	benchmarks.push_back(new BenchmarkAccelerators(meshFiles, csvFile, label));
+	benchmarks.push_back(new BenchmarkPlyLoading);
+
+	for (Benchmark *b : benchmarks) {
+		bool selected = names.empty();
+		for (const std::string &name : names) {
+			if (b->getName() == name) selected = true;
+		}
+		if (selected) {
+			std::cout << "<< " << b->getName() << " >>" << std::endl;
+			b->run();
+		}
+	}
+
+	for (Benchmark *b : benchmarks) SAFE_DELETE(b);
+	return 0;
+}
@@ -13,6 +13,12 @@ public:
 	void go() {
 		m_grid.run();
 		m_binaryStream.run();
+		m_bvh.run();
+		m_ply.run();
+		m_taskFuture.run();
+		m_boundedTaskQueue.run();
+		m_taskGraph.run();
+		m_threadPool.run();
 
 		//m_box.run();
 		//m_cgal.run();
@@ -33,6 +39,12 @@ private:
 	TestLodePNG m_lodePNG;
 	TestBinaryStream m_binaryStream;
 	TestOpenMesh m_openMesh;
+	TestBVH m_bvh;
+	TestPLY m_ply;
+	TestTaskFuture m_taskFuture;
+	TestBoundedTaskQueue m_boundedTaskQueue;
+	TestTaskGraph m_taskGraph;
+	TestThreadPool m_threadPool;
 };
 
 int main()
@@ -10,4 +10,10 @@
 #include "testBinaryStream.h"
 #include "testGrid.h"
 #include "testOpenMesh.h"
-#include "testCGAL.h"
\ No newline at end of file
+#include "testCGAL.h"
+#include "testThreadPool.h"
+#include "testTaskGraph.h"
+#include "testBoundedTaskQueue.h"
+#include "testTaskFuture.h"
+#include "testBVH.h"
+#include "testPLY.h"
\ No newline at end of file
@@ -0,0 +1,835 @@
+
+class TestBVH : public Test
+{
+public:
+	//! uneven triangle sizes: a large room box with a finely tessellated sphere and torus inside
+	static std::vector<TriMeshf> makeScene()
+	{
+		std::vector<TriMeshf> meshes;
+		meshes.push_back(Shapesf::box(BoundingBox3f(vec3f(-10.0f, -10.0f, -2.0f), vec3f(10.0f, 10.0f, 6.0f))));
+		meshes.push_back(Shapesf::sphere(1.0f, vec3f(2.0f, 1.0f, 1.0f), 60, 60));
+		meshes.push_back(Shapesf::torus(vec3f(-3.0f, -2.0f, 0.5f), 2.0f, 0.4f, 80, 40));
+		return meshes;
+	}
+
+	static std::vector<Rayf> makeRays(size_t count)
+	{
+		RNG rng(1234);
+		std::vector<Rayf> rays(count);
+		for (size_t i = 0; i < count; i++) {
+			const vec3f origin(rng.uniform(-8.0f, 8.0f), rng.uniform(-8.0f, 8.0f), rng.uniform(-1.0f, 5.0f));
+			vec3f dir(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+			if (dir.length() < 1e-3f) dir = vec3f(0.0f, 0.0f, 1.0f);
+			rays[i] = Rayf(origin, dir.getNormalized());
+		}
+		return rays;
+	}
+
+	static void checkAgainstBruteForce(const TriMeshRayAcceleratorf& accelerator, const TriMeshAcceleratorBruteForcef& reference, const std::vector<Rayf>& rays)
+	{
+		for (const Rayf& ray : rays) {
+			const TriMeshRayAcceleratorf::Intersection a = accelerator.intersect(ray);
+			const TriMeshRayAcceleratorf::Intersection b = reference.intersect(ray);
+			MLIB_ASSERT_STR(a.isValid() == b.isValid(), "BVH hit/miss differs from brute force");
+			if (a.isValid()) {
+				MLIB_ASSERT_STR(std::abs(a.t - b.t) <= 1e-4f * std::max(1.0f, b.t), "BVH hit distance differs from brute force");
+			}
+		}
+	}
+
+	void test0()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshAcceleratorBruteForcef reference;
+		reference.build(meshes);
+		const std::vector<Rayf> rays = makeRays(2000);
+
+		//every strategy must find the same closest hits
+		for (TriMeshBVHBuildStrategy strategy : { TriMeshBVHBuildMedian, TriMeshBVHBuildMidPoint, TriMeshBVHBuildSAH, TriMeshBVHBuildLBVH }) {
+			TriMeshBVHBuildOptions options;
+			options.strategy = strategy;
+			options.parallelSubtreeSize = 256;
+
+			Timer t;
+			TriMeshAcceleratorBVHf bvh(options);
+			bvh.build(meshes);
+			std::cout << "strategy " << strategy << ": build " << t.getElapsedTimeMS() << " ms, SAH cost " << bvh.getSAHCost() << std::endl;
+
+			checkAgainstBruteForce(bvh, reference, rays);
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshBVHBuildOptions options;
+		TriMeshAcceleratorBVHf median(options);
+		median.build(meshes);
+
+		options.strategy = TriMeshBVHBuildSAH;
+		TriMeshAcceleratorBVHf sah(options);
+		sah.build(meshes);
+		MLIB_ASSERT_STR(sah.getSAHCost() < median.getSAHCost(), "SAH build not cheaper than the median build");
+
+		//the serial and the parallel SAH build must produce the same tree
+		options.parallelSubtreeSize = 0;
+		TriMeshAcceleratorBVHf serial(options);
+		serial.build(meshes);
+		MLIB_ASSERT_STR(serial.getSAHCost() == sah.getSAHCost(), "parallel SAH build differs from serial build");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	//! the range query must report exactly the triangles that the region's own test accepts, in storage order, serially and in parallel
+	template <class Region>
+	static size_t checkRangeQuery(const TriMeshAcceleratorBVHf& bvh, const std::vector<TriMeshf>& scene, const Region& region)
+	{
+		const TriangleBVHRegion<Region, float> test(region);
+		std::set<std::pair<UINT, UINT>> expected;
+		for (size_t m = 0; m < scene.size(); m++) {
+			const std::vector<TriMeshf::Vertex>& vertices = scene[m].getVertices();
+			const std::vector<vec3ui>& indices = scene[m].getIndices();
+			for (size_t i = 0; i < indices.size(); i++) {
+				if (test.intersects(vertices[indices[i].x].position, vertices[indices[i].y].position, vertices[indices[i].z].position)) expected.insert(std::make_pair((UINT)m, (UINT)i));
+			}
+		}
+
+		std::vector<const TriMeshf::Triangle*> found;
+		bvh.forEachOverlapping(region, [&](const TriMeshf::Triangle* tri) { found.push_back(tri); });
+		std::set<std::pair<UINT, UINT>> keys;
+		for (size_t i = 0; i < found.size(); i++) {
+			MLIB_ASSERT_STR(i == 0 || found[i - 1] < found[i], "range query results not in storage order");
+			keys.insert(std::make_pair(found[i]->getMeshIndex(), found[i]->getIndex()));
+		}
+		MLIB_ASSERT_STR(keys == expected, "range query differs from brute force");
+		MLIB_ASSERT_STR(bvh.findOverlapping(region) == found && bvh.findOverlapping(region, true) == found, "range query outputs differ");
+		return found.size();
+	}
+
+	void test2()
+	{
+		MLIB_ASSERT_STR(sizeof(TriangleBVHFlatNode<float>) == 32 && sizeof(TriangleBVHFlatNode<double>) == 64, "unexpected BVH node size");
+
+		const TriMeshf torus = Shapesf::torus(vec3f(0.0f, 0.0f, 0.0f), 2.0f, 0.5f, 40, 20);
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		TriMeshAcceleratorBVHf bvh(torus, options);
+
+		const auto& nodes = bvh.getNodes();
+		MLIB_ASSERT_STR(((size_t)nodes.data() & 31) == 0, "BVH nodes not 32-byte aligned");
+		MLIB_ASSERT_STR(nodes.size() == 2 * bvh.triangleCount() - 1, "unexpected BVH node count");
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i].isLeaf()) continue;
+			MLIB_ASSERT_STR(nodes[i].offset > i + 1 && nodes[i].offset < nodes.size(), "BVH second child index out of range");
+			BoundingBox3f children = nodes[i + 1].boundingBox;
+			children.include(nodes[nodes[i].offset].boundingBox);
+			MLIB_ASSERT_STR(children.getMin() == nodes[i].boundingBox.getMin() && children.getMax() == nodes[i].boundingBox.getMax(), "BVH node does not bound its children");
+		}
+
+		//collisions must agree with the brute-force accelerator
+		TriMeshAcceleratorBruteForcef reference(torus);
+		for (float offset : { 0.5f, 1.2f, 6.0f }) {
+			const mat4f transform = mat4f::translation(offset, 0.0f, 0.3f);
+			const TriMeshAcceleratorBVHf other(torus, options);
+			MLIB_ASSERT_STR(bvh.collision(other, transform) == reference.collision(TriMeshAcceleratorBruteForcef(torus), transform), "BVH collision differs from brute force");
+		}
+
+		//all intersecting triangle pairs must agree, for rotated, scaled and sheared placements
+		const TriMeshf smallTorus = Shapesf::torus(vec3f(0.0f, 0.0f, 0.0f), 2.0f, 0.5f, 24, 12);
+		options.maxLeafSize = 4;
+		const TriMeshAcceleratorBVHf smallBVH(smallTorus, options);
+		const TriMeshAcceleratorBruteForcef smallReference(smallTorus);
+		RNG rng(5);
+		for (unsigned int i = 0; i < 24; i++) {
+			const vec3f axis = vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)) + vec3f(0.0f, 0.0f, 0.1f);
+			const mat4f rotation = mat4f::rotation(axis.getNormalized(), rng.uniform(0.0f, 360.0f));
+			const mat4f scale = mat4f::scale(rng.uniform(0.5f, 1.5f), rng.uniform(0.5f, 1.5f), rng.uniform(0.5f, 1.5f));
+			const mat4f translation = mat4f::translation(rng.uniform(-3.0f, 3.0f), rng.uniform(-3.0f, 3.0f), rng.uniform(-1.0f, 1.0f));
+			const mat4f transform = i % 3 == 0 ? translation : (i % 3 == 1 ? translation * rotation * scale : translation * scale * rotation);
+
+			std::vector<TriMeshAcceleratorBVHf::TrianglePair> pairs, referencePairs;
+			const bool hit = smallBVH.collision(smallBVH, transform, pairs);
+			MLIB_ASSERT_STR(smallReference.collision(smallReference, transform, referencePairs) == hit && hit == smallBVH.collision(smallBVH, transform), "BVH collision differs from brute force");
+			MLIB_ASSERT_STR(collisionKeys(pairs) == collisionKeys(referencePairs), "BVH triangle pairs differ from brute force");
+
+			MLIB_ASSERT_STR(smallBVH.collision(smallBVH, transform, pairs, true) == hit && pairs.size() == (hit ? 1 : 0), "first-only collision returned the wrong number of pairs");
+			if (hit) {
+				const std::set<std::tuple<UINT, UINT, UINT, UINT>> keys = collisionKeys(referencePairs);
+				MLIB_ASSERT_STR(keys.count(*collisionKeys(pairs).begin()) == 1, "first-only collision returned a wrong pair");
+			}
+			MLIB_ASSERT_STR(!hit || smallBVH.collisionBBoxOnly(smallBVH, transform), "box-only collision missed a collision");
+		}
+
+		//range queries with boxes, oriented boxes, spheres and camera frustums of all sizes
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+		TriMeshAcceleratorBVHf sceneBVH(options);
+		sceneBVH.build(meshes);
+		size_t found = 0;
+		for (unsigned int i = 0; i < 40; i++) {
+			const vec3f center(rng.uniform(-9.0f, 9.0f), rng.uniform(-9.0f, 9.0f), rng.uniform(-1.0f, 5.0f));
+			const float size = i < 10 ? rng.uniform(0.05f, 0.5f) : (i < 30 ? rng.uniform(0.5f, 4.0f) : rng.uniform(4.0f, 25.0f));
+			const vec3f extent(rng.uniform(0.2f, 1.0f) * size, rng.uniform(0.2f, 1.0f) * size, rng.uniform(0.2f, 1.0f) * size);
+			found += checkRangeQuery(sceneBVH, scene, BoundingBox3f(center - extent, center + extent));
+			found += checkRangeQuery(sceneBVH, scene, Spheref(center, size));
+
+			const vec3f axis = vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)) + vec3f(0.0f, 0.0f, 0.1f);
+			const mat4f rotation = mat4f::rotation(axis.getNormalized(), rng.uniform(0.0f, 360.0f));
+			const vec3f xAxis = rotation.transformNormalAffine(vec3f::eX) * 2.0f * extent.x;
+			const vec3f yAxis = rotation.transformNormalAffine(vec3f::eY) * 2.0f * extent.y;
+			const vec3f zAxis = rotation.transformNormalAffine(vec3f::eZ) * 2.0f * extent.z;
+			found += checkRangeQuery(sceneBVH, scene, OrientedBoundingBox3f(center - 0.5f * (xAxis + yAxis + zAxis), xAxis, yAxis, zAxis));
+
+			const vec3f look = vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-0.3f, 0.3f)) + vec3f(0.1f, 0.0f, 0.0f);
+			const vec3f up = (look ^ vec3f(look.y, -look.x, 0.0f)).getNormalized();
+			const Cameraf camera(center, look.getNormalized(), up, rng.uniform(20.0f, 90.0f), rng.uniform(0.5f, 2.0f), 0.05f * size, size);
+			const Frustumf frustum(camera.getViewProj());
+			MLIB_ASSERT_STR(frustum.intersects(center + look.getNormalized() * 0.5f * size), "frustum does not contain its view direction");
+			for (unsigned int c = 0; c < 8; c++) {
+				for (unsigned int p = 0; p < 6; p++) {
+					MLIB_ASSERT_STR(frustum.getPlane(p).distanceToPoint(frustum.getCorner(c)) > -1e-3f * size, "frustum corner outside its planes");
+				}
+			}
+			found += checkRangeQuery(sceneBVH, scene, frustum);
+
+			//every triangle with a corner in view is reported
+			const std::vector<const TriMeshf::Triangle*> inView = sceneBVH.findOverlapping(frustum);
+			std::set<const TriMeshf::Triangle*> inViewSet(inView.begin(), inView.end());
+			for (const TriMeshf::Triangle* tri : sceneBVH.findOverlapping(BoundingBox3f(vec3f(-20.0f, -20.0f, -20.0f), vec3f(20.0f, 20.0f, 20.0f)))) {
+				if (frustum.intersects(tri->getV0().position) || frustum.intersects(tri->getV1().position) || frustum.intersects(tri->getV2().position)) {
+					MLIB_ASSERT_STR(inViewSet.count(tri) == 1, "frustum query missed a triangle in view");
+				}
+			}
+		}
+		MLIB_ASSERT_STR(found > 0, "range queries found nothing");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test3()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshAcceleratorBruteForcef reference;
+		reference.build(meshes);
+		const std::vector<Rayf> rays = makeRays(1000);
+
+		for (TriMeshBVHBuildStrategy strategy : { TriMeshBVHBuildMedian, TriMeshBVHBuildMidPoint, TriMeshBVHBuildSAH }) {
+			size_t lastNodeCount = std::numeric_limits<size_t>::max();
+			for (size_t maxLeafSize : { 1, 4, 8 }) {
+				TriMeshBVHBuildOptions options;
+				options.strategy = strategy;
+				options.maxLeafSize = maxLeafSize;
+				TriMeshAcceleratorBVHf bvh(options);
+				bvh.build(meshes);
+
+				size_t leafTriangles = 0;
+				for (const auto& node : bvh.getNodes()) {
+					if (!node.isLeaf()) continue;
+					MLIB_ASSERT_STR(node.count <= maxLeafSize, "BVH leaf exceeds the maximum leaf size");
+					MLIB_ASSERT_STR(node.offset == leafTriangles, "BVH leaves not in triangle order");
+					leafTriangles += node.count;
+				}
+				MLIB_ASSERT_STR(leafTriangles == bvh.triangleCount(), "BVH leaves do not cover every triangle once");
+				MLIB_ASSERT_STR(bvh.getNodes().size() < lastNodeCount, "larger leaves did not reduce the node count");
+				lastNodeCount = bvh.getNodes().size();
+
+				checkAgainstBruteForce(bvh, reference, rays);
+			}
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	template <class Accelerator>
+	static double measureRaysPerSecond(const Accelerator& accelerator, const std::vector<Rayf>& rays)
+	{
+		Timer t;
+		size_t hits = 0;
+		for (const Rayf& ray : rays) {
+			if (accelerator.intersect(ray).isValid()) hits++;
+		}
+		return rays.size() / t.getElapsedTime();
+	}
+
+	//! the SIMD triangle tests must return exactly the results of the scalar test, which agrees with Moeller-Trumbore away from
+	//! edges; rays through the shared edges and the center of a closed fan must hit at least one of its triangles
+	static void checkTriangleBlocks()
+	{
+		typedef TriangleBlock<float, 8> Block;
+		RNG rng(99);
+		std::vector<Block, AlignedAllocator<Block, 32>> blocks(64);
+		std::vector<Trianglef> triangles(8 * blocks.size());
+		for (size_t i = 0; i < triangles.size(); i++) {
+			const vec3f center(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+			for (unsigned int c = 0; c < 3; c++) {
+				triangles[i].vertices[c] = center + vec3f(rng.uniform(-0.5f, 0.5f), rng.uniform(-0.5f, 0.5f), rng.uniform(-0.5f, 0.5f));
+			}
+			blocks[i / 8].set(i % 8, triangles[i].vertices[0], triangles[i].vertices[1], triangles[i].vertices[2]);
+		}
+		blocks[0].clear(3);
+		triangles[3] = Trianglef(vec3f::origin, vec3f::origin, vec3f::origin);
+
+		size_t tests = 0, differentFromMT = 0;
+		for (unsigned int r = 0; r < 500; r++) {
+			const vec3f origin(rng.uniform(-2.0f, 2.0f), rng.uniform(-2.0f, 2.0f), rng.uniform(-2.0f, 2.0f));
+			vec3f dir(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+			if (r % 50 == 0) dir = vec3f(0.0f, 0.0f, r % 100 == 0 ? 1.0f : -1.0f);
+			const Rayf ray(origin, dir);
+			const TriangleBlockRay<float> blockRay(ray);
+			for (bool onlyFrontFaces : { false, true }) {
+				for (size_t b = 0; b < blocks.size(); b++) {
+					const unsigned int slotMask = r % 4 == 0 ? (unsigned int)(rng.rand_int32() & 0xff) : 0xff;
+					float t[8], u[8], v[8];
+					const unsigned int mask = TriangleBlockTest<float, 8>::intersect(blocks[b], slotMask, blockRay, 0.0f, 10.0f, onlyFrontFaces, t, u, v);
+					MLIB_ASSERT_STR((mask & ~slotMask) == 0, "triangle block hit a masked slot");
+#ifdef MLIB_SIMD_X86
+					float tSSE[8], uSSE[8], vSSE[8];
+					const unsigned int maskSSE = intersectTriangleBlockSSE(blocks[b], 0, slotMask & 0x0f, blockRay, 0.0f, 10.0f, onlyFrontFaces, tSSE, uSSE, vSSE) |
+						(intersectTriangleBlockSSE(blocks[b], 4, slotMask >> 4, blockRay, 0.0f, 10.0f, onlyFrontFaces, tSSE + 4, uSSE + 4, vSSE + 4) << 4);
+					MLIB_ASSERT_STR(mask == maskSSE, "SSE triangle block test differs");
+#endif
+					for (unsigned int i = 0; i < 8; i++) {
+						if (!(slotMask & (1u << i))) continue;
+						float ts, us, vs;
+						const bool hit = intersectTriangleBlockSlot(blocks[b], i, blockRay, 0.0f, 10.0f, onlyFrontFaces, ts, us, vs);
+						MLIB_ASSERT_STR(hit == ((mask & (1u << i)) != 0), "SIMD triangle block test differs from the scalar test");
+						if (!hit) continue;
+						MLIB_ASSERT_STR(t[i] == ts && u[i] == us && v[i] == vs, "SIMD triangle block test differs from the scalar test");
+#ifdef MLIB_SIMD_X86
+						MLIB_ASSERT_STR(tSSE[i] == ts && uSSE[i] == us && vSSE[i] == vs, "SSE triangle block test differs from the scalar test");
+#endif
+						const Trianglef& tri = triangles[8 * b + i];
+						MLIB_ASSERT_STR(dist(ray.getHitPoint(ts), tri.vertices[0] * (1.0f - us - vs) + tri.vertices[1] * us + tri.vertices[2] * vs) < 1e-4f, "barycentric coordinates do not match the hit distance");
+					}
+					for (unsigned int i = 0; i < 8; i++) {
+						if (!(slotMask & (1u << i))) continue;
+						const Trianglef& tri = triangles[8 * b + i];
+						float tMT, uMT, vMT;
+						tests++;
+						if (intersection::intersectRayTriangle(tri.vertices[0], tri.vertices[1], tri.vertices[2], ray, tMT, uMT, vMT, 0.0f, 10.0f, onlyFrontFaces) != ((mask & (1u << i)) != 0)) differentFromMT++;
+						else if (mask & (1u << i)) MLIB_ASSERT_STR(std::abs(tMT - t[i]) < 1e-4f, "triangle block hit distance differs from Moeller-Trumbore");
+					}
+				}
+			}
+		}
+		MLIB_ASSERT_STR(differentFromMT * 10000 < tests, "triangle block test disagrees with Moeller-Trumbore too often");
+
+		//a closed fan around a shared vertex: the rays aim at the vertex and at points of the shared edges
+		const unsigned int fanSize = 8;
+		const vec3f center(0.1f, -0.2f, 0.05f);
+		vec3f rim[fanSize];
+		for (unsigned int k = 0; k < fanSize; k++) {
+			const float angle = 2.0f * math::PIf * (float)k / (float)fanSize;
+			rim[k] = center + vec3f(std::cos(angle), std::sin(angle), rng.uniform(-0.2f, 0.2f));
+		}
+		std::vector<Block, AlignedAllocator<Block, 32>> fanBlocks(1);
+		for (unsigned int k = 0; k < fanSize; k++) fanBlocks[0].set(k, center, rim[k], rim[(k + 1) % fanSize]);
+		for (unsigned int r = 0; r < 20000; r++) {
+			const vec3f origin(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(1.0f, 3.0f) * (r % 2 == 0 ? 1.0f : -1.0f));
+			const unsigned int k = r % fanSize;
+			const vec3f target = r % 3 == 0 ? center : center + (rim[k] - center) * rng.uniform(0.0f, 1.0f);
+			const TriangleBlockRay<float> blockRay(Rayf(origin, target - origin));
+			float t[8], u[8], v[8];
+			const unsigned int mask = TriangleBlockTest<float, 8>::intersect(fanBlocks[0], 0xff, blockRay, 0.0f, 10.0f, false, t, u, v);
+			MLIB_ASSERT_STR(mask != 0, "ray slipped through a shared edge or vertex");
+		}
+		std::cout << "triangle blocks: " << TriangleBlockTest<float, 8>::getSIMDName() << ", " << differentFromMT << " of " << tests << " tests differ from Moeller-Trumbore" << std::endl;
+	}
+
+	void test4()
+	{
+		checkTriangleBlocks();
+
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshAcceleratorBruteForcef reference;
+		reference.build(meshes);
+		const std::vector<Rayf> rays = makeRays(2000);
+
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+
+		TriMeshAcceleratorBVHf binary(options);
+		binary.build(meshes);
+		TriMeshAcceleratorBVH4f bvh4(options);
+		bvh4.build(meshes);
+		TriMeshAcceleratorBVH8f bvh8(options);
+		bvh8.build(meshes);
+		bvh4.printInfo();
+		bvh8.printInfo();
+
+		//both the SIMD and the scalar box tests must find the closest hits
+		for (bool simd : { true, false }) {
+			bvh4.setSIMDEnabled(simd);
+			bvh8.setSIMDEnabled(simd);
+			checkAgainstBruteForce(bvh4, reference, rays);
+			checkAgainstBruteForce(bvh8, reference, rays);
+		}
+		bvh4.setSIMDEnabled(true);
+		bvh8.setSIMDEnabled(true);
+
+		const std::vector<Rayf> timingRays = makeRays(200000);
+		std::cout << "Mrays/s: BVH2 " << measureRaysPerSecond(binary, timingRays) / 1e6
+			<< ", BVH4 " << measureRaysPerSecond(bvh4, timingRays) / 1e6
+			<< ", BVH8 " << measureRaysPerSecond(bvh8, timingRays) / 1e6 << std::endl;
+
+		//the quantized boxes contain the exact ones, so the compressed trees find exactly the hits of the binary tree
+		TriMeshAcceleratorBVHCompressed8f compressed8(options);
+		compressed8.build(meshes);
+		TriMeshAcceleratorBVHCompressed16f compressed16(options);
+		compressed16.build(meshes);
+		compressed8.releaseBinaryTree();
+		MLIB_ASSERT_STR(compressed8.getNodes().empty() && !compressed16.getNodes().empty(), "binary tree not released");
+		std::vector<float> lengths(rays.size());
+		for (size_t i = 0; i < rays.size(); i++) lengths[i] = (float)(i % 8);
+		for (const TriMeshAcceleratorBVHf* compressed : { (const TriMeshAcceleratorBVHf*)&compressed8, (const TriMeshAcceleratorBVHf*)&compressed16 }) {
+			for (const Rayf& ray : rays) {
+				const TriMeshAcceleratorBVHf::Intersection a = compressed->intersect(ray), b = binary.intersect(ray);
+				MLIB_ASSERT_STR(a.isValid() == b.isValid(), "compressed BVH hit/miss differs from the binary tree");
+				if (!a.isValid()) continue;
+				MLIB_ASSERT_STR(a.getMeshIndex() == b.getMeshIndex() && a.getTriangleIndex() == b.getTriangleIndex() && a.t == b.t && a.u == b.u && a.v == b.v, "compressed BVH hit differs from the binary tree");
+			}
+			checkOccluded(*compressed, reference, rays, lengths);
+		}
+
+		const size_t triangleCount = binary.triangleCount();
+		std::cout << "bytes per triangle: BVH2 " << (double)(binary.getNodes().size() * sizeof(TriMeshAcceleratorBVHf::Node)) / triangleCount
+			<< ", 16 bit " << (double)compressed16.getQuantizedSize() / triangleCount
+			<< ", 8 bit " << (double)compressed8.getQuantizedSize() / triangleCount << std::endl;
+		std::cout << "Mrays/s: BVH2 " << measureRaysPerSecond(binary, timingRays) / 1e6
+			<< ", 16 bit " << measureRaysPerSecond(compressed16, timingRays) / 1e6
+			<< ", 8 bit " << measureRaysPerSecond(compressed8, timingRays) / 1e6 << std::endl;
+
+		//a root that is a leaf has no compressed node
+		const TriMeshf rectangle = Shapesf::rectangleZ(vec2f(-1.0f, -1.0f), vec2f(1.0f, 1.0f), 0.0f);
+		TriMeshAcceleratorBVHCompressed8f small(rectangle, options);
+		MLIB_ASSERT_STR(small.getQuantizedNodes().empty() && small.intersect(Rayf(vec3f(0.2f, 0.1f, 1.0f), vec3f(0.0f, 0.0f, -1.0f))).isValid(), "missed the single leaf");
+
+		//double precision always takes the scalar path
+		std::vector<TriMeshd> sceneD;
+		std::vector<const TriMeshd*> meshesD;
+		sceneD.push_back(Shapesd::torus(vec3d(0.0, 0.0, 0.0), 2.0, 0.5, 40, 20));
+		meshesD.push_back(&sceneD[0]);
+		TriMeshAcceleratorBVH4d bvh4d(options);
+		bvh4d.build(meshesD);
+		TriMeshAcceleratorBruteForced referenceD;
+		referenceD.build(meshesD);
+		for (const Rayf& ray : rays) {
+			const Rayd rayD(vec3d(ray.getOrigin()), vec3d(ray.getDirection()));
+			const TriMeshAcceleratorBruteForced::Intersection a = bvh4d.intersect(rayD), b = referenceD.intersect(rayD);
+			MLIB_ASSERT_STR(a.isValid() == b.isValid() && (!a.isValid() || std::abs(a.t - b.t) < 1e-9), "double BVH4 differs from brute force");
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	//! rays through the pixels of a pinhole camera looking at the scene
+	static std::vector<Rayf> makeCameraRays(unsigned int width, unsigned int height)
+	{
+		std::vector<Rayf> rays(width * height);
+		const vec3f eye(0.0f, -8.0f, 2.0f);
+		for (unsigned int y = 0; y < height; y++) {
+			for (unsigned int x = 0; x < width; x++) {
+				const vec3f dir((x + 0.5f) / width - 0.5f, 1.0f, 0.5f - (y + 0.5f) / height);
+				rays[y * width + x] = Rayf(eye, dir.getNormalized());
+			}
+		}
+		return rays;
+	}
+
+	static void checkBatch(const TriMeshRayAcceleratorf& accelerator, const std::vector<Rayf>& rays)
+	{
+		std::vector<TriMeshRayAcceleratorf::Intersection> batch(rays.size());
+		accelerator.intersect(rays.data(), rays.size(), batch.data());
+		for (size_t i = 0; i < rays.size(); i++) {
+			const TriMeshRayAcceleratorf::Intersection single = accelerator.intersect(rays[i]);
+			MLIB_ASSERT_STR(batch[i].triangle == single.triangle, "batched intersection differs from single-ray intersection");
+			MLIB_ASSERT_STR(!single.isValid() || (batch[i].t == single.t && batch[i].u == single.u && batch[i].v == single.v), "batched hit differs from single-ray hit");
+		}
+	}
+
+	void test5()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		std::vector<Rayf> rays = makeRays(5000);
+		const std::vector<Rayf> cameraRays = makeCameraRays(64, 48);
+		rays.insert(rays.end(), cameraRays.begin(), cameraRays.end());
+
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+		TriMeshAcceleratorBVHf bvh(options);
+		bvh.build(meshes);
+		checkBatch(bvh, rays);
+
+		TriMeshAcceleratorBVHf median;
+		median.build(meshes);
+		checkBatch(median, rays);
+
+		TriMeshAcceleratorBVH8f bvh8(options);
+		bvh8.build(meshes);
+		checkBatch(bvh8, rays);
+
+		TriMeshAcceleratorBruteForcef bruteForce;
+		bruteForce.build(meshes);
+		checkBatch(bruteForce, std::vector<Rayf>(rays.begin(), rays.begin() + 200));
+
+		//an empty batch is allowed
+		bvh.intersect(rays.data(), 0, nullptr);
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	//! occluded must agree with the closest hit on the same segment, and with the brute force reference
+	static void checkOccluded(const TriMeshRayAcceleratorf& accelerator, const TriMeshAcceleratorBruteForcef& reference, const std::vector<Rayf>& rays, const std::vector<float>& lengths)
+	{
+		for (size_t i = 0; i < rays.size(); i++) {
+			for (int frontFaces = 0; frontFaces < 2; frontFaces++) {
+				const bool occluded = accelerator.occluded(rays[i], 0.0f, lengths[i], frontFaces != 0);
+				MLIB_ASSERT_STR(occluded == accelerator.intersect(rays[i], 0.0f, lengths[i], frontFaces != 0).isValid(), "occluded differs from the closest hit");
+				MLIB_ASSERT_STR(occluded == reference.occluded(rays[i], 0.0f, lengths[i], frontFaces != 0), "occluded differs from brute force");
+			}
+		}
+	}
+
+	//! closest points must be as near as a loop over all triangles, lie on the triangle they report, and the batch must match single queries
+	static void checkClosestPoints(const TriMeshAcceleratorBVHf& bvh, const std::vector<TriMeshf>& scene, const std::vector<vec3f>& points, float maxDist)
+	{
+		std::vector<TriMeshAcceleratorBVHf::ClosestPoint> batch;
+		bvh.closestPoint(points, batch, maxDist);
+		for (size_t i = 0; i < points.size(); i++) {
+			float reference = std::numeric_limits<float>::max();
+			for (const TriMeshf& mesh : scene) {
+				for (const vec3ui& t : mesh.getIndices()) {
+					float u, v;
+					const vec3f q = closestPointOnTriangle(points[i], mesh.getVertices()[t.x].position, mesh.getVertices()[t.y].position, mesh.getVertices()[t.z].position, u, v);
+					reference = std::min(reference, std::sqrt(distSq(points[i], q)));
+				}
+			}
+
+			const TriMeshAcceleratorBVHf::ClosestPoint c = bvh.closestPoint(points[i], maxDist);
+			MLIB_ASSERT_STR(c.isValid() == (reference <= maxDist), "closest point found/missed differs from the loop over all triangles");
+			MLIB_ASSERT_STR(batch[i].triangle == c.triangle && batch[i].t == c.t && batch[i].u == c.u && batch[i].v == c.v, "batched closest point differs from the single query");
+			if (!c.isValid()) continue;
+			MLIB_ASSERT_STR(c.getDistance() == reference, "closest point distance differs from the loop over all triangles");
+			MLIB_ASSERT_STR(std::abs(dist(c.getSurfacePosition(), points[i]) - c.getDistance()) <= 1e-4f * std::max(1.0f, c.getDistance()), "barycentrics do not match the distance");
+		}
+	}
+
+	void test6()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		const std::vector<Rayf> rays = makeRays(1000);
+		std::vector<float> lengths(rays.size());
+		RNG rng(42);
+		for (float& length : lengths) length = rng.uniform(0.0f, 8.0f);
+
+		TriMeshAcceleratorBruteForcef bruteForce;
+		bruteForce.build(meshes);
+
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+		TriMeshAcceleratorBVHf bvh(options);
+		bvh.build(meshes);
+		checkOccluded(bvh, bruteForce, rays, lengths);
+		checkAgainstBruteForce(bvh, bruteForce, rays);
+
+		TriMeshAcceleratorBVHf median;
+		median.build(meshes);
+		checkOccluded(median, bruteForce, rays, lengths);
+		checkAgainstBruteForce(median, bruteForce, rays);
+
+		TriMeshAcceleratorBVH4f bvh4(options);
+		bvh4.build(meshes);
+		checkOccluded(bvh4, bruteForce, rays, lengths);
+		bvh4.setSIMDEnabled(false);
+		checkOccluded(bvh4, bruteForce, rays, lengths);
+
+		TriMeshAcceleratorBVH8f bvh8(options);
+		bvh8.build(meshes);
+		checkOccluded(bvh8, bruteForce, rays, lengths);
+
+		//points around and inside the scene, with and without a search radius
+		std::vector<vec3f> points(2000);
+		for (vec3f& p : points) p = vec3f(rng.uniform(-12.0f, 12.0f), rng.uniform(-12.0f, 12.0f), rng.uniform(-4.0f, 8.0f));
+		checkClosestPoints(bvh, scene, points, std::numeric_limits<float>::max());
+		checkClosestPoints(bvh, scene, points, 0.5f);
+		checkClosestPoints(median, scene, points, 1.0f);
+		checkClosestPoints(bvh4, scene, points, std::numeric_limits<float>::max());
+		MLIB_ASSERT_STR(!bvh.closestPoint(vec3f(0.0f, 0.0f, 2.0f), 0.0f).isValid(), "found a point beyond the search radius");
+
+		//coherent queries: samples just off the surface of the sphere
+		std::vector<vec3f> samples;
+		for (const auto& v : scene[1].getVertices()) samples.push_back(v.position + 0.01f * v.normal);
+		for (unsigned int i = 0; i < 6; i++) samples.insert(samples.end(), samples.begin(), samples.end());
+		std::vector<TriMeshAcceleratorBVHf::ClosestPoint> closest;
+		Timer timer;
+		bvh.closestPoint(samples, closest);
+		const double batchTime = timer.getElapsedTimeMS();
+		timer.start();
+		for (size_t i = 0; i < samples.size(); i++) closest[i] = bvh.closestPoint(samples[i]);
+		std::cout << samples.size() << " closest points: batch " << batchTime << " ms, single queries " << timer.getElapsedTimeMS() << " ms" << std::endl;
+
+		//a rectangle in one leaf: the root is a leaf
+		const TriMeshf rectangle = Shapesf::rectangleZ(vec2f(-1.0f, -1.0f), vec2f(1.0f, 1.0f), 0.0f);
+		TriMeshBVHBuildOptions leafOptions;
+		leafOptions.maxLeafSize = 4;
+		TriMeshAcceleratorBVHf small(rectangle, leafOptions);
+		MLIB_ASSERT_STR(small.getNodes().size() == 1, "expected a single leaf");
+		const Rayf down(vec3f(0.2f, 0.1f, 1.0f), vec3f(0.0f, 0.0f, -1.0f));
+		MLIB_ASSERT_STR(small.occluded(down, 0.0f, 2.0f) && !small.occluded(down, 0.0f, 0.5f), "occluded ignores the segment");
+		MLIB_ASSERT_STR(small.intersect(down).isValid(), "missed the triangle below the ray");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	//! moves the vertices along their normals by a wave of the given amplitude
+	static void deform(TriMeshf& mesh, const TriMeshf& original, float amplitude)
+	{
+		for (size_t i = 0; i < mesh.getVertices().size(); i++) {
+			const TriMeshf::Vertex& v = original.getVertices()[i];
+			mesh.getVertices()[i].position = v.position + v.normal * (amplitude * std::sin(3.0f * v.position.x + 2.0f * v.position.z));
+		}
+	}
+
+	void test7()
+	{
+		const std::vector<Rayf> rays = makeRays(2000);
+		const TriMeshf original = Shapesf::torus(vec3f(0.5f, -1.0f, 1.0f), 3.0f, 1.0f, 80, 40);
+		TriMeshf mesh = original;
+
+		//without a local copy the accelerators see the vertices move
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+		options.parallelSubtreeSize = 64;
+		TriMeshAcceleratorBVHf bvh(mesh, options);
+		TriMeshBVHBuildOptions serialOptions = options;
+		serialOptions.parallelSubtreeSize = 0;
+		TriMeshAcceleratorBVHf serial(mesh, serialOptions);
+		TriMeshAcceleratorBruteForcef bruteForce;
+		bruteForce.build(mesh);
+
+		deform(mesh, original, 0.3f);
+		MLIB_ASSERT_STR(!bvh.refit() && !serial.refit(), "refit without a threshold must not rebuild");
+		checkAgainstBruteForce(bvh, bruteForce, rays);
+		MLIB_ASSERT_STR(bvh.getNodes().size() == serial.getNodes().size(), "refit changed the topology");
+		for (size_t i = 0; i < bvh.getNodes().size(); i++) {
+			MLIB_ASSERT_STR(bvh.getNodes()[i].boundingBox.getMin() == serial.getNodes()[i].boundingBox.getMin() &&
+				bvh.getNodes()[i].boundingBox.getMax() == serial.getNodes()[i].boundingBox.getMax(), "parallel refit differs from serial refit");
+		}
+		MLIB_ASSERT_STR(bvh.getNodes()[0].boundingBox.getMin() == mesh.computeBoundingBox().getMin() &&
+			bvh.getNodes()[0].boundingBox.getMax() == mesh.computeBoundingBox().getMax(), "root does not bound the deformed mesh");
+
+		//a mild deformation stays under the threshold, scrambled vertices exceed it and rebuild
+		deform(mesh, original, 0.05f);
+		MLIB_ASSERT_STR(!bvh.refit(2.0f), "mild deformation triggered a rebuild");
+		checkAgainstBruteForce(bvh, bruteForce, rays);
+		RNG rng(7);
+		for (TriMeshf::Vertex& v : mesh.getVertices()) v.position = vec3f(rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f), rng.uniform(-1.0f, 3.0f));
+		bvh.refit();
+		const float refitCost = bvh.getSAHCost();
+		MLIB_ASSERT_STR(bvh.refit(2.0f), "scrambled vertices did not trigger a rebuild");
+		MLIB_ASSERT_STR(bvh.getSAHCost() < refitCost && bvh.getSAHCost() == bvh.getBuildSAHCost(), "rebuild did not restore the tree quality");
+		checkAgainstBruteForce(bvh, bruteForce, rays);
+
+		//a local copy is updated explicitly; the wide BVH collapses the refit tree again
+		deform(mesh, original, 0.0f);
+		TriMeshAcceleratorBVH4f bvh4(options);
+		bvh4.build(mesh, true);
+		deform(mesh, original, 0.3f);
+		bvh4.updateVertices(mesh);
+		bvh4.refit();
+		checkAgainstBruteForce(bvh4, bruteForce, rays);
+
+		TriMeshf other = Shapesf::box(1.0f);
+		bool threw = false;
+		try {
+			bvh4.updateVertices(other);
+		}
+		catch (const MLibException&) {
+			threw = true;
+		}
+		MLIB_ASSERT_STR(threw, "updateVertices accepted a mesh with a different vertex count");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	//! (mesh, triangle) index pairs of both triangles, which do not depend on the order the pairs were found in
+	template <class TrianglePair>
+	static std::set<std::tuple<UINT, UINT, UINT, UINT>> collisionKeys(const std::vector<TrianglePair>& pairs)
+	{
+		std::set<std::tuple<UINT, UINT, UINT, UINT>> keys;
+		for (const TrianglePair& p : pairs) {
+			keys.insert(std::make_tuple(p.first->getMeshIndex(), p.first->getIndex(), p.second->getMeshIndex(), p.second->getIndex()));
+		}
+		MLIB_ASSERT_STR(keys.size() == pairs.size(), "triangle pair reported twice");
+		return keys;
+	}
+
+	static mat4f randomTransform(RNG& rng)
+	{
+		const vec3f axis = vec3f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)) + vec3f(0.0f, 0.0f, 0.1f);
+		const vec3f scale(rng.uniform(0.5f, 2.0f), rng.uniform(0.5f, 2.0f), rng.uniform(0.5f, 2.0f));
+		const vec3f translation(rng.uniform(-15.0f, 15.0f), rng.uniform(-15.0f, 15.0f), rng.uniform(-3.0f, 3.0f));
+		return mat4f::translation(translation) * mat4f::rotation(axis.getNormalized(), rng.uniform(0.0f, 360.0f)) * mat4f::scale(scale);
+	}
+
+	//! the instanced accelerator must match a brute force over world-space copies of all instances
+	static void checkInstanced(const TriMeshAcceleratorInstancedf& instanced, const std::vector<std::pair<const TriMeshf*, mat4f>>& world, const std::vector<Rayf>& rays)
+	{
+		TriMeshAcceleratorBruteForcef reference;
+		reference.build(world);
+		for (size_t i = 0; i < rays.size(); i++) {
+			const TriMeshAcceleratorInstancedf::Intersection a = instanced.intersect(rays[i]);
+			const TriMeshRayAcceleratorf::Intersection b = reference.intersect(rays[i]);
+			MLIB_ASSERT_STR(a.isValid() == b.isValid(), "instanced hit/miss differs from brute force");
+			if (a.isValid()) {
+				MLIB_ASSERT_STR(std::abs(a.t - b.t) <= 1e-4f * std::max(1.0f, b.t), "instanced hit distance differs from brute force");
+				MLIB_ASSERT_STR(a.instance == b.getMeshIndex() && a.getTriangleIndex() == b.getTriangleIndex(), "instanced hit a different triangle");
+				MLIB_ASSERT_STR(dist(rays[i].getHitPoint(a.t), world[a.instance].second * a.getSurfacePosition()) <= 1e-3f * std::max(1.0f, a.t), "object-space hit does not map to the world-space hit");
+			}
+			const float length = (float)(i % 10) * 3.0f;
+			MLIB_ASSERT_STR(instanced.occluded(rays[i], 0.0f, length) == reference.occluded(rays[i], 0.0f, length), "instanced occluded differs from brute force");
+		}
+	}
+
+	void test8()
+	{
+		const TriMeshf sphere = Shapesf::sphere(1.0f, vec3f(0.0f, 0.0f, 0.0f), 20, 20);
+		const TriMeshf torus = Shapesf::torus(vec3f(0.0f, 0.0f, 0.0f), 1.0f, 0.3f, 30, 15);
+		const TriMeshf box = Shapesf::box(1.0f);
+
+		//the object accelerators can be of any kind
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+		TriMeshAcceleratorBVHf sphereBVH(sphere, options);
+		TriMeshAcceleratorBVH4f torusBVH(options);
+		torusBVH.build(torus);
+		TriMeshAcceleratorBruteForcef boxAccelerator;
+		boxAccelerator.build(box);
+		const TriMeshf* meshes[] = { &sphere, &torus, &box };
+		const TriMeshRayAcceleratorf* accelerators[] = { &sphereBVH, &torusBVH, &boxAccelerator };
+
+		RNG rng(99);
+		TriMeshAcceleratorInstancedf instanced;
+		std::vector<std::pair<const TriMeshf*, mat4f>> world;
+		for (UINT i = 0; i < 200; i++) {
+			const mat4f transform = randomTransform(rng);
+			MLIB_ASSERT_STR(instanced.addInstance(accelerators[i % 3], transform) == i, "unexpected instance index");
+			world.push_back(std::make_pair(meshes[i % 3], transform));
+		}
+		instanced.build();
+
+		std::vector<Rayf> rays(1000);
+		for (Rayf& ray : rays) {
+			const vec3f origin(rng.uniform(-18.0f, 18.0f), rng.uniform(-18.0f, 18.0f), rng.uniform(-4.0f, 4.0f));
+			const vec3f target(rng.uniform(-15.0f, 15.0f), rng.uniform(-15.0f, 15.0f), rng.uniform(-3.0f, 3.0f));
+			ray = Rayf(origin, target - origin + vec3f(0.0f, 0.0f, 1e-3f));
+		}
+		checkInstanced(instanced, world, rays);
+
+		//moving instances only updates the top level, by refit or rebuild
+		for (UINT i = 0; i < 200; i += 4) {
+			world[i].second = randomTransform(rng);
+			instanced.setTransform(i, world[i].second);
+		}
+		instanced.refit();
+		checkInstanced(instanced, world, rays);
+		instanced.build();
+		checkInstanced(instanced, world, rays);
+
+		TriMeshAcceleratorInstancedf empty;
+		empty.build();
+		MLIB_ASSERT_STR(!empty.intersect(rays[0]).isValid() && !empty.occluded(rays[0]), "empty scene reported a hit");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test9()
+	{
+		const std::vector<TriMeshf> scene = makeScene();
+		std::vector<const TriMeshf*> meshes;
+		for (const TriMeshf& mesh : scene) meshes.push_back(&mesh);
+
+		TriMeshAcceleratorBruteForcef reference;
+		reference.build(meshes);
+		const std::vector<Rayf> rays = makeRays(2000);
+
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildLBVH;
+		for (unsigned int bits : { 30, 63 }) {
+			for (size_t leafSize : { 1, 4 }) {
+				options.mortonCodeBits = bits;
+				options.maxLeafSize = leafSize;
+				options.treeletSize = 0;
+				Timer t;
+				TriMeshAcceleratorBVHf lbvh(options);
+				lbvh.build(meshes);
+				const double plainMS = t.getElapsedTimeMS();
+				checkAgainstBruteForce(lbvh, reference, rays);
+
+				options.treeletSize = 7;
+				t.start();
+				TriMeshAcceleratorBVHf optimized(options);
+				optimized.build(meshes);
+				const double optimizedMS = t.getElapsedTimeMS();
+				checkAgainstBruteForce(optimized, reference, rays);
+				std::cout << "LBVH " << bits << " bits, leaf size " << leafSize << ": build " << plainMS << " ms, SAH cost " << lbvh.getSAHCost()
+					<< "; with treelets " << optimizedMS << " ms, SAH cost " << optimized.getSAHCost() << std::endl;
+				MLIB_ASSERT_STR(optimized.getSAHCost() <= lbvh.getSAHCost() * 1.0001f, "treelet optimization increased the SAH cost");
+				MLIB_ASSERT_STR(optimized.triangleCount() == reference.triangleCount(), "LBVH lost triangles");
+			}
+		}
+
+		//many triangles with the same center: the codes tie, and the positions must still split them
+		TriMeshf stacked = Shapesf::box(1.0f);
+		std::vector<TriMeshf> copies(20, stacked);
+		std::vector<const TriMeshf*> copyPointers;
+		for (const TriMeshf& mesh : copies) copyPointers.push_back(&mesh);
+		TriMeshAcceleratorBruteForcef stackedReference;
+		stackedReference.build(copyPointers);
+		options.maxLeafSize = 1;
+		options.treeletSize = 5;
+		TriMeshAcceleratorBVHf stackedBVH(options);
+		stackedBVH.build(copyPointers);
+		MLIB_ASSERT_STR(stackedBVH.getNodes().size() == 2 * stackedBVH.triangleCount() - 1, "unexpected LBVH node count");
+		checkAgainstBruteForce(stackedBVH, stackedReference, makeRays(200));
+
+		//a single triangle is a leaf
+		const TriMeshf triangle(std::vector<vec3f>{ vec3f(0.0f, 0.0f, 0.0f), vec3f(1.0f, 0.0f, 0.0f), vec3f(0.0f, 1.0f, 0.0f) }, std::vector<unsigned int>{ 0, 1, 2 });
+		TriMeshAcceleratorBVHf single(options);
+		single.build(triangle);
+		MLIB_ASSERT_STR(single.getNodes().size() == 1 && single.intersect(Rayf(vec3f(0.2f, 0.2f, 1.0f), vec3f(0.0f, 0.0f, -1.0f))).isValid(), "single-triangle LBVH broken");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "BVH";
+	}
+};
@@ -139,6 +139,56 @@ class TestBinaryStream : public Test {
 		std::cout << __FUNCTION__ << " passed" << std::endl;
 	}
 
+	void test4()
+	{
+		//saved BVHs must answer queries like the built ones, whether mapped from a file or read from a stream
+		TriMeshf sphere = Shapesf::sphere(1.0f, vec3f(0.5f, 0.0f, 0.0f), 40, 40);
+		const TriMeshf torus = Shapesf::torus(vec3f(0.0f, 0.0f, 0.0f), 2.0f, 0.5f, 60, 30);
+		std::vector<const TriMeshf*> meshes;
+		meshes.push_back(&sphere);
+		meshes.push_back(&torus);
+
+		TriMeshBVHBuildOptions options;
+		options.strategy = TriMeshBVHBuildSAH;
+		options.maxLeafSize = 4;
+		TriMeshAcceleratorBVHf built(options);
+		built.build(meshes);
+		built.save("tmpBVH.bin");
+
+		TriMeshAcceleratorBVHf mapped;
+		MLIB_ASSERT_STR(mapped.load(meshes, "tmpBVH.bin") && mapped.getNodes().isMapped(), "saved BVH was not mapped");
+		BinaryDataStreamVector stream;
+		stream << built;
+		TriMeshAcceleratorBVH4f wide;
+		MLIB_ASSERT_STR(wide.load(meshes, stream), "saved BVH was not read from the stream");
+		MLIB_ASSERT_STR(mapped.getNodes().size() == built.getNodes().size() && mapped.getTreeDepth() == built.getTreeDepth() &&
+			mapped.getSAHCost() == built.getSAHCost() && mapped.getBuildSAHCost() == built.getBuildSAHCost(), "loaded BVH differs from the saved one");
+
+		RNG rng(7);
+		for (unsigned int i = 0; i < 2000; i++) {
+			const Rayf ray(vec3f(rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f), 3.0f), vec3f(rng.uniform(-0.5f, 0.5f), rng.uniform(-0.5f, 0.5f), -1.0f));
+			const TriMeshRayAcceleratorf::Intersection a = built.intersect(ray);
+			for (const TriMeshRayAcceleratorf* loaded : { (const TriMeshRayAcceleratorf*)&mapped, (const TriMeshRayAcceleratorf*)&wide }) {
+				const TriMeshRayAcceleratorf::Intersection b = loaded->intersect(ray);
+				MLIB_ASSERT_STR(a.isValid() == b.isValid() && (!a.isValid() || (a.t == b.t && a.getMeshIndex() == b.getMeshIndex() &&
+					a.getTriangleIndex() == b.getTriangleIndex())), "loaded BVH hit differs from the built one");
+			}
+		}
+
+		//refitting a mapped tree writes to private copies of its pages, never to the file
+		mapped.refit();
+		MLIB_ASSERT_STR(mapped.getSAHCost() == built.getSAHCost(), "refit of an unchanged mapped BVH changed it");
+
+		//a changed mesh makes the saved tree stale
+		sphere.getVertices()[0].position.x += 0.01f;
+		TriMeshAcceleratorBVHf stale;
+		MLIB_ASSERT_STR(!stale.load(meshes, "tmpBVH.bin") && stale.getNodes().empty(), "stale BVH was loaded");
+		MLIB_ASSERT_STR(!stale.load(meshes, "doesNotExist.bin"), "missing BVH file was loaded");
+		util::deleteFile("tmpBVH.bin");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
 	std::string getName()
 	{
 		return "Binary Stream";
@@ -0,0 +1,98 @@
+
+class TestBoundedTaskQueue : public Test
+{
+public:
+	void test0()
+	{
+		//single thread: FIFO order, capacity and full/empty behaviour
+		BoundedTaskQueue<int> queue(5);
+		MLIB_ASSERT_STR(queue.capacity() == 8, "capacity not rounded to a power of two");
+		MLIB_ASSERT_STR(queue.done(), "new queue not empty");
+
+		for (int i = 0; i < 8; i++) {
+			bool inserted = queue.tryInsert(i);
+			MLIB_ASSERT_STR(inserted, "insert into non-full queue failed");
+		}
+		bool inserted = queue.tryInsert(8);
+		MLIB_ASSERT_STR(!inserted, "insert into full queue succeeded");
+		MLIB_ASSERT_STR(queue.tasksLeft() == 8, "incorrect task count");
+
+		//wrap around the ring a few times
+		int task;
+		for (int i = 0; i < 100; i++) {
+			bool removed = queue.getNextTask(task);
+			MLIB_ASSERT_STR(removed && task == i, "queue not FIFO");
+			queue.insert(i + 8);
+		}
+		for (int i = 0; i < 8; i++) queue.getNextTask(task);
+		bool removed = queue.getNextTask(task);
+		MLIB_ASSERT_STR(!removed && queue.done(), "queue not drained");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		//producers and consumers on a small queue: every value must arrive exactly once
+		const UINT producerCount = 4, consumerCount = 4;
+		const UINT valuesPerProducer = 50000;
+		BoundedTaskQueue<UINT> queue(64);
+		std::vector<std::atomic<UINT>> received(producerCount * valuesPerProducer);
+		for (auto &r : received) r = 0;
+		std::atomic<UINT> receivedCount(0);
+
+		std::vector<std::thread> threads;
+		for (UINT producer = 0; producer < producerCount; producer++) {
+			threads.push_back(std::thread([&, producer]() {
+				for (UINT i = 0; i < valuesPerProducer; i++) queue.insert(producer * valuesPerProducer + i);
+			}));
+		}
+		for (UINT consumer = 0; consumer < consumerCount; consumer++) {
+			threads.push_back(std::thread([&]() {
+				while (receivedCount < received.size()) {
+					UINT value;
+					if (queue.getNextTask(value)) {
+						received[value]++;
+						receivedCount++;
+					}
+					else {
+						std::this_thread::yield();
+					}
+				}
+			}));
+		}
+		for (auto &t : threads) t.join();
+
+		for (size_t i = 0; i < received.size(); i++) {
+			MLIB_ASSERT_STR(received[i] == 1, "value lost or duplicated");
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test2()
+	{
+		//the queue can be handed to the thread pool in place of a TaskList; with two workers the worker queues overflow
+		ThreadPool pool;
+		pool.init(2);
+
+		std::vector<UINT64> results(3000, 0);
+		BoundedTaskQueue<WorkerThreadTask*> tasks(results.size());
+		for (size_t i = 0; i < results.size(); i++) {
+			tasks.insert(new TestThreadPoolTask(results, i));
+		}
+		pool.runTasks(tasks, false);
+
+		MLIB_ASSERT_STR(tasks.done(), "task queue not drained");
+		for (size_t i = 0; i < results.size(); i++) {
+			MLIB_ASSERT_STR(results[i] == (UINT64)i * (i + 1) / 2, "thread pool task result incorrect");
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "boundedTaskQueue";
+	}
+};
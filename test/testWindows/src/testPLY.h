@@ -0,0 +1,139 @@
+
+class TestPLY : public Test
+{
+public:
+	template<class T>
+	static void put(std::string& body, T value, bool bigEndian)
+	{
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		if (bigEndian) std::reverse(bytes, bytes + sizeof(T));
+		body.append(bytes, sizeof(T));
+	}
+
+	//! double positions, an extra int property, uchar colors, float normals; a triangle and a quad with ushort counts and uint
+	//! indices, framed by a scalar and a list face property the loader must skip
+	static void writeTestFile(const std::string& filename, bool bigEndian)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		file << "ply\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+			<< "element vertex 4\nproperty double x\nproperty double y\nproperty double z\nproperty int confidence\n"
+			<< "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty float nx\nproperty float ny\nproperty float nz\n"
+			<< "element face 2\nproperty uchar flags\nproperty list ushort uint vertex_indices\nproperty list uchar float texcoord\nend_header\n";
+
+		std::string body;
+		for (int i = 0; i < 4; i++) {
+			put<double>(body, i + 0.5, bigEndian);
+			put<double>(body, -i, bigEndian);
+			put<double>(body, 2 * i, bigEndian);
+			put<int>(body, 100 * i - 7, bigEndian);
+			body += (char)255;
+			body += (char)0;
+			body += (char)51;
+			put<float>(body, 0.0f, bigEndian);
+			put<float>(body, 1.0f, bigEndian);
+			put<float>(body, (float)i, bigEndian);
+		}
+		body += (char)1;
+		put<unsigned short>(body, 3, bigEndian);
+		for (unsigned int index : { 0, 1, 2 }) put<unsigned int>(body, index, bigEndian);
+		body += (char)2;
+		put<float>(body, 0.1f, bigEndian);
+		put<float>(body, 0.2f, bigEndian);
+		body += (char)0;
+		put<unsigned short>(body, 4, bigEndian);
+		for (unsigned int index : { 3, 2, 1, 0 }) put<unsigned int>(body, index, bigEndian);
+		body += (char)0;
+		file << body;
+	}
+
+	void test0()
+	{
+		const std::string filename = "testPLY.ply";
+		for (bool bigEndian : { false, true }) {
+			writeTestFile(filename, bigEndian);
+
+			PlyProperties properties;
+			MeshDataf mesh;
+			MeshIOf::loadFromPLY(filename, mesh, &properties);
+			MLIB_ASSERT_STR(mesh.m_Vertices.size() == 4 && mesh.m_Normals.size() == 4 && mesh.m_Colors.size() == 4, "wrong vertex count");
+			MLIB_ASSERT_STR(properties.count("confidence") == 1, "extra property missing");
+			for (int i = 0; i < 4; i++) {
+				MLIB_ASSERT_STR(mesh.m_Vertices[i] == vec3f(i + 0.5f, (float)-i, 2.0f * i), "wrong position");
+				MLIB_ASSERT_STR(mesh.m_Normals[i] == vec3f(0.0f, 1.0f, (float)i), "wrong normal");
+				MLIB_ASSERT_STR(mesh.m_Colors[i].x == 1.0f && mesh.m_Colors[i].y == 0.0f && std::abs(mesh.m_Colors[i].z - 0.2f) < 1e-6f, "wrong color");
+				int confidence;
+				memcpy(&confidence, &properties["confidence"].data[4 * i], sizeof(int));
+				MLIB_ASSERT_STR(confidence == 100 * i - 7, "wrong extra property");
+			}
+			MLIB_ASSERT_STR(mesh.m_FaceIndicesVertices.size() == 2, "wrong face count");
+			MLIB_ASSERT_STR(mesh.m_FaceIndicesVertices[0].size() == 3 && mesh.m_FaceIndicesVertices[0][2] == 2, "wrong triangle");
+			MLIB_ASSERT_STR(mesh.m_FaceIndicesVertices[1].size() == 4 && mesh.m_FaceIndicesVertices[1][0] == 3 && mesh.m_FaceIndicesVertices[1][3] == 0, "wrong quad");
+
+			PointCloudf pc = PointCloudIOf::loadFromFile(filename);
+			MLIB_ASSERT_STR(pc.m_points == mesh.m_Vertices && pc.m_normals == mesh.m_Normals, "point cloud differs from the mesh vertices");
+		}
+		util::deleteFile(filename);
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		//a mesh written by MeshIO must come back unchanged
+		const std::string filename = "testPLYSphere.ply";
+		const MeshDataf sphere = Shapesf::sphere(1.0f, vec3f(0.0f, 0.0f, 0.0f), 20, 20).computeMeshData();
+		MeshIOf::saveToPLY(filename, sphere);
+		const MeshDataf loaded = MeshIOf::loadFromFile(filename);
+		MLIB_ASSERT_STR(loaded.m_Vertices == sphere.m_Vertices, "vertices differ after a round trip");
+		MLIB_ASSERT_STR(loaded.m_FaceIndicesVertices.size() == sphere.m_FaceIndicesVertices.size(), "face count differs after a round trip");
+		for (size_t i = 0; i < loaded.m_FaceIndicesVertices.size(); i++) {
+			MLIB_ASSERT_STR(loaded.m_FaceIndicesVertices[i] == sphere.m_FaceIndicesVertices[i], "face differs after a round trip");
+		}
+		util::deleteFile(filename);
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test2()
+	{
+		//MeshIO writes float x, y, z first, so the mapped file gives them in place
+		const std::string filename = "testPLYView.ply";
+		const MeshDataf sphere = Shapesf::sphere(1.0f, vec3f(0.0f, 0.0f, 0.0f), 20, 20).computeMeshData();
+		MeshIOf::saveToPLY(filename, sphere);
+		{
+			PlyMappedFile file(filename);
+			PlyVertexView<float> view;
+			MLIB_ASSERT_STR(file.getVertexView(view) && view.size() == sphere.m_Vertices.size(), "no vertex view of a float ply file");
+			for (size_t i = 0; i < view.size(); i++) {
+				MLIB_ASSERT_STR(view[i] == sphere.m_Vertices[i], "vertex view differs from the saved vertices");
+			}
+			PlyVertexView<double> doubleView;
+			MLIB_ASSERT_STR(!file.getVertexView(doubleView), "vertex view of floats as doubles");
+		}
+
+		//double positions can be viewed as doubles only, and not at all in a big endian file
+		writeTestFile(filename, false);
+		{
+			PlyMappedFile file(filename);
+			PlyVertexView<double> view;
+			PlyVertexView<float> floatView;
+			MLIB_ASSERT_STR(file.getVertexView(view) && view[3] == vec3d(3.5, -3.0, 6.0) && view.getVertices() == nullptr, "wrong vertex view of a double ply file");
+			MLIB_ASSERT_STR(!file.getVertexView(floatView), "vertex view of doubles as floats");
+		}
+		writeTestFile(filename, true);
+		{
+			PlyMappedFile file(filename);
+			PlyVertexView<double> view;
+			MLIB_ASSERT_STR(!file.getVertexView(view), "vertex view of a big endian file");
+		}
+		util::deleteFile(filename);
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "PLY";
+	}
+};
@@ -0,0 +1,136 @@
+
+//! move-only callable: owns its input through a unique_ptr
+struct TestTaskFutureMoveOnly
+{
+	std::unique_ptr<std::vector<int>> values;
+
+	int operator()()
+	{
+		return std::accumulate(values->begin(), values->end(), 0);
+	}
+};
+
+//! as aligned as a TriangleBlock
+struct alignas(32) TestTaskFutureAligned
+{
+	float values[8];
+};
+
+class TestTaskFuture : public Test
+{
+public:
+	void test0()
+	{
+		ThreadPool pool;
+		pool.init(4);
+
+		std::vector< TaskFuture<UINT64> > futures;
+		for (UINT64 i = 0; i < 1000; i++) {
+			futures.push_back(pool.submit([i]() { return i * i; }));
+		}
+		for (UINT64 i = 0; i < futures.size(); i++) {
+			const UINT64 result = futures[i].get();
+			MLIB_ASSERT_STR(result == i * i, "future result incorrect");
+			MLIB_ASSERT_STR(!futures[i].valid(), "future still valid after get");
+		}
+
+		//move-only callables and results
+		TestTaskFutureMoveOnly moveOnly;
+		moveOnly.values = std::unique_ptr<std::vector<int>>(new std::vector<int>(100, 2));
+		TaskFuture<int> sum = pool.submit(std::move(moveOnly));
+		TaskFuture< std::unique_ptr<int> > pointer = pool.submit([]() { return std::unique_ptr<int>(new int(7)); });
+		const int sumResult = sum.get();
+		const std::unique_ptr<int> pointerResult = pointer.get();
+		MLIB_ASSERT_STR(sumResult == 200, "move-only callable result incorrect");
+		MLIB_ASSERT_STR(*pointerResult == 7, "move-only result incorrect");
+
+		//callables larger than a recycled block, and futures that are dropped without get
+		std::array<double, 64> large;
+		large.fill(0.5);
+		TaskFuture<double> largeSum = pool.submit([large]() { return std::accumulate(large.begin(), large.end(), 0.0); });
+		for (UINT i = 0; i < 100; i++) pool.submit([]() {});
+		const double largeResult = largeSum.get();
+		MLIB_ASSERT_STR(largeResult == 32.0, "large callable result incorrect");
+
+		//over-aligned results and captures are placed at their alignment
+		TestTaskFutureAligned aligned;
+		aligned.values[0] = 1.5f;
+		TaskFuture<TestTaskFutureAligned> alignedResult = pool.submit([aligned]() {
+			MLIB_ASSERT_STR(((size_t)&aligned & 31) == 0, "over-aligned capture misaligned");
+			return aligned;
+		});
+		const TestTaskFutureAligned alignedValue = alignedResult.get();
+		MLIB_ASSERT_STR(alignedValue.values[0] == 1.5f, "over-aligned result incorrect");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		ThreadPool pool;
+		pool.init(4);
+
+		//exceptions are rethrown by get
+		TaskFuture<int> failing = pool.submit([]() -> int { throw MLIB_EXCEPTION("expected"); });
+		bool thrown = false;
+		try {
+			failing.get();
+		}
+		catch (const MLibException &) {
+			thrown = true;
+		}
+		MLIB_ASSERT_STR(thrown, "task exception not propagated");
+
+		//tasks that wait for futures of their own pool help instead of blocking the worker
+		TaskFuture<UINT64> outer = pool.submit([&pool]() {
+			std::vector< TaskFuture<UINT64> > inner;
+			for (UINT64 i = 1; i <= 100; i++) inner.push_back(pool.submit([i]() { return i; }));
+			UINT64 sum = 0;
+			for (auto &f : inner) sum += f.get();
+			return sum;
+		});
+		const UINT64 outerResult = outer.get();
+		MLIB_ASSERT_STR(outerResult == 5050, "nested future result incorrect");
+
+		//whenAll
+		std::vector< TaskFuture<int> > futures;
+		for (int i = 0; i < 50; i++) futures.push_back(pool.submit([i]() { return i; }));
+		std::vector<int> results = whenAll(std::move(futures)).get();
+		MLIB_ASSERT_STR(results.size() == 50 && results[49] == 49, "whenAll result incorrect");
+
+		std::atomic<UINT> counter(0);
+		std::vector< TaskFuture<void> > voidFutures;
+		for (int i = 0; i < 50; i++) voidFutures.push_back(pool.submit([&counter]() { counter++; }));
+		whenAll(std::move(voidFutures)).get();
+		MLIB_ASSERT_STR(counter == 50, "whenAll returned too early");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test2()
+	{
+		//a pool without workers runs submitted tasks on the caller
+		ThreadPool pool;
+		pool.init(0);
+		TaskFuture<int> f = pool.submit([]() { return 3; });
+		MLIB_ASSERT_STR(f.ready(), "inline future not ready");
+		const int inlineResult = f.get();
+		MLIB_ASSERT_STR(inlineResult == 3, "inline future result incorrect");
+
+		//tasks still queued when the pool shuts down are run, so their futures are fulfilled
+		std::atomic<UINT> counter(0);
+		{
+			ThreadPool shortLived;
+			shortLived.init(1);
+			for (int i = 0; i < 100; i++) shortLived.submit([&counter]() { counter++; });
+		}
+		MLIB_ASSERT_STR(counter == 100, "queued tasks lost at shutdown");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "taskFuture";
+	}
+};
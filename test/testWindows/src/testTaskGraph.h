@@ -0,0 +1,97 @@
+
+class TestTaskGraph : public Test
+{
+public:
+	void test0()
+	{
+		ThreadPool pool;
+		pool.init(4);
+
+		//diamond: load -> (decompress, depth) -> integrate, run several times on the same graph
+		std::atomic<UINT> step(0);
+		UINT loadStep = 0, decompressStep = 0, depthStep = 0, integrateStep = 0;
+
+		TaskGraph graph;
+		TaskGraph::NodeID load = graph.addTask("load", [&]() { loadStep = step++; });
+		TaskGraph::NodeID decompress = graph.addTask("decompress", [&]() { decompressStep = step++; }, { load });
+		TaskGraph::NodeID depth = graph.addTask("depth", [&]() { depthStep = step++; }, { load });
+		graph.addTask("integrate", [&]() { integrateStep = step++; }, { decompress, depth });
+
+		for (UINT run = 0; run < 20; run++) {
+			step = 0;
+			graph.run(pool);
+			MLIB_ASSERT_STR(step == 4, "not all task graph nodes ran");
+			MLIB_ASSERT_STR(loadStep == 0 && integrateStep == 3, "task graph dependency violated");
+			MLIB_ASSERT_STR(decompressStep != depthStep, "task graph node ran twice");
+		}
+
+		//a graph with a cycle must be rejected
+		TaskGraph cyclic;
+		TaskGraph::NodeID a = cyclic.addTask("a", []() {});
+		TaskGraph::NodeID b = cyclic.addTask("b", []() {}, { a });
+		cyclic.addDependency(b, a);
+		bool thrown = false;
+		try {
+			cyclic.run(pool);
+		}
+		catch (const MLibException &) {
+			thrown = true;
+		}
+		MLIB_ASSERT_STR(thrown, "task graph cycle not detected");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		//continuations spawned while the graph runs, including one on a single-threaded and a thread-less pool
+		for (UINT threadCount : { 0u, 1u, 4u }) {
+			ThreadPool pool;
+			pool.init(threadCount);
+
+			std::atomic<UINT> stageSum(0);
+			TaskGraph graph;
+			TaskGraph::NodeID root = graph.addTask("root", [&]() { stageSum += 1; });
+			TaskGraph::NodeID spawner = 0;
+			spawner = graph.addTask("spawner", [&]() {
+				for (UINT i = 0; i < 8; i++) {
+					graph.addContinuation(spawner, "spawned", [&]() { stageSum += 10; });
+				}
+			});
+			graph.addContinuation(root, "after root", [&]() { stageSum += 100; });
+			graph.addTask("join", [&]() { stageSum += 1000; }, { root, spawner });
+
+			graph.run(pool);
+			MLIB_ASSERT_STR(stageSum == 1181, "task graph continuation missing");
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test2()
+	{
+		//the critical path is the longest chain, not the set of longest nodes
+		ThreadPool pool;
+		pool.init(4);
+
+		auto sleepMS = [](UINT ms) { return [ms]() { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }; };
+		TaskGraph graph;
+		TaskGraph::NodeID a = graph.addTask("a", sleepMS(5));
+		TaskGraph::NodeID b = graph.addTask("b", sleepMS(5), { a });
+		TaskGraph::NodeID c = graph.addTask("c", sleepMS(5), { b });
+		graph.addTask("long", sleepMS(12));
+		graph.run(pool);
+
+		const std::vector<TaskGraph::NodeID> path = graph.getCriticalPath();
+		MLIB_ASSERT_STR(path.size() == 3 && path[0] == a && path[1] == b && path[2] == c, "task graph critical path incorrect");
+		MLIB_ASSERT_STR(graph.getCriticalPathMS() >= 15.0, "task graph timing incorrect");
+		graph.printTimings();
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "taskGraph";
+	}
+};
@@ -0,0 +1,211 @@
+
+class TestThreadPoolTask : public WorkerThreadTask
+{
+public:
+	TestThreadPoolTask(std::vector<UINT64>& results, size_t index) : m_results(results), m_index(index) {}
+
+	void run(UINT threadIndex, ThreadLocalStorage *threadLocalStorage)
+	{
+		UINT64 sum = 0;
+		for (UINT64 i = 0; i <= m_index; i++) sum += i;
+		m_results[m_index] = sum;
+	}
+
+private:
+	std::vector<UINT64>& m_results;
+	size_t m_index;
+};
+
+class TestThreadPool : public Test
+{
+public:
+	void test0()
+	{
+		ThreadPool pool;
+		pool.init(std::max(2u, std::thread::hardware_concurrency()));
+
+		//the same workers must serve several batches
+		for (unsigned int batch = 0; batch < 10; batch++) {
+			const size_t taskCount = 1000 + 100 * batch;
+			std::vector<UINT64> results(taskCount, 0);
+
+			TaskList<WorkerThreadTask*> tasks;
+			for (size_t i = 0; i < taskCount; i++) {
+				tasks.insert(new TestThreadPoolTask(results, i));
+			}
+			pool.runTasks(tasks, false);
+
+			MLIB_ASSERT_STR(tasks.done(), "task list not drained");
+			for (size_t i = 0; i < taskCount; i++) {
+				MLIB_ASSERT_STR(results[i] == (UINT64)i * (i + 1) / 2, "thread pool task result incorrect");
+			}
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test1()
+	{
+		//many tiny batches: runTasks has to return as soon as the last task is done
+		ThreadPool pool;
+		pool.init(4);
+
+		Timer t;
+		const unsigned int batchCount = 1000;
+		for (unsigned int batch = 0; batch < batchCount; batch++) {
+			std::vector<UINT64> results(8, 0);
+			TaskList<WorkerThreadTask*> tasks;
+			for (size_t i = 0; i < results.size(); i++) {
+				tasks.insert(new TestThreadPoolTask(results, i));
+			}
+			pool.runTasks(tasks, false);
+			MLIB_ASSERT_STR(results.back() == 28, "thread pool task result incorrect");
+		}
+		std::cout << "average batch latency: " << t.getElapsedTimeMS() / batchCount << " ms" << std::endl;
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test2()
+	{
+		ThreadPool pool;
+		pool.init(4);
+
+		//every index must be visited exactly once, for any grain size
+		for (size_t grainSize : { (size_t)0, (size_t)1, (size_t)7, (size_t)100000 }) {
+			const size_t count = 10007;
+			std::vector<std::atomic<UINT>> visits(count);
+			for (auto &v : visits) v = 0;
+			parallelFor(pool, 3, count, grainSize, [&](size_t i) { visits[i]++; });
+			for (size_t i = 0; i < count; i++) {
+				MLIB_ASSERT_STR(visits[i] == (i < 3 ? 0u : 1u), "parallelFor index visited incorrectly");
+			}
+		}
+
+		//nested loops run on the workers of the same pool and must not deadlock
+		std::vector<UINT64> rowSums(64, 0);
+		parallelFor(pool, 0, rowSums.size(), 1, [&](size_t row) {
+			rowSums[row] = parallelReduce(pool, 0, 1000, (UINT64)0, [&](size_t col) { return (UINT64)(row * col); }, [](UINT64 a, UINT64 b) { return a + b; });
+		});
+		for (size_t row = 0; row < rowSums.size(); row++) {
+			MLIB_ASSERT_STR(rowSums[row] == (UINT64)row * 999 * 1000 / 2, "nested parallelReduce result incorrect");
+		}
+
+		//partials are combined in chunk order, so a fixed grain size gives a reproducible floating-point sum
+		const double sumA = parallelReduce(pool, 0, 100000, 0.0, [](size_t i) { return 1.0 / (i + 1); }, [](double a, double b) { return a + b; }, 128);
+		const double sumB = parallelReduce(pool, 0, 100000, 0.0, [](size_t i) { return 1.0 / (i + 1); }, [](double a, double b) { return a + b; }, 128);
+		MLIB_ASSERT_STR(sumA == sumB, "parallelReduce not deterministic");
+
+		//bool partials are written by different workers at the same time and must not share a packed word
+		for (size_t hit : { (size_t)0, (size_t)4321, (size_t)99999 }) {
+			const bool any = parallelReduce(pool, 0, 100000, false, [&](size_t i) { return i == hit; }, [](bool a, bool b) { return a || b; }, 1);
+			MLIB_ASSERT_STR(any, "parallelReduce over bool lost a result");
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test3()
+	{
+		const CPUTopology &topology = CPUTopology::get();
+		std::cout << "NUMA nodes: " << topology.getNodeCount() << ", CPUs: " << topology.getCPUCount() << std::endl;
+
+		for (ThreadPlacement placement : { ThreadPlacementOS, ThreadPlacementCores, ThreadPlacementNUMANodes }) {
+			ThreadPool pool;
+			pool.init(4, placement);
+
+			//every worker runs exactly once, on its own thread
+			std::vector<std::thread::id> workerThreads(pool.getThreadCount());
+			parallelForEachWorker(pool, [&](UINT threadIndex) { workerThreads[threadIndex] = std::this_thread::get_id(); });
+			std::set<std::thread::id> distinctThreads(workerThreads.begin(), workerThreads.end());
+			MLIB_ASSERT_STR(distinctThreads.size() == pool.getThreadCount(), "runOnEachWorker did not run on every worker");
+
+			//the static partition must hand the same indices to the same worker every time
+			std::vector<std::thread::id> owner(1000);
+			parallelForStatic(pool, 0, owner.size(), [&](size_t i) { owner[i] = std::this_thread::get_id(); });
+			for (UINT repeat = 0; repeat < 3; repeat++) {
+				parallelForStatic(pool, 0, owner.size(), [&](size_t i) {
+					MLIB_ASSERT_STR(owner[i] == std::this_thread::get_id(), "parallelForStatic partition not stable");
+				});
+			}
+
+			Grid3<float> grid(16, 8, 37);
+			firstTouchFill(pool, grid, 2.0f);
+			for (size_t i = 0; i < grid.getNumElements(); i++) {
+				MLIB_ASSERT_STR(grid.getData()[i] == 2.0f, "firstTouchFill incorrect");
+			}
+		}
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test4()
+	{
+		ThreadPool pool;
+		pool.init(4);
+		pool.setStatisticsEnabled(true);
+
+		const size_t taskCount = 2000;
+		std::vector<UINT64> results(taskCount, 0);
+		TaskList<WorkerThreadTask*> tasks;
+		for (size_t i = 0; i < taskCount; i++) {
+			tasks.insert(new TestThreadPoolTask(results, i));
+		}
+		pool.runTasks(tasks, false);
+
+		UINT64 tasksExecuted = 0;
+		for (const WorkerThreadStatistics &w : pool.getStatistics()) {
+			UINT64 histogramTotal = 0;
+			for (UINT64 count : w.durationHistogram) histogramTotal += count;
+			MLIB_ASSERT_STR(histogramTotal == w.tasksExecuted, "duration histogram does not match task count");
+			MLIB_ASSERT_STR(w.busyMS >= 0.0 && w.idleMS >= 0.0 && w.queueWaitMS >= 0.0, "negative worker times");
+			tasksExecuted += w.tasksExecuted;
+		}
+		MLIB_ASSERT_STR(tasksExecuted == taskCount, "executed task count incorrect");
+
+		const std::string json = pool.getStatisticsJSON();
+		MLIB_ASSERT_STR(json.find("\"workers\"") != std::string::npos && json.find("\"steals\"") != std::string::npos, "statistics JSON incomplete");
+
+		pool.resetStatistics();
+		MLIB_ASSERT_STR(pool.getStatistics()[0].tasksExecuted == 0, "statistics not reset");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	void test5()
+	{
+		ThreadPool pool;
+		pool.init(4);
+		RNG rng(5);
+
+		//full 63-bit keys, and 12-bit keys with many duplicates whose values must stay in input order
+		for (unsigned int keyBits : { 63u, 12u }) {
+			std::vector<std::pair<UINT64, UINT32>> data(100000);
+			for (size_t i = 0; i < data.size(); i++) {
+				const UINT64 key = ((UINT64)rng.uniform(0u, 0xffffffffu) << 32) | rng.uniform(0u, 0xffffffffu);
+				data[i] = std::make_pair(key & (((UINT64)1 << keyBits) - 1), (UINT32)i);
+			}
+			std::vector<std::pair<UINT64, UINT32>> expected = data;
+			std::stable_sort(expected.begin(), expected.end(), [](const std::pair<UINT64, UINT32> &a, const std::pair<UINT64, UINT32> &b) { return a.first < b.first; });
+			parallelRadixSort(pool, data, keyBits);
+			MLIB_ASSERT_STR(data == expected, "parallelRadixSort result differs from std::stable_sort");
+		}
+
+		//keys that agree in every digit, a single element and an empty array
+		std::vector<std::pair<UINT32, UINT32>> equal(10000, std::make_pair(7u, 0u));
+		for (size_t i = 0; i < equal.size(); i++) equal[i].second = (UINT32)i;
+		parallelRadixSort(pool, equal);
+		for (size_t i = 0; i < equal.size(); i++) MLIB_ASSERT_STR(equal[i].second == i, "parallelRadixSort is not stable");
+		std::vector<std::pair<UINT32, UINT32>> single(1, std::make_pair(3u, 4u)), empty;
+		parallelRadixSort(pool, single);
+		parallelRadixSort(pool, empty);
+		MLIB_ASSERT_STR(single[0].first == 3 && empty.empty(), "parallelRadixSort changed trivial input");
+
+		std::cout << __FUNCTION__ << " passed" << std::endl;
+	}
+
+	std::string getName()
+	{
+		return "threadPool";
+	}
+};